@@ -22,6 +22,30 @@
 
 #include "wsrep/logger.hpp"
 
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <thread>
+
+namespace
+{
+    // Seed for client workload generator, distinct for each client
+    // in the cluster but reproducible with the same --seed.
+    unsigned long long workload_seed(const db::params& params,
+                                     const std::string& server_name,
+                                     wsrep::client_id client_id)
+    {
+        std::seed_seq seq{
+            static_cast<unsigned long long>(params.seed),
+            static_cast<unsigned long long>(
+                std::hash<std::string>()(server_name)),
+            static_cast<unsigned long long>(client_id.get())};
+        unsigned int ret[2];
+        seq.generate(ret, ret + 2);
+        return (static_cast<unsigned long long>(ret[0]) << 32) | ret[1];
+    }
+}
+
 db::client::client(db::server& server,
                    wsrep::client_id client_id,
                    enum wsrep::client_state::mode mode,
@@ -34,21 +58,57 @@ db::client::client(db::server& server,
     , client_state_(mutex_, cond_, server_state_, client_service_, client_id, mode)
     , client_service_(*this)
     , se_trx_(server.storage_engine())
+    , workload_(server.workload(),
+                workload_seed(params, server.server_state().name(),
+                              client_id))
+    , ops_()
+    , do_2pc_()
+    , streaming_()
+    , ws_data_()
+    , ws_data_replicated_()
     , stats_()
+    , latency_mutex_()
+    , latency_()
+    , load_steps_()
+    , toi_stats_()
+    , commit_order_start_()
 { }
 
 void db::client::start()
 {
     client_state_.open(client_state_.id());
-    for (size_t i(0); i < params_.n_transactions; ++i)
+    if (params_.rate > 0)
     {
-        run_one_transaction();
-        report_progress(i + 1);
+        run_open_loop();
+    }
+    else
+    {
+        for (size_t i(0); i < params_.n_transactions; ++i)
+        {
+            run_one_transaction();
+            report_progress(i + 1);
+        }
     }
     client_state_.close();
     client_state_.cleanup();
 }
 
+db::latency_stats db::client::applier_latency() const
+{
+    wsrep::unique_lock<wsrep::mutex> lock(latency_mutex_);
+    return latency_;
+}
+
+void db::client::record_applier_latency(
+    enum db::latency_stats::phase phase,
+    db::latency_stats::clock::time_point start)
+{
+    const db::latency_stats::clock::duration duration(
+        db::latency_stats::clock::now() - start);
+    wsrep::unique_lock<wsrep::mutex> lock(latency_mutex_);
+    latency_.record(phase, duration);
+}
+
 bool db::client::bf_abort(wsrep::seqno seqno)
 {
     return client_state_.bf_abort(seqno);
@@ -86,58 +146,149 @@ int db::client::client_command(F f)
     return err;
 }
 
-void db::client::run_one_transaction()
+void db::client::run_open_loop()
+{
+    typedef db::latency_stats::clock clock;
+    const db::workload& workload(server_.workload());
+    for (size_t step(0); step < params_.ramp_steps; ++step)
+    {
+        double const rate(workload.client_rate(step));
+        load_steps_.push_back(db::load_step());
+        db::load_step& load_step(load_steps_.back());
+        load_step.target_rate = rate;
+        const struct stats stats_before(stats_);
+        const clock::time_point step_start(clock::now());
+        // Transactions arrive according to the schedule regardless of
+        // how long the previous ones took. If the client falls behind,
+        // the next transaction starts immediately and the time spent
+        // behind the schedule is included in its latency.
+        clock::time_point intended_start(
+            step_start + workload_.first_arrival(rate));
+        for (size_t i(0); i < params_.n_transactions; ++i)
+        {
+            std::this_thread::sleep_until(intended_start);
+            run_one_transaction(intended_start);
+            report_progress(i + 1);
+            intended_start += workload_.next_arrival(rate);
+        }
+        double const seconds(
+            std::chrono::duration<double>(clock::now() - step_start).count());
+        load_step.commits = stats_.commits - stats_before.commits;
+        load_step.rollbacks = stats_.rollbacks - stats_before.rollbacks;
+        load_step.achieved_rate = load_step.commits / seconds;
+    }
+}
+
+void db::client::run_one_transaction(
+    db::latency_stats::clock::time_point intended_start)
 {
+    typedef db::latency_stats::clock clock;
+    const bool open_loop(intended_start != clock::time_point());
+    const clock::time_point trx_start(open_loop ?
+                                      intended_start : clock::now());
+    if (open_loop)
+    {
+        latency_.record(db::latency_stats::queue, intended_start);
+    }
+    if (workload_.next_toi())
+    {
+        run_toi();
+        return;
+    }
     client_state_.reset_error();
+    const bool large(workload_.next_large());
+    workload_.next_transaction(ops_, large);
+    do_2pc_ = workload_.next_2pc();
+    streaming_ = (large && params_.sr_fragment_size > 0);
+    ws_data_.clear();
+    ws_data_replicated_ = 0;
     int err = client_command(
         [&]()
         {
             // wsrep::log_debug() << "Start transaction";
+            const clock::time_point start(clock::now());
             err = client_state_.start_transaction(
                 wsrep::transaction_id(server_.next_transaction_id()));
             assert(err == 0);
             se_trx_.start(this);
+            if (streaming_)
+            {
+                err = client_state_.enable_streaming(
+                    server_.workload().fragment_unit(),
+                    params_.sr_fragment_size);
+            }
+            else if (client_state_.transaction().streaming_context()
+                     .fragment_size())
+            {
+                client_state_.disable_streaming();
+            }
+            latency_.record(db::latency_stats::start, start);
             return err;
         });
 
     const wsrep::transaction& transaction(
         client_state_.transaction());
 
-    err = err || client_command(
-        [&]()
-        {
-            // wsrep::log_debug() << "Generate write set";
-            assert(transaction.active());
-            assert(err == 0);
-            int data(std::rand() % params_.n_rows);
-            std::ostringstream os;
-            os << data;
-            wsrep::key key(wsrep::key::exclusive);
-            key.append_key_part("dbms", 4);
-            unsigned long long client_key(client_state_.id().get());
-            key.append_key_part(&client_key, sizeof(client_key));
-            key.append_key_part(&data, sizeof(data));
-            err = client_state_.append_key(key);
-            err = err || client_state_.append_data(
-                wsrep::const_buffer(os.str().c_str(),
-                                    os.str().size()));
-            return err;
-        });
+    // Large streaming transactions execute one row operation per
+    // statement so that fragments can be replicated also between
+    // statements.
+    const size_t ops_per_statement(streaming_ ? 1 : ops_.size());
+    const clock::time_point append_start(clock::now());
+    for (size_t begin(0); err == 0 && begin < ops_.size();
+         begin += ops_per_statement)
+    {
+        err = client_command(
+            [&]()
+            {
+                // wsrep::log_debug() << "Generate write set";
+                assert(transaction.active());
+                return execute_operations(
+                    begin, std::min(begin + ops_per_statement, ops_.size()));
+            });
+    }
+    if (err == 0) latency_.record(db::latency_stats::append, append_start);
 
     err = err || client_command(
         [&]()
         {
             // wsrep::log_debug() << "Commit";
             assert(err == 0);
+            clock::time_point start(clock::now());
             if (do_2pc())
             {
                 err = err || client_state_.before_prepare();
                 err = err || client_state_.after_prepare();
+                if (err == 0)
+                {
+                    latency_.record(db::latency_stats::certify, start);
+                    start = clock::now();
+                }
             }
+            // Without 2PC certification is done in before_commit().
+            // Entering the commit order is marked in debug_sync().
+            commit_order_start_ = clock::time_point();
             err = err || client_state_.before_commit();
-            if (err == 0) se_trx_.commit(transaction.ws_meta().gtid());
+            if (err == 0)
+            {
+                if (commit_order_start_ != clock::time_point())
+                {
+                    if (do_2pc() == false)
+                    {
+                        latency_.record(db::latency_stats::certify,
+                                        commit_order_start_ - start);
+                    }
+                    start = commit_order_start_;
+                }
+                latency_.record(db::latency_stats::commit_order, start);
+                start = clock::now();
+                se_trx_.commit(transaction.ws_meta().gtid());
+            }
             err = err || client_state_.ordered_commit();
             err = err || client_state_.after_commit();
+            if (err == 0)
+            {
+                latency_.record(db::latency_stats::ordered_commit, start);
+            }
             if (err)
             {
                 client_state_.before_rollback();
@@ -147,6 +298,20 @@ void db::client::run_one_transaction()
             return err;
         });
 
+    if (transaction.active())
+    {
+        // Statement failed without BF abort, e.g. because of lock
+        // wait timeout.
+        client_command(
+            [&]()
+            {
+                client_state_.before_rollback();
+                se_trx_.rollback();
+                client_state_.after_rollback();
+                return 1;
+            });
+    }
+
     assert(err ||
            transaction.state() == wsrep::transaction::s_aborted ||
            transaction.state() == wsrep::transaction::s_committed);
@@ -157,15 +322,136 @@ void db::client::run_one_transaction()
     {
     case wsrep::transaction::s_committed:
         ++stats_.commits;
+        server_.counters().commits.fetch_add(1, std::memory_order_relaxed);
+        latency_.record(db::latency_stats::total, trx_start);
+        if (open_loop)
+        {
+            load_steps_.back().latency.record(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    clock::now() - trx_start).count());
+        }
+        if (params_.toi_ratio > 0)
+        {
+            const clock::time_point now(clock::now());
+            toi_stats_.record_commit(now, now - trx_start);
+        }
         break;
     case wsrep::transaction::s_aborted:
         ++stats_.rollbacks;
+        server_.counters().rollbacks.fetch_add(1, std::memory_order_relaxed);
         break;
     default:
         assert(0);
     }
 }
 
+void db::client::run_toi()
+{
+    typedef db::latency_stats::clock clock;
+    wsrep::key key(wsrep::key::exclusive);
+    if (server_.workload().toi_key_scope() == db::workload::table)
+    {
+        // Row keys are appended under the same table key part,
+        // see execute_operations().
+        key.append_key_part("dbms", 4);
+    }
+    const wsrep::key_array keys(1, key);
+    // The operation payload is the simulated duration in milliseconds,
+    // see high_priority_service::apply_toi().
+    const std::string data(std::to_string(params_.toi_duration));
+    client_state_.reset_error();
+    // TOI operation does not start a transaction, so the
+    // command is run without client_command() which expects
+    // errors to abort the transaction.
+    int err(client_state_.before_command());
+    if (err == 0)
+    {
+        err = client_state_.before_statement();
+        if (err == 0)
+        {
+            const clock::time_point start(clock::now());
+            err = client_state_.enter_toi_local(
+                keys, wsrep::const_buffer(data.data(), data.size()),
+                wsrep::provider::flag::start_transaction |
+                wsrep::provider::flag::commit);
+            if (err == 0)
+            {
+                std::this_thread::sleep_for(
+                    std::chrono::milliseconds(params_.toi_duration));
+                err = client_state_.leave_toi_local(wsrep::mutable_buffer());
+                toi_stats_.record_toi(start, clock::now());
+            }
+        }
+        client_state_.after_statement();
+    }
+    client_state_.after_command_before_result();
+    client_state_.after_command_after_result();
+    if (err == 0)
+    {
+        ++stats_.tois;
+    }
+    else
+    {
+        ++stats_.toi_failures;
+    }
+}
+
+int db::client::execute_operations(size_t begin, size_t end)
+{
+    const wsrep::transaction& transaction(client_state_.transaction());
+    int err(0);
+    for (size_t i(begin); err == 0 && i < end; ++i)
+    {
+        const db::workload::operation& op(ops_[i]);
+        if (op.type == db::workload::operation::read)
+        {
+            std::string value;
+            se_trx_.read(op.row, value);
+            if (op.shared_key == false) continue;
+        }
+        else
+        {
+            std::ostringstream os;
+            os << client_state_.id().get() << ":"
+               << transaction.id().get() << ":";
+            std::string value(os.str());
+            value.resize(op.payload_size, ' ');
+            err = se_trx_.write(op.row, value);
+            if (err) break;
+            db::storage_engine::encode_write(ws_data_, op.row, value);
+        }
+        wsrep::key key(op.type == db::workload::operation::read ?
+                       wsrep::key::shared : wsrep::key::exclusive);
+        key.append_key_part("dbms", 4);
+        key.append_key_part(&op.row, sizeof(op.row));
+        err = client_state_.append_key(key);
+        if (err == 0 && op.type == db::workload::operation::write)
+        {
+            err = client_state_.after_row();
+        }
+    }
+    // Streaming transactions replicate the data in fragments and
+    // at commit, see client_service::prepare_data_for_replication().
+    if (err == 0 && streaming_ == false)
+    {
+        err = append_data();
+    }
+    return err;
+}
+
+int db::client::append_data()
+{
+    if (ws_data_replicated_ == ws_data_.size())
+    {
+        return 0;
+    }
+    int ret(client_state_.append_data(
+                wsrep::const_buffer(ws_data_.data() + ws_data_replicated_,
+                                    ws_data_.size() - ws_data_replicated_)));
+    ws_data_replicated_ = ws_data_.size();
+    return ret;
+}
+
 void db::client::report_progress(size_t i) const
 {
     if ((i % 1000) == 0)
@@ -27,10 +27,15 @@
 #include "db_client_state.hpp"
 #include "db_client_service.hpp"
 #include "db_high_priority_service.hpp"
+#include "db_latency.hpp"
+#include "db_workload.hpp"
+
+#include <vector>
 
 namespace db
 {
     class server;
+    class storage_service;
     class client
     {
     public:
@@ -39,10 +44,14 @@ namespace db
             long long commits;
             long long rollbacks;
             long long replays;
+            long long tois;
+            long long toi_failures;
             stats()
                 : commits(0)
                 , rollbacks(0)
                 , replays(0)
+                , tois(0)
+                , toi_failures(0)
             { }
         };
         client(db::server&,
@@ -51,6 +60,24 @@ namespace db
                const db::params&);
         bool bf_abort(wsrep::seqno);
         const struct stats stats() const { return stats_; }
+        const db::latency_stats& latency() const { return latency_; }
+        /**
+         * Return a copy of the latencies recorded by the high priority
+         * service of the client. Can be called while the high priority
+         * service is running.
+         */
+        db::latency_stats applier_latency() const;
+        /**
+         * Return results of open loop load steps, empty in closed
+         * loop mode.
+         */
+        const std::vector<db::load_step>& load_steps() const
+        { return load_steps_; }
+        /**
+         * Return TOI operations and DML commit timeline, empty if
+         * the workload does not contain TOI operations.
+         */
+        const db::toi_stats& toi_stats() const { return toi_stats_; }
         void store_globals()
         {
             client_state_.store_globals();
@@ -60,15 +87,25 @@ namespace db
         void start();
         wsrep::client_state& client_state() { return client_state_; }
         wsrep::client_service& client_service() { return client_service_; }
-        bool do_2pc() const { return false; }
+        bool do_2pc() const { return do_2pc_; }
     private:
         friend class db::server_state;
         friend class db::client_service;
         friend class db::high_priority_service;
+        friend class db::storage_service;
         template <class F> int client_command(F f);
-        void run_one_transaction();
+        void run_open_loop();
+        int execute_operations(size_t begin, size_t end);
+        int append_data();
+        void run_one_transaction(db::latency_stats::clock::time_point
+                                 intended_start =
+                                 db::latency_stats::clock::time_point());
+        void run_toi();
         void reset_error();
         void report_progress(size_t) const;
+        // Record latency from the high priority service.
+        void record_applier_latency(enum db::latency_stats::phase,
+                                    db::latency_stats::clock::time_point);
         wsrep::default_mutex mutex_;
         wsrep::default_condition_variable cond_;
         const db::params& params_;
@@ -77,7 +114,25 @@ namespace db
         db::client_state client_state_;
         db::client_service client_service_;
         db::storage_engine::transaction se_trx_;
+        db::workload::generator workload_;
+        // Operations of the current transaction
+        std::vector<db::workload::operation> ops_;
+        bool do_2pc_;
+        // Current transaction uses streaming replication
+        bool streaming_;
+        // Write set data of the current transaction and the number
+        // of bytes appended to the provider
+        std::string ws_data_;
+        size_t ws_data_replicated_;
         struct stats stats_;
+        // Protects latency_ when recorded by high priority service
+        mutable wsrep::default_mutex latency_mutex_;
+        db::latency_stats latency_;
+        std::vector<db::load_step> load_steps_;
+        db::toi_stats toi_stats_;
+        // Time when certification was done and the transaction
+        // is about to enter commit order, see client_service::debug_sync()
+        db::latency_stats::clock::time_point commit_order_start_;
     };
 }
 
@@ -20,6 +20,9 @@
 #include "db_client_service.hpp"
 #include "db_high_priority_service.hpp"
 #include "db_client.hpp"
+#include "db_server.hpp"
+
+#include <cstring>
 
 db::client_service::client_service(db::client& client)
     : wsrep::client_service()
@@ -27,6 +30,35 @@ db::client_service::client_service(db::client& client)
     , client_state_(client_.client_state())
 { }
 
+int db::client_service::prepare_data_for_replication()
+{
+    return client_.append_data();
+}
+
+size_t db::client_service::bytes_generated() const
+{
+    return client_.ws_data_.size();
+}
+
+int db::client_service::prepare_fragment_for_replication(
+    wsrep::mutable_buffer& buffer)
+{
+    const std::string& data(client_.ws_data_);
+    buffer.push_back(data.data() + client_.ws_data_replicated_,
+                     data.data() + data.size());
+    client_.ws_data_replicated_ = data.size();
+    return 0;
+}
+
+int db::client_service::remove_fragments()
+{
+    // Fragments are removed when the transaction commits.
+    const wsrep::transaction& transaction(client_state_.transaction());
+    client_.se_trx_.remove_fragments(transaction.server_id(),
+                                     transaction.id());
+    return 0;
+}
+
 int db::client_service::bf_rollback()
 {
     int ret(client_state_.before_rollback());
@@ -49,6 +81,16 @@ db::client_service::replay()
     if (ret == wsrep::provider::success)
     {
         ++client_.stats_.replays;
+        client_.server_.counters().replays.fetch_add(
+            1, std::memory_order_relaxed);
     }
     return ret;
 }
+
+void db::client_service::debug_sync(const char* sync_point)
+{
+    if (std::strcmp(sync_point, "wsrep_before_commit_order_enter") == 0)
+    {
+        client_.commit_order_start_ = db::latency_stats::clock::now();
+    }
+}
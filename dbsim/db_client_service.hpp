@@ -33,37 +33,29 @@ namespace db
     public:
         client_service(db::client& client);
 
-        bool interrupted(wsrep::unique_lock<wsrep::mutex>&)
+        bool interrupted(wsrep::unique_lock<wsrep::client_mutex>&)
             const override
         { return false; }
         void reset_globals() override { }
         void store_globals() override { }
-        int prepare_data_for_replication() override
-        {
-            return 0;
-        }
+        int prepare_data_for_replication() override;
         void cleanup_transaction() override { }
-        size_t bytes_generated() const override
-        {
-            return 0;
-        }
+        size_t bytes_generated() const override;
         bool statement_allowed_for_streaming() const override
         {
             return true;
         }
-        int prepare_fragment_for_replication(wsrep::mutable_buffer&) override
-        {
-            return 0;
-        }
-        int remove_fragments() override { return 0; }
+        int prepare_fragment_for_replication(wsrep::mutable_buffer&) override;
+        int remove_fragments() override;
         int bf_rollback() override;
         void will_replay() override { }
-        void wait_for_replayers(wsrep::unique_lock<wsrep::mutex>&) override { }
+        void wait_for_replayers(
+            wsrep::unique_lock<wsrep::client_mutex>&) override { }
         enum wsrep::provider::status replay()
             override;
 
         void emergency_shutdown() override { ::abort(); }
-        void debug_sync(const char*) override { }
+        void debug_sync(const char*) override;
         void debug_crash(const char*) override { }
     private:
         db::client& client_;
@@ -29,8 +29,8 @@ namespace db
     class client_state : public wsrep::client_state
     {
     public:
-        client_state(wsrep::mutex& mutex,
-                     wsrep::condition_variable& cond,
+        client_state(wsrep::client_mutex& mutex,
+                     wsrep::client_condition_variable& cond,
                      db::server_state& server_state,
                      wsrep::client_service& client_service,
                      const wsrep::client_id& client_id,
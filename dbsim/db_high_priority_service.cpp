@@ -21,6 +21,8 @@
 #include "db_server.hpp"
 #include "db_client.hpp"
 
+#include <thread>
+
 db::high_priority_service::high_priority_service(
     db::server& server, db::client& client)
     : wsrep::high_priority_service(server.server_state())
@@ -40,22 +42,101 @@ const wsrep::transaction& db::high_priority_service::transaction() const
     return client_.client_state().transaction();
 }
 
-int db::high_priority_service::adopt_transaction(const wsrep::transaction&)
+int db::high_priority_service::adopt_transaction(
+    const wsrep::transaction& transaction)
 {
-    throw wsrep::not_implemented_error();
+    // Storage engine transaction is started when the fragments
+    // are removed, this may be called with storage engine
+    // locks held when a streaming client is BF aborted.
+    client_.client_state_.adopt_transaction(transaction);
+    return 0;
 }
 
 int db::high_priority_service::apply_write_set(
-    const wsrep::ws_meta&,
-    const wsrep::const_buffer&,
+    const wsrep::ws_meta& ws_meta,
+    const wsrep::const_buffer& data,
     wsrep::mutable_buffer&)
 {
+    const db::latency_stats::clock::time_point start(
+        db::latency_stats::clock::now());
+    // Streaming applier transaction is started by the first fragment.
+    if (client_.se_trx_.active() == false)
+    {
+        client_.se_trx_.start(&client_);
+    }
+    const wsrep::transaction& transaction(
+        client_.client_state().transaction());
+    int ret(0);
+    if (is_replaying() && transaction.is_streaming())
+    {
+        // Writes of the fragments were rolled back with the local
+        // transaction, apply them from the fragment store first.
+        std::vector<std::string> fragments;
+        server_.storage_engine().fragments(
+            transaction.server_id(), transaction.id(), fragments);
+        for (const auto& fragment : fragments)
+        {
+            ret = ret || client_.se_trx_.apply(
+                transaction,
+                wsrep::const_buffer(fragment.data(), fragment.size()));
+        }
+    }
+    ret = ret || client_.se_trx_.apply(transaction, data);
+    if (ret == 0 && wsrep::commits_transaction(ws_meta.flags()) == false)
+    {
+        client_.client_state_.fragment_applied(ws_meta.seqno());
+    }
+    client_.record_applier_latency(db::latency_stats::apply, start);
+    if (ret == 0)
+    {
+        server_.counters().applied.fetch_add(1, std::memory_order_relaxed);
+    }
+    return ret;
+}
+
+int db::high_priority_service::append_fragment_and_commit(
+    const wsrep::ws_handle& ws_handle,
+    const wsrep::ws_meta& ws_meta,
+    const wsrep::const_buffer& data)
+{
+    int ret(client_.client_state_.start_transaction(ws_handle, ws_meta));
     client_.se_trx_.start(&client_);
-    client_.se_trx_.apply(client_.client_state().transaction());
+    client_.se_trx_.append_fragment(ws_meta.server_id(),
+                                    ws_meta.transaction_id(),
+                                    ws_meta.seqno(), data);
+    ret = ret || commit(ws_handle, ws_meta);
+    return ret;
+}
+
+int db::high_priority_service::remove_fragments(const wsrep::ws_meta&)
+{
+    if (client_.se_trx_.active() == false)
+    {
+        client_.se_trx_.start(&client_);
+    }
+    const wsrep::transaction& transaction(
+        client_.client_state().transaction());
+    client_.se_trx_.remove_fragments(transaction.server_id(),
+                                     transaction.id());
     return 0;
 }
 
 int db::high_priority_service::apply_toi(
+    const wsrep::ws_meta& ws_meta,
+    const wsrep::const_buffer& data,
+    wsrep::mutable_buffer&)
+{
+    // The payload of TOI operation is the simulated duration in
+    // milliseconds, see client::run_toi().
+    const std::string duration(data.data(), data.size());
+    client_.client_state_.enter_toi_mode(ws_meta);
+    std::this_thread::sleep_for(
+        std::chrono::milliseconds(std::stoul(duration)));
+    client_.client_state_.leave_toi_mode();
+    return 0;
+}
+
+int db::high_priority_service::apply_nbo_begin(
     const wsrep::ws_meta&,
     const wsrep::const_buffer&,
     wsrep::mutable_buffer&)
@@ -66,11 +147,33 @@ int db::high_priority_service::apply_toi(
 int db::high_priority_service::commit(const wsrep::ws_handle& ws_handle,
                                       const wsrep::ws_meta& ws_meta)
 {
+    typedef db::latency_stats::clock clock;
+    if (ws_meta.ordered() == false)
+    {
+        // Commit which was not ordered does not go through commit
+        // hooks, the changes are committed in the storage engine
+        // and the transaction state is cleaned up by rolling back.
+        client_.se_trx_.commit(wsrep::gtid());
+        return (client_.client_state_.before_rollback() ||
+                client_.client_state_.after_rollback());
+    }
     client_.client_state_.prepare_for_ordering(ws_handle, ws_meta, true);
+    clock::time_point start(clock::now());
     int ret(client_.client_state_.before_commit());
-    if (ret == 0) client_.se_trx_.commit(ws_meta.gtid());
+    if (ret == 0)
+    {
+        client_.record_applier_latency(
+            db::latency_stats::apply_commit_order, start);
+        start = clock::now();
+        client_.se_trx_.commit(ws_meta.gtid());
+    }
     ret = ret || client_.client_state_.ordered_commit();
     ret = ret || client_.client_state_.after_commit();
+    if (ret == 0)
+    {
+        client_.record_applier_latency(
+            db::latency_stats::apply_ordered_commit, start);
+    }
     return ret;
 }
 
@@ -118,6 +221,11 @@ int db::high_priority_service::log_dummy_write_set(
     return ret;
 }
 
+void db::high_priority_service::store_globals()
+{
+    client_.store_globals();
+}
+
 bool db::high_priority_service::is_replaying() const
 {
     return false;
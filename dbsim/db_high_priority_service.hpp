@@ -40,17 +40,19 @@ namespace db
         int append_fragment_and_commit(
             const wsrep::ws_handle&,
             const wsrep::ws_meta&, const wsrep::const_buffer&)
-            override
-        { return 0; }
-        int remove_fragments(const wsrep::ws_meta&) override
-        { return 0; }
+            override;
+        int remove_fragments(const wsrep::ws_meta&) override;
         int commit(const wsrep::ws_handle&, const wsrep::ws_meta&) override;
         int rollback(const wsrep::ws_handle&, const wsrep::ws_meta&) override;
         int apply_toi(const wsrep::ws_meta&, const wsrep::const_buffer&,
                       wsrep::mutable_buffer&) override;
+        int apply_nbo_begin(const wsrep::ws_meta&, const wsrep::const_buffer&,
+                            wsrep::mutable_buffer&) override;
         void adopt_apply_error(wsrep::mutable_buffer&) override;
         virtual void after_apply() override;
-        void store_globals() override { }
+        // Streaming appliers may be created by one thread and
+        // used by another.
+        void store_globals() override;
         void reset_globals() override { }
         void switch_execution_context(wsrep::high_priority_service&) override
         { }
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "db_json.hpp"
+
+#include <cmath>
+#include <iomanip>
+#include <limits>
+
+db::json_writer& db::json_writer::key(const std::string& name)
+{
+    value(name);
+    os_ << ": ";
+    after_key_ = true;
+    return *this;
+}
+
+db::json_writer& db::json_writer::value(const std::string& str)
+{
+    separator();
+    os_ << '"';
+    for (char c : str)
+    {
+        switch (c)
+        {
+        case '"':  os_ << "\\\""; break;
+        case '\\': os_ << "\\\\"; break;
+        case '\n': os_ << "\\n"; break;
+        case '\r': os_ << "\\r"; break;
+        case '\t': os_ << "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                std::ios_base::fmtflags flags(os_.flags());
+                os_ << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+                    << int(c) << std::setfill(' ');
+                os_.flags(flags);
+            }
+            else
+            {
+                os_ << c;
+            }
+        }
+    }
+    os_ << '"';
+    return *this;
+}
+
+db::json_writer& db::json_writer::value(bool val)
+{
+    separator();
+    os_ << (val ? "true" : "false");
+    return *this;
+}
+
+db::json_writer& db::json_writer::value(double val)
+{
+    separator();
+    if (std::isfinite(val))
+    {
+        std::streamsize const precision(os_.precision());
+        os_ << std::setprecision(std::numeric_limits<double>::digits10)
+            << val << std::setprecision(precision);
+    }
+    else
+    {
+        os_ << "null";
+    }
+    return *this;
+}
+
+db::json_writer& db::json_writer::begin(char c)
+{
+    separator();
+    os_ << c;
+    first_.push_back(true);
+    return *this;
+}
+
+db::json_writer& db::json_writer::end(char c)
+{
+    bool const empty(first_.back());
+    first_.pop_back();
+    if (empty == false)
+    {
+        newline();
+    }
+    os_ << c;
+    if (first_.empty())
+    {
+        os_ << "\n";
+    }
+    return *this;
+}
+
+void db::json_writer::separator()
+{
+    if (after_key_)
+    {
+        // Value of object member follows the key on the same line.
+        after_key_ = false;
+        return;
+    }
+    if (first_.empty())
+    {
+        return;
+    }
+    if (first_.back() == false)
+    {
+        os_ << ",";
+    }
+    first_.back() = false;
+    newline();
+}
+
+void db::json_writer::newline()
+{
+    os_ << "\n" << std::string(2 * first_.size(), ' ');
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/** @file db_json.hpp
+ *
+ * Minimal streaming JSON writer for dbsim results.
+ *
+ * Values are written to the output stream as they are added,
+ * the writer only keeps track of the nesting to place separators
+ * and indentation. It is up to the caller to produce a well formed
+ * document: keys are given only inside objects and every
+ * begin_object() / begin_array() is matched with the corresponding
+ * end call.
+ */
+
+#ifndef WSREP_DB_JSON_HPP
+#define WSREP_DB_JSON_HPP
+
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace db
+{
+    class json_writer
+    {
+    public:
+        json_writer(std::ostream& os)
+            : os_(os)
+            , first_()
+            , after_key_()
+        { }
+
+        json_writer& begin_object() { return begin('{'); }
+        json_writer& end_object() { return end('}'); }
+        json_writer& begin_array() { return begin('['); }
+        json_writer& end_array() { return end(']'); }
+
+        /**
+         * Write object member key, must be followed by a value
+         * or by beginning of an object or array.
+         */
+        json_writer& key(const std::string&);
+
+        json_writer& value(const std::string&);
+        json_writer& value(const char* str) { return value(std::string(str)); }
+        json_writer& value(bool);
+        /**
+         * Write floating point value, non-finite values are
+         * written as null.
+         */
+        json_writer& value(double);
+
+        template <typename T>
+        typename std::enable_if<std::is_integral<T>::value, json_writer&>::type
+        value(T val)
+        {
+            separator();
+            os_ << val;
+            return *this;
+        }
+
+        /**
+         * Write object member.
+         */
+        template <typename T>
+        json_writer& member(const std::string& name, const T& val)
+        {
+            key(name);
+            return value(val);
+        }
+    private:
+        json_writer& begin(char);
+        json_writer& end(char);
+        void separator();
+        void newline();
+        std::ostream& os_;
+        // True if no values have been written at the nesting level
+        std::vector<bool> first_;
+        bool after_key_;
+    };
+}
+
+#endif // WSREP_DB_JSON_HPP
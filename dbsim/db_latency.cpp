@@ -0,0 +1,371 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "db_latency.hpp"
+#include "db_json.hpp"
+
+#include <algorithm>
+#include <iomanip>
+
+namespace
+{
+    // Values below sub_buckets are recorded exactly. Above that each
+    // power of two range is divided into sub_buckets / 2 linear
+    // buckets, which gives relative precision of 1.5-3%.
+    const size_t sub_bucket_bits = 6;
+    const size_t sub_buckets = 1 << sub_bucket_bits;
+    const size_t half_sub_buckets = sub_buckets / 2;
+    const size_t n_buckets = (64 - sub_bucket_bits + 2) * half_sub_buckets;
+
+    size_t msb(uint64_t value)
+    {
+        return 63 - __builtin_clzll(value);
+    }
+}
+
+db::histogram::histogram()
+    : counts_(n_buckets)
+    , count_()
+    , max_()
+{ }
+
+size_t db::histogram::bucket(uint64_t value)
+{
+    if (value < sub_buckets)
+    {
+        return value;
+    }
+    size_t const shift(msb(value) - sub_bucket_bits + 1);
+    // value >> shift is in range [half_sub_buckets, sub_buckets)
+    return shift * half_sub_buckets + (value >> shift);
+}
+
+uint64_t db::histogram::bucket_value(size_t bucket)
+{
+    if (bucket < sub_buckets)
+    {
+        return bucket;
+    }
+    size_t const shift(bucket / half_sub_buckets - 1);
+    uint64_t const mantissa(bucket - shift * half_sub_buckets);
+    return ((mantissa + 1) << shift) - 1;
+}
+
+void db::histogram::record(uint64_t value)
+{
+    ++counts_[bucket(value)];
+    ++count_;
+    if (value > max_) max_ = value;
+}
+
+void db::histogram::merge(const histogram& other)
+{
+    for (size_t i(0); i < n_buckets; ++i)
+    {
+        counts_[i] += other.counts_[i];
+    }
+    count_ += other.count_;
+    if (other.max_ > max_) max_ = other.max_;
+}
+
+uint64_t db::histogram::percentile(double p) const
+{
+    if (count_ == 0) return 0;
+    // Rank of the value at percentile, rounded up.
+    uint64_t rank(static_cast<uint64_t>(p / 100. * count_ + 0.5));
+    if (rank == 0) rank = 1;
+    uint64_t seen(0);
+    for (size_t i(0); i < n_buckets; ++i)
+    {
+        seen += counts_[i];
+        if (seen >= rank)
+        {
+            return std::min(bucket_value(i), max_);
+        }
+    }
+    return max_;
+}
+
+std::vector<std::pair<uint64_t, uint64_t> > db::histogram::buckets() const
+{
+    std::vector<std::pair<uint64_t, uint64_t> > ret;
+    for (size_t i(0); i < n_buckets; ++i)
+    {
+        if (counts_[i] > 0)
+        {
+            ret.push_back(std::make_pair(std::min(bucket_value(i), max_),
+                                         counts_[i]));
+        }
+    }
+    return ret;
+}
+
+void db::histogram::write_json(db::json_writer& writer) const
+{
+    writer.begin_object();
+    writer.member("count", count_);
+    writer.member("p50", percentile(50));
+    writer.member("p90", percentile(90));
+    writer.member("p99", percentile(99));
+    writer.member("p99.9", percentile(99.9));
+    writer.member("max", max_);
+    writer.key("buckets").begin_array();
+    for (const auto& bucket : buckets())
+    {
+        writer.begin_array()
+            .value(bucket.first)
+            .value(bucket.second)
+            .end_array();
+    }
+    writer.end_array();
+    writer.end_object();
+}
+
+void db::latency_stats::merge(const latency_stats& other)
+{
+    for (size_t i(0); i < n_phases; ++i)
+    {
+        histograms_[i].merge(other.histograms_[i]);
+    }
+}
+
+void db::latency_stats::report(std::ostream& os) const
+{
+    os << std::left << std::setw(16) << "phase" << std::right
+       << std::setw(12) << "count"
+       << std::setw(12) << "p50"
+       << std::setw(12) << "p90"
+       << std::setw(12) << "p99"
+       << std::setw(12) << "p99.9"
+       << std::setw(12) << "max"
+       << "\n";
+    std::ios_base::fmtflags flags(os.flags());
+    os << std::fixed << std::setprecision(1);
+    for (size_t i(0); i < n_phases; ++i)
+    {
+        const histogram& h(histograms_[i]);
+        if (h.count() == 0) continue;
+        os << std::left << std::setw(16)
+           << to_c_string(static_cast<enum phase>(i)) << std::right
+           << std::setw(12) << h.count()
+           << std::setw(12) << h.percentile(50) / 1000.
+           << std::setw(12) << h.percentile(90) / 1000.
+           << std::setw(12) << h.percentile(99) / 1000.
+           << std::setw(12) << h.percentile(99.9) / 1000.
+           << std::setw(12) << h.max() / 1000.
+           << "\n";
+    }
+    os.flags(flags);
+}
+
+void db::latency_stats::write_json(db::json_writer& writer) const
+{
+    writer.begin_object();
+    for (size_t i(0); i < n_phases; ++i)
+    {
+        const histogram& h(histograms_[i]);
+        if (h.count() == 0) continue;
+        writer.key(to_c_string(static_cast<enum phase>(i)));
+        h.write_json(writer);
+    }
+    writer.end_object();
+}
+
+const char* db::latency_stats::to_c_string(enum phase phase)
+{
+    switch (phase)
+    {
+    case queue:          return "queue";
+    case start:          return "start";
+    case append:         return "append";
+    case certify:        return "certify";
+    case commit_order:   return "commit_order";
+    case ordered_commit: return "ordered_commit";
+    case apply:          return "apply";
+    case apply_commit_order:   return "apply_commit_order";
+    case apply_ordered_commit: return "apply_ordered_commit";
+    case total:          return "total";
+    case n_phases:       break;
+    }
+    return "unknown";
+}
+
+void db::load_step::merge(const load_step& other)
+{
+    target_rate += other.target_rate;
+    achieved_rate += other.achieved_rate;
+    commits += other.commits;
+    rollbacks += other.rollbacks;
+    latency.merge(other.latency);
+}
+
+void db::load_step::report(std::ostream& os,
+                           const std::vector<load_step>& steps)
+{
+    os << std::left << std::setw(8) << "step" << std::right
+       << std::setw(12) << "target"
+       << std::setw(12) << "achieved"
+       << std::setw(12) << "commits"
+       << std::setw(12) << "rollbacks"
+       << std::setw(12) << "p50"
+       << std::setw(12) << "p99"
+       << std::setw(12) << "p99.9"
+       << std::setw(12) << "max"
+       << "\n";
+    std::ios_base::fmtflags flags(os.flags());
+    os << std::fixed << std::setprecision(1);
+    for (size_t i(0); i < steps.size(); ++i)
+    {
+        const load_step& step(steps[i]);
+        const histogram& h(step.latency);
+        os << std::left << std::setw(8) << (i + 1) << std::right
+           << std::setw(12) << step.target_rate
+           << std::setw(12) << step.achieved_rate
+           << std::setw(12) << step.commits
+           << std::setw(12) << step.rollbacks
+           << std::setw(12) << h.percentile(50) / 1000.
+           << std::setw(12) << h.percentile(99) / 1000.
+           << std::setw(12) << h.percentile(99.9) / 1000.
+           << std::setw(12) << h.max() / 1000.
+           << "\n";
+    }
+    os.flags(flags);
+}
+
+void db::load_step::write_json(db::json_writer& writer,
+                               const std::vector<load_step>& steps)
+{
+    writer.begin_array();
+    for (const auto& step : steps)
+    {
+        writer.begin_object();
+        writer.member("target_rate", step.target_rate);
+        writer.member("achieved_rate", step.achieved_rate);
+        writer.member("commits", step.commits);
+        writer.member("rollbacks", step.rollbacks);
+        writer.key("latency");
+        step.latency.write_json(writer);
+        writer.end_object();
+    }
+    writer.end_array();
+}
+
+void db::toi_stats::merge(const toi_stats& other)
+{
+    // Commits of each client are recorded in time order, keep the
+    // merged timeline sorted for window lookups.
+    size_t const middle(commits_.size());
+    commits_.insert(commits_.end(),
+                    other.commits_.begin(), other.commits_.end());
+    std::inplace_merge(commits_.begin(), commits_.begin() + middle,
+                       commits_.end());
+    events_.insert(events_.end(), other.events_.begin(), other.events_.end());
+    std::sort(events_.begin(), events_.end(),
+              [](const event& a, const event& b)
+              {
+                  return a.start < b.start;
+              });
+}
+
+void db::toi_stats::window(clock::time_point begin, clock::time_point end,
+                           histogram& latency) const
+{
+    auto i(std::lower_bound(commits_.begin(), commits_.end(),
+                            commit(begin, 0)));
+    auto last(std::lower_bound(i, commits_.end(), commit(end, 0)));
+    for (; i != last; ++i)
+    {
+        latency.record(i->latency);
+    }
+}
+
+void db::toi_stats::report(std::ostream& os) const
+{
+    enum { before, during, after, n_windows };
+    os << std::left << std::setw(8) << "toi" << std::right
+       << std::setw(12) << "ms"
+       << std::setw(12) << "tps before"
+       << std::setw(12) << "tps during"
+       << std::setw(12) << "tps after"
+       << std::setw(12) << "p99 before"
+       << std::setw(12) << "p99 during"
+       << std::setw(12) << "p99 after"
+       << "\n";
+    std::ios_base::fmtflags flags(os.flags());
+    os << std::fixed << std::setprecision(1);
+    histogram total[n_windows];
+    double total_seconds(0);
+    auto print_row([&os](double seconds, const histogram* windows)
+                   {
+                       os << std::setw(12) << seconds * 1000.;
+                       for (size_t i(0); i < n_windows; ++i)
+                       {
+                           os << std::setw(12)
+                              << windows[i].count() / seconds;
+                       }
+                       for (size_t i(0); i < n_windows; ++i)
+                       {
+                           os << std::setw(12)
+                              << windows[i].percentile(99) / 1000.;
+                       }
+                       os << "\n";
+                   });
+    for (size_t i(0); i < events_.size(); ++i)
+    {
+        const event& e(events_[i]);
+        // Windows before and after the operation are as long as the
+        // operation itself.
+        const clock::duration length(
+            std::max(e.end - e.start,
+                     clock::duration(std::chrono::microseconds(1))));
+        const double seconds(
+            std::chrono::duration<double>(length).count());
+        histogram windows[n_windows];
+        window(e.start - length, e.start, windows[before]);
+        window(e.start, e.end, windows[during]);
+        window(e.end, e.end + length, windows[after]);
+        os << std::left << std::setw(8) << (i + 1) << std::right;
+        print_row(seconds, windows);
+        for (size_t w(0); w < n_windows; ++w)
+        {
+            total[w].merge(windows[w]);
+        }
+        total_seconds += seconds;
+    }
+    if (total_seconds > 0)
+    {
+        os << std::left << std::setw(8) << "all" << std::right;
+        print_row(total_seconds, total);
+        if (total[before].count() > 0)
+        {
+            os << "DML throughput dip during TOI: "
+               << 100. * (1. - double(total[during].count())
+                          / total[before].count())
+               << "%\n";
+        }
+        if (total[before].percentile(99) > 0)
+        {
+            os << "DML p99 latency spike during TOI: "
+               << double(total[during].percentile(99))
+                / total[before].percentile(99)
+               << "x\n";
+        }
+    }
+    os.flags(flags);
+}
@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/** @file db_latency.hpp
+ *
+ * Latency histograms for dbsim.
+ *
+ * Latencies are recorded into log-linear histograms in the spirit
+ * of HdrHistogram: values are bucketed by their highest set bit
+ * and each power of two range is divided into linear sub-buckets,
+ * which gives constant relative precision over the whole
+ * value range. Histograms are not thread safe, each client records
+ * into its own and the histograms are merged when reporting.
+ */
+
+#ifndef WSREP_DB_LATENCY_HPP
+#define WSREP_DB_LATENCY_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+namespace db
+{
+    class json_writer;
+
+    class histogram
+    {
+    public:
+        histogram();
+        void record(uint64_t value);
+        void merge(const histogram&);
+        uint64_t count() const { return count_; }
+        uint64_t max() const { return max_; }
+        /**
+         * Return value at given percentile. The returned value is
+         * the highest value equivalent to the bucket the percentile
+         * falls in.
+         *
+         * @param p Percentile in range [0, 100].
+         */
+        uint64_t percentile(double p) const;
+        /**
+         * Return non-empty buckets as pairs of the highest value
+         * equivalent to the bucket and the bucket count, in
+         * ascending value order.
+         */
+        std::vector<std::pair<uint64_t, uint64_t> > buckets() const;
+        /**
+         * Write histogram as JSON object, values in nanoseconds.
+         */
+        void write_json(db::json_writer&) const;
+    private:
+        static size_t bucket(uint64_t value);
+        static uint64_t bucket_value(size_t bucket);
+        std::vector<uint64_t> counts_;
+        uint64_t count_;
+        uint64_t max_;
+    };
+
+    class latency_stats
+    {
+    public:
+        enum phase
+        {
+            /** Open loop: delay from intended to actual start */
+            queue,
+            /** Start transaction */
+            start,
+            /** Append keys and data */
+            append,
+            /** Certification, or prepare with 2PC */
+            certify,
+            /** Waiting to enter commit order */
+            commit_order,
+            /** Storage engine commit and leaving commit order */
+            ordered_commit,
+            /** Applying write set by high priority service */
+            apply,
+            /** High priority service waiting to enter commit order */
+            apply_commit_order,
+            /** High priority service storage engine commit and
+                leaving commit order */
+            apply_ordered_commit,
+            /** Whole local transaction, measured from the intended
+                start time in open loop mode */
+            total,
+            n_phases
+        };
+
+        typedef std::chrono::steady_clock clock;
+
+        latency_stats() : histograms_(n_phases) { }
+
+        void record(enum phase phase, clock::duration duration)
+        {
+            histograms_[phase].record(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    duration).count());
+        }
+
+        void record(enum phase phase, clock::time_point start)
+        {
+            record(phase, clock::now() - start);
+        }
+
+        void merge(const latency_stats& other);
+
+        const histogram& operator[](enum phase phase) const
+        {
+            return histograms_[phase];
+        }
+
+        /**
+         * Print percentiles of all phases which have recorded
+         * values, in microseconds.
+         */
+        void report(std::ostream&) const;
+
+        /**
+         * Write histograms of all phases which have recorded
+         * values as JSON object keyed by phase name.
+         */
+        void write_json(db::json_writer&) const;
+
+        static const char* to_c_string(enum phase);
+    private:
+        std::vector<histogram> histograms_;
+    };
+
+    /**
+     * Results of one open loop load step.
+     */
+    struct load_step
+    {
+        /** Target aggregate rate in transactions per second */
+        double target_rate;
+        /** Achieved rate in transactions per second */
+        double achieved_rate;
+        long long commits;
+        long long rollbacks;
+        /** Latencies of committed transactions measured from
+            the intended start time */
+        histogram latency;
+        load_step()
+            : target_rate()
+            , achieved_rate()
+            , commits()
+            , rollbacks()
+            , latency()
+        { }
+        /**
+         * Merge results of another client running the same step.
+         * Target and achieved rates are summed.
+         */
+        void merge(const load_step&);
+        /**
+         * Print a table of load steps, latencies in microseconds.
+         */
+        static void report(std::ostream&, const std::vector<load_step>&);
+        /**
+         * Write load steps as JSON array.
+         */
+        static void write_json(db::json_writer&,
+                               const std::vector<load_step>&);
+    };
+
+    /**
+     * Timeline of TOI operations and committed DML transactions.
+     *
+     * The DML throughput and latency are compared in three windows
+     * around each TOI operation: during the operation and in windows
+     * of the same length before and after it. Like histograms,
+     * TOI stats are not thread safe and are merged when reporting.
+     */
+    class toi_stats
+    {
+    public:
+        typedef latency_stats::clock clock;
+
+        toi_stats() : events_(), commits_() { }
+
+        /**
+         * Record TOI operation which was executed between
+         * start and end.
+         */
+        void record_toi(clock::time_point start, clock::time_point end)
+        {
+            events_.push_back(event(start, end));
+        }
+
+        /**
+         * Record DML transaction commit.
+         *
+         * @param end Time when the transaction committed.
+         * @param latency Latency of the transaction.
+         */
+        void record_commit(clock::time_point end, clock::duration latency)
+        {
+            commits_.push_back(
+                commit(end,
+                       std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           latency).count()));
+        }
+
+        size_t events() const { return events_.size(); }
+
+        void merge(const toi_stats&);
+
+        /**
+         * Print a table of DML throughput and latency before, during
+         * and after each TOI operation and a summary over all
+         * operations, latencies in microseconds.
+         */
+        void report(std::ostream&) const;
+    private:
+        // Record latencies of commits in [begin, end) into histogram.
+        void window(clock::time_point begin, clock::time_point end,
+                    histogram&) const;
+        struct event
+        {
+            event(clock::time_point s, clock::time_point e)
+                : start(s), end(e) { }
+            clock::time_point start;
+            clock::time_point end;
+        };
+        struct commit
+        {
+            commit(clock::time_point e, uint64_t l)
+                : end(e), latency(l) { }
+            bool operator<(const commit& other) const
+            { return end < other.end; }
+            clock::time_point end;
+            uint64_t latency;
+        };
+        std::vector<event> events_;
+        std::vector<commit> commits_;
+    };
+}
+
+#endif // WSREP_DB_LATENCY_HPP
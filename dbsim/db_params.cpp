@@ -18,6 +18,8 @@
  */
 
 #include "db_params.hpp"
+#include "db_workload.hpp"
+#include "db_placement.hpp"
 
 #include <boost/program_options.hpp>
 #include <iostream>
@@ -37,6 +39,138 @@ namespace
                    << params.n_servers << "\n";
             }
         }
+        if (params.min_appliers == 0 ||
+            params.min_appliers > params.max_appliers)
+        {
+            os << "Error: --min-appliers=" << params.min_appliers
+               << " must be positive and not greater than --max-appliers="
+               << params.max_appliers << "\n";
+        }
+        if (params.n_rows == 0)
+        {
+            os << "Error: --rows must be positive\n";
+        }
+        db::workload::distribution distribution;
+        if (db::workload::parse_distribution(params.distribution,
+                                             distribution))
+        {
+            os << "Error: --distribution=" << params.distribution
+               << " must be one of uniform, zipfian, hotspot\n";
+        }
+        if (params.zipf_theta <= 0 || params.zipf_theta >= 1)
+        {
+            os << "Error: --zipf-theta=" << params.zipf_theta
+               << " must be between 0 and 1\n";
+        }
+        if (params.hotspot_rows <= 0 || params.hotspot_rows > 1)
+        {
+            os << "Error: --hotspot-rows=" << params.hotspot_rows
+               << " must be greater than 0 and at most 1\n";
+        }
+        if (params.min_rows_per_transaction == 0 ||
+            params.min_rows_per_transaction > params.max_rows_per_transaction)
+        {
+            os << "Error: --min-rows-per-transaction="
+               << params.min_rows_per_transaction
+               << " must be positive and not greater than "
+               << "--max-rows-per-transaction="
+               << params.max_rows_per_transaction << "\n";
+        }
+        if (params.min_payload > params.max_payload)
+        {
+            os << "Error: --min-payload=" << params.min_payload
+               << " must not be greater than --max-payload="
+               << params.max_payload << "\n";
+        }
+        if (params.rate < 0)
+        {
+            os << "Error: --rate=" << params.rate
+               << " must not be negative\n";
+        }
+        db::workload::arrival arrival;
+        if (db::workload::parse_arrival(params.arrival, arrival))
+        {
+            os << "Error: --arrival=" << params.arrival
+               << " must be one of poisson, fixed\n";
+        }
+        if (params.ramp_steps == 0 ||
+            (params.ramp_steps > 1 && params.rate == 0))
+        {
+            os << "Error: --ramp-steps=" << params.ramp_steps
+               << " must be positive and requires --rate\n";
+        }
+        if (params.large_transaction_rows == 0)
+        {
+            os << "Error: --large-transaction-rows must be positive\n";
+        }
+        enum wsrep::streaming_context::fragment_unit fragment_unit;
+        if (db::workload::parse_fragment_unit(params.sr_fragment_unit,
+                                              fragment_unit))
+        {
+            os << "Error: --sr-fragment-unit=" << params.sr_fragment_unit
+               << " must be one of bytes, rows, statements\n";
+        }
+        enum db::workload::toi_key_scope toi_key_scope;
+        if (db::workload::parse_toi_key_scope(params.toi_key_scope,
+                                              toi_key_scope))
+        {
+            os << "Error: --toi-key-scope=" << params.toi_key_scope
+               << " must be one of table, wildcard\n";
+        }
+        if (params.samples_format != "csv" && params.samples_format != "json")
+        {
+            os << "Error: --samples-format=" << params.samples_format
+               << " must be one of csv, json\n";
+        }
+        if (params.sample_interval > 0 && params.samples_file.empty())
+        {
+            os << "Error: --sample-interval requires --samples-file\n";
+        }
+        const struct
+        {
+            const char* name;
+            const std::string& value;
+        } cpu_lists[] = {
+            { "client-cpus", params.client_cpus },
+            { "applier-cpus", params.applier_cpus },
+            { "provider-cpus", params.provider_cpus }
+        };
+        for (const auto& cpu_list : cpu_lists)
+        {
+            std::vector<int> cpus;
+            if (db::placement::parse_cpu_list(cpu_list.value, cpus))
+            {
+                os << "Error: --" << cpu_list.name << "=" << cpu_list.value
+                   << " is not a valid CPU list\n";
+            }
+        }
+        std::vector<int> numa_nodes;
+        if (db::server_placement::parse_numa_nodes(params.numa_nodes,
+                                                   numa_nodes))
+        {
+            os << "Error: --numa-nodes=" << params.numa_nodes
+               << " is not a valid NUMA node list\n";
+        }
+        const struct
+        {
+            const char* name;
+            double value;
+        } ratios[] = {
+            { "hotspot-access-ratio", params.hotspot_access_ratio },
+            { "read-ratio", params.read_ratio },
+            { "shared-key-ratio", params.shared_key_ratio },
+            { "2pc-ratio", params.two_pc_ratio },
+            { "large-transaction-ratio", params.large_transaction_ratio },
+            { "toi-ratio", params.toi_ratio }
+        };
+        for (const auto& ratio : ratios)
+        {
+            if (ratio.value < 0 || ratio.value > 1)
+            {
+                os << "Error: --" << ratio.name << "=" << ratio.value
+                   << " must be between 0 and 1\n";
+            }
+        }
         if (os.str().size())
         {
             throw std::invalid_argument(os.str());
@@ -68,11 +202,99 @@ db::params db::parse_args(int argc, char** argv)
         ("rows", po::value<size_t>(&params.n_rows),
          "number of rows per table")
         ("alg-freq", po::value<size_t>(&params.alg_freq),
-         "ALG frequency")
+         "ALG frequency, BF abort a local transaction in addition "
+         "to lock conflicts once per given number of applied write sets")
+        ("lock-wait-timeout", po::value<long long>(&params.lock_wait_timeout),
+         "row lock wait timeout for local transactions in milliseconds")
+        ("distribution", po::value<std::string>(&params.distribution),
+         "row access distribution: uniform, zipfian or hotspot")
+        ("zipf-theta", po::value<double>(&params.zipf_theta),
+         "skew of zipfian distribution, between 0 and 1")
+        ("hotspot-rows", po::value<double>(&params.hotspot_rows),
+         "fraction of rows in hotspot for hotspot distribution")
+        ("hotspot-access-ratio",
+         po::value<double>(&params.hotspot_access_ratio),
+         "fraction of accesses which go to hotspot rows")
+        ("min-rows-per-transaction",
+         po::value<size_t>(&params.min_rows_per_transaction),
+         "minimum number of rows accessed by a transaction")
+        ("max-rows-per-transaction",
+         po::value<size_t>(&params.max_rows_per_transaction),
+         "maximum number of rows accessed by a transaction")
+        ("read-ratio", po::value<double>(&params.read_ratio),
+         "fraction of row accesses which are reads, every transaction "
+         "writes at least one row")
+        ("shared-key-ratio", po::value<double>(&params.shared_key_ratio),
+         "fraction of reads which append a shared key to the write set")
+        ("min-payload", po::value<size_t>(&params.min_payload),
+         "minimum size of a written row value in bytes")
+        ("max-payload", po::value<size_t>(&params.max_payload),
+         "maximum size of a written row value in bytes")
+        ("2pc-ratio", po::value<double>(&params.two_pc_ratio),
+         "fraction of transactions which use two phase commit")
+        ("seed", po::value<unsigned long long>(&params.seed),
+         "seed for workload random number generators")
+        ("rate", po::value<double>(&params.rate),
+         "open loop mode: target aggregate rate of all clients in "
+         "transactions per second, zero for closed loop clients")
+        ("arrival", po::value<std::string>(&params.arrival),
+         "open loop transaction arrival process: poisson or fixed")
+        ("ramp-steps", po::value<size_t>(&params.ramp_steps),
+         "open loop mode: step the target rate up to --rate in given "
+         "number of equal steps, each client runs --transactions "
+         "per step")
+        ("large-transaction-ratio",
+         po::value<double>(&params.large_transaction_ratio),
+         "fraction of transactions which are large")
+        ("large-transaction-rows",
+         po::value<size_t>(&params.large_transaction_rows),
+         "number of rows accessed by a large transaction")
+        ("sr-fragment-unit", po::value<std::string>(&params.sr_fragment_unit),
+         "streaming replication fragment unit for large transactions: "
+         "bytes, rows or statements, large transactions execute "
+         "one row operation per statement")
+        ("sr-fragment-size", po::value<size_t>(&params.sr_fragment_size),
+         "streaming replication fragment size in fragment units for "
+         "large transactions, zero disables streaming")
+        ("toi-ratio", po::value<double>(&params.toi_ratio),
+         "fraction of client operations which are TOI operations "
+         "instead of transactions")
+        ("toi-key-scope", po::value<std::string>(&params.toi_key_scope),
+         "certification key scope of TOI operations: table for a table "
+         "level key covering all rows, wildcard for a server level key")
+        ("toi-duration", po::value<size_t>(&params.toi_duration),
+         "simulated duration of TOI operation in milliseconds")
+        ("min-appliers", po::value<size_t>(&params.min_appliers),
+         "minimum number of applier threads")
+        ("max-appliers", po::value<size_t>(&params.max_appliers),
+         "maximum number of applier threads, the number of appliers "
+         "is adjusted dynamically if greater than --min-appliers")
         ("debug-log-level", po::value<int>(&params.debug_log_level),
          "debug logging level: 0 - none, 1 - verbose")
         ("fast-exit", po::value<int>(&params.fast_exit),
-         "exit from simulation without graceful shutdown");
+         "exit from simulation without graceful shutdown")
+        ("results-file", po::value<std::string>(&params.results_file),
+         "write results in JSON format into given file, see "
+         "dbsim_compare for comparing results of two runs")
+        ("sample-interval", po::value<size_t>(&params.sample_interval),
+         "interval in milliseconds for sampling commits, rollbacks, "
+         "BF aborts, replays and applied write sets of each server, "
+         "zero disables sampling")
+        ("samples-file", po::value<std::string>(&params.samples_file),
+         "file to write samples into")
+        ("samples-format", po::value<std::string>(&params.samples_format),
+         "format of samples file: csv or json")
+        ("client-cpus", po::value<std::string>(&params.client_cpus),
+         "CPU list to pin client threads to, e.g. 0-7,16-23")
+        ("applier-cpus", po::value<std::string>(&params.applier_cpus),
+         "CPU list to pin applier threads to")
+        ("provider-cpus", po::value<std::string>(&params.provider_cpus),
+         "CPU list to pin provider threads to, applied to the threads "
+         "the provider creates when it is loaded and connected")
+        ("numa-nodes", po::value<std::string>(&params.numa_nodes),
+         "comma separated list of NUMA nodes to bind servers to, "
+         "server i is bound to node i modulo the list length, CPU lists "
+         "are restricted to the CPUs of the node");
     try
     {
         po::variables_map vm;
@@ -32,22 +32,88 @@ namespace db
         size_t n_transactions;
         size_t n_rows;
         size_t alg_freq;
+        long long lock_wait_timeout;
+        std::string distribution;
+        double zipf_theta;
+        double hotspot_rows;
+        double hotspot_access_ratio;
+        size_t min_rows_per_transaction;
+        size_t max_rows_per_transaction;
+        double read_ratio;
+        double shared_key_ratio;
+        size_t min_payload;
+        size_t max_payload;
+        double two_pc_ratio;
+        unsigned long long seed;
+        double rate;
+        std::string arrival;
+        size_t ramp_steps;
+        double large_transaction_ratio;
+        size_t large_transaction_rows;
+        std::string sr_fragment_unit;
+        size_t sr_fragment_size;
+        double toi_ratio;
+        std::string toi_key_scope;
+        size_t toi_duration;
+        size_t min_appliers;
+        size_t max_appliers;
         std::string topology;
         std::string wsrep_provider;
         std::string wsrep_provider_options;
         int debug_log_level;
         int fast_exit;
+        std::string results_file;
+        size_t sample_interval;
+        std::string samples_file;
+        std::string samples_format;
+        std::string client_cpus;
+        std::string applier_cpus;
+        std::string provider_cpus;
+        std::string numa_nodes;
         params()
             : n_servers(0)
             , n_clients(0)
             , n_transactions(0)
             , n_rows(1000)
             , alg_freq(0)
+            , lock_wait_timeout(1000)
+            , distribution("uniform")
+            , zipf_theta(0.99)
+            , hotspot_rows(0.2)
+            , hotspot_access_ratio(0.8)
+            , min_rows_per_transaction(1)
+            , max_rows_per_transaction(1)
+            , read_ratio(0)
+            , shared_key_ratio(0)
+            , min_payload(16)
+            , max_payload(16)
+            , two_pc_ratio(0)
+            , seed(0)
+            , rate(0)
+            , arrival("poisson")
+            , ramp_steps(1)
+            , large_transaction_ratio(0)
+            , large_transaction_rows(1000)
+            , sr_fragment_unit("rows")
+            , sr_fragment_size(0)
+            , toi_ratio(0)
+            , toi_key_scope("table")
+            , toi_duration(10)
+            , min_appliers(1)
+            , max_appliers(1)
             , topology()
             , wsrep_provider()
             , wsrep_provider_options()
             , debug_log_level(0)
             , fast_exit(0)
+            , results_file()
+            , sample_interval(0)
+            , samples_file()
+            , samples_format("csv")
+            , client_cpus()
+            , applier_cpus()
+            , provider_cpus()
+            , numa_nodes()
         { }
     };
 
@@ -0,0 +1,254 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "db_placement.hpp"
+#include "db_json.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+
+#if defined(__linux__)
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif // __linux__
+
+namespace
+{
+    // Parse non-negative integer which consists of digits only.
+    int parse_int(const std::string& str, int& value)
+    {
+        if (str.empty() || str.size() > 6 ||
+            str.find_first_not_of("0123456789") != std::string::npos)
+        {
+            return 1;
+        }
+        value = std::atoi(str.c_str());
+        return 0;
+    }
+}
+
+int db::placement::apply() const
+{
+    if (empty())
+    {
+        return 0;
+    }
+#if defined(__linux__)
+    if (cpus_.size())
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus_)
+        {
+            if (cpu >= CPU_SETSIZE) return 1;
+            CPU_SET(cpu, &set);
+        }
+        // Zero pid is the calling thread.
+        if (sched_setaffinity(0, sizeof(set), &set))
+        {
+            return 1;
+        }
+    }
+    if (numa_node_ >= 0)
+    {
+        const size_t bits(sizeof(unsigned long) * 8);
+        std::vector<unsigned long> mask(numa_node_ / bits + 1);
+        mask[numa_node_ / bits] = 1UL << (numa_node_ % bits);
+        return (syscall(SYS_set_mempolicy, MPOL_BIND, mask.data(),
+                        mask.size() * bits + 1) ? 1 : 0);
+    }
+    return (syscall(SYS_set_mempolicy, MPOL_DEFAULT, NULL, 0) ? 1 : 0);
+#else
+    return 1;
+#endif // __linux__
+}
+
+db::placement db::placement::current()
+{
+    std::vector<int> cpus;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+        for (int cpu(0); cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+        }
+    }
+#endif // __linux__
+    return placement(cpus, -1);
+}
+
+int db::placement::parse_cpu_list(const std::string& list,
+                                  std::vector<int>& cpus)
+{
+    cpus.clear();
+    std::istringstream is(list);
+    std::string range;
+    while (std::getline(is, range, ','))
+    {
+        const size_t dash(range.find('-'));
+        int first, last;
+        if (dash == std::string::npos)
+        {
+            if (parse_int(range, first)) return 1;
+            last = first;
+        }
+        else if (parse_int(range.substr(0, dash), first) ||
+                 parse_int(range.substr(dash + 1), last) ||
+                 first > last)
+        {
+            return 1;
+        }
+        for (int cpu(first); cpu <= last; ++cpu)
+        {
+            cpus.push_back(cpu);
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return 0;
+}
+
+std::string db::placement::to_cpu_list(const std::vector<int>& cpus)
+{
+    std::ostringstream os;
+    for (size_t i(0); i < cpus.size();)
+    {
+        size_t j(i);
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) ++j;
+        if (i > 0) os << ",";
+        os << cpus[i];
+        if (j > i) os << "-" << cpus[j];
+        i = j + 1;
+    }
+    return os.str();
+}
+
+int db::placement::numa_node_cpus(int node, std::vector<int>& cpus)
+{
+    std::ostringstream path;
+    path << "/sys/devices/system/node/node" << node << "/cpulist";
+    std::ifstream ifs(path.str().c_str());
+    std::string list;
+    if (!std::getline(ifs, list))
+    {
+        return 1;
+    }
+    return parse_cpu_list(list, cpus);
+}
+
+db::server_placement db::server_placement::create(const db::params& params,
+                                                  size_t index)
+{
+    server_placement ret;
+    std::vector<int> nodes;
+    if (parse_numa_nodes(params.numa_nodes, nodes))
+    {
+        throw std::invalid_argument("Invalid NUMA node list: "
+                                    + params.numa_nodes);
+    }
+    std::vector<int> node_cpus;
+    if (nodes.size())
+    {
+        ret.numa_node = nodes[index % nodes.size()];
+        if (placement::numa_node_cpus(ret.numa_node, node_cpus))
+        {
+            throw std::invalid_argument(
+                "Failed to read CPUs of NUMA node "
+                + std::to_string(ret.numa_node));
+        }
+    }
+    const struct
+    {
+        const char* name;
+        const std::string& list;
+        placement& target;
+    } groups[] = {
+        { "client", params.client_cpus, ret.clients },
+        { "applier", params.applier_cpus, ret.appliers },
+        { "provider", params.provider_cpus, ret.provider }
+    };
+    for (const auto& group : groups)
+    {
+        std::vector<int> cpus;
+        if (placement::parse_cpu_list(group.list, cpus))
+        {
+            throw std::invalid_argument(std::string("Invalid ")
+                                        + group.name + " CPU list: "
+                                        + group.list);
+        }
+        if (ret.numa_node >= 0)
+        {
+            if (cpus.empty())
+            {
+                cpus = node_cpus;
+            }
+            else
+            {
+                std::vector<int> intersection;
+                std::set_intersection(cpus.begin(), cpus.end(),
+                                      node_cpus.begin(), node_cpus.end(),
+                                      std::back_inserter(intersection));
+                if (intersection.empty())
+                {
+                    throw std::invalid_argument(
+                        std::string("No ") + group.name + " CPUs "
+                        + group.list + " on NUMA node "
+                        + std::to_string(ret.numa_node));
+                }
+                cpus.swap(intersection);
+            }
+        }
+        group.target = placement(cpus, ret.numa_node);
+    }
+    return ret;
+}
+
+int db::server_placement::parse_numa_nodes(const std::string& list,
+                                           std::vector<int>& nodes)
+{
+    nodes.clear();
+    std::istringstream is(list);
+    std::string node;
+    while (std::getline(is, node, ','))
+    {
+        int value;
+        if (parse_int(node, value)) return 1;
+        nodes.push_back(value);
+    }
+    return 0;
+}
+
+void db::server_placement::write_json(db::json_writer& writer) const
+{
+    writer.begin_object();
+    writer.member("numa_node", numa_node);
+    writer.member("client_cpus", placement::to_cpu_list(clients.cpus()));
+    writer.member("applier_cpus", placement::to_cpu_list(appliers.cpus()));
+    writer.member("provider_cpus", placement::to_cpu_list(provider.cpus()));
+    writer.end_object();
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/** @file db_placement.hpp
+ *
+ * CPU and NUMA placement of dbsim threads.
+ *
+ * Threads of each server are divided into three groups: client
+ * threads, applier threads and provider threads. Each group can
+ * be pinned to a CPU set and each server can be bound to a NUMA
+ * node. When a server is bound to a NUMA node, the CPU sets of its
+ * thread groups are restricted to the CPUs of the node and memory
+ * allocations of the threads are bound to the node.
+ *
+ * Provider threads are not visible to dbsim. They inherit the
+ * placement of the thread which loads and connects the provider,
+ * so the provider placement is applied to the main thread while
+ * the server is being started.
+ *
+ * Placement is supported only on Linux.
+ */
+
+#ifndef WSREP_DB_PLACEMENT_HPP
+#define WSREP_DB_PLACEMENT_HPP
+
+#include "db_params.hpp"
+
+#include <string>
+#include <vector>
+
+namespace db
+{
+    class json_writer;
+
+    class placement
+    {
+    public:
+        /**
+         * Construct placement which does not change the thread
+         * placement.
+         */
+        placement()
+            : cpus_()
+            , numa_node_(-1)
+        { }
+
+        /**
+         * @param cpus CPUs to pin the threads to, empty for all CPUs.
+         * @param numa_node NUMA node to bind memory allocations to,
+         *                  -1 for default memory policy.
+         */
+        placement(const std::vector<int>& cpus, int numa_node)
+            : cpus_(cpus)
+            , numa_node_(numa_node)
+        { }
+
+        /**
+         * Return true if the placement does not change the thread
+         * placement.
+         */
+        bool empty() const { return cpus_.empty() && numa_node_ == -1; }
+
+        const std::vector<int>& cpus() const { return cpus_; }
+        int numa_node() const { return numa_node_; }
+
+        /**
+         * Apply placement to the calling thread.
+         *
+         * @return Zero on success, non-zero on failure.
+         */
+        int apply() const;
+
+        /**
+         * Return placement of the calling thread. The returned
+         * placement has the default memory policy.
+         */
+        static placement current();
+
+        /**
+         * Parse CPU list in the format of Linux cpulist files,
+         * e.g. "0-3,8,10-11".
+         *
+         * @return Zero on success, non-zero if the list is not valid.
+         */
+        static int parse_cpu_list(const std::string&, std::vector<int>&);
+
+        /**
+         * Format CPU list in the format of Linux cpulist files.
+         */
+        static std::string to_cpu_list(const std::vector<int>&);
+
+        /**
+         * Read CPUs of NUMA node.
+         *
+         * @return Zero on success, non-zero if the node does not exist.
+         */
+        static int numa_node_cpus(int node, std::vector<int>&);
+    private:
+        std::vector<int> cpus_;
+        int numa_node_;
+    };
+
+    /**
+     * Placement of the threads of one server.
+     */
+    struct server_placement
+    {
+        /** NUMA node the server is bound to, -1 if not bound */
+        int numa_node;
+        placement clients;
+        placement appliers;
+        placement provider;
+
+        server_placement()
+            : numa_node(-1)
+            , clients()
+            , appliers()
+            , provider()
+        { }
+
+        /**
+         * Construct placement of server from parameters.
+         *
+         * @param index Index of the server.
+         *
+         * @throw std::invalid_argument If the parameters are not
+         *        valid or the resulting CPU set of some thread group
+         *        is empty.
+         */
+        static server_placement create(const db::params&, size_t index);
+
+        /**
+         * Parse NUMA node list, e.g. "0,1".
+         *
+         * @return Zero on success, non-zero if the list is not valid.
+         */
+        static int parse_numa_nodes(const std::string&, std::vector<int>&);
+
+        void write_json(db::json_writer&) const;
+    };
+}
+
+#endif // WSREP_DB_PLACEMENT_HPP
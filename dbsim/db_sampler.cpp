@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "db_sampler.hpp"
+#include "db_server.hpp"
+#include "db_json.hpp"
+
+#include <iomanip>
+
+db::sampler::sampler(const servers& servers,
+                     std::chrono::milliseconds interval)
+    : servers_(servers)
+    , interval_(interval)
+    , mutex_()
+    , cond_()
+    , stop_()
+    , thread_()
+    , start_()
+    , last_()
+    , previous_()
+    , samples_()
+{ }
+
+db::sampler::~sampler()
+{
+    stop();
+}
+
+void db::sampler::start()
+{
+    start_ = last_ = clock::now();
+    previous_.clear();
+    for (const auto& s : servers_)
+    {
+        previous_.push_back(read_counters(s.first, *s.second));
+    }
+    thread_ = boost::thread(&db::sampler::run, this);
+}
+
+void db::sampler::stop()
+{
+    {
+        wsrep::unique_lock<wsrep::default_mutex> lock(mutex_);
+        if (stop_ || thread_.joinable() == false) return;
+        stop_ = true;
+        cond_.notify_one();
+    }
+    thread_.join();
+}
+
+db::sampler::sample db::sampler::read_counters(const std::string& name,
+                                               db::server& server)
+{
+    sample ret;
+    ret.server = name;
+    const struct db::server::counters& counters(server.counters());
+    ret.commits = counters.commits;
+    ret.rollbacks = counters.rollbacks;
+    ret.bf_aborts = server.storage_engine().bf_aborts();
+    ret.replays = counters.replays;
+    ret.applied = counters.applied;
+    return ret;
+}
+
+void db::sampler::write_csv(std::ostream& os) const
+{
+    os << "time,interval,server,commits,rollbacks,bf_aborts,replays,applied\n";
+    std::ios_base::fmtflags flags(os.flags());
+    os << std::fixed << std::setprecision(3);
+    for (const auto& s : samples_)
+    {
+        os << s.time << ","
+           << s.interval << ","
+           << s.server << ","
+           << s.commits << ","
+           << s.rollbacks << ","
+           << s.bf_aborts << ","
+           << s.replays << ","
+           << s.applied << "\n";
+    }
+    os.flags(flags);
+}
+
+void db::sampler::write_json(std::ostream& os) const
+{
+    db::json_writer writer(os);
+    writer.begin_array();
+    for (const auto& s : samples_)
+    {
+        writer.begin_object();
+        writer.member("time", s.time);
+        writer.member("interval", s.interval);
+        writer.member("server", s.server);
+        writer.member("commits", s.commits);
+        writer.member("rollbacks", s.rollbacks);
+        writer.member("bf_aborts", s.bf_aborts);
+        writer.member("replays", s.replays);
+        writer.member("applied", s.applied);
+        writer.end_object();
+    }
+    writer.end_array();
+}
+
+void db::sampler::run()
+{
+    wsrep::unique_lock<wsrep::default_mutex> lock(mutex_);
+    clock::time_point next(start_ + interval_);
+    while (stop_ == false)
+    {
+        // Condition variable waits on the system clock, the deadline
+        // is converted from the steady clock on every round.
+        const auto remaining(next - clock::now());
+        if (remaining > clock::duration::zero())
+        {
+            const auto abs(std::chrono::system_clock::now() + remaining);
+            const auto ns(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              abs.time_since_epoch()).count());
+            struct timespec abstime;
+            abstime.tv_sec = ns / 1000000000;
+            abstime.tv_nsec = ns % 1000000000;
+            cond_.timedwait(lock, abstime);
+            continue;
+        }
+        take_sample(clock::now());
+        next += interval_;
+    }
+    take_sample(clock::now());
+}
+
+void db::sampler::take_sample(clock::time_point now)
+{
+    size_t i(0);
+    for (const auto& s : servers_)
+    {
+        const sample counters(read_counters(s.first, *s.second));
+        sample& previous(previous_[i]);
+        sample delta;
+        delta.time = std::chrono::duration<double>(now - start_).count();
+        delta.interval = std::chrono::duration<double>(now - last_).count();
+        delta.server = s.first;
+        delta.commits = counters.commits - previous.commits;
+        delta.rollbacks = counters.rollbacks - previous.rollbacks;
+        delta.bf_aborts = counters.bf_aborts - previous.bf_aborts;
+        delta.replays = counters.replays - previous.replays;
+        delta.applied = counters.applied - previous.applied;
+        samples_.push_back(delta);
+        previous = counters;
+        ++i;
+    }
+    last_ = now;
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/** @file db_sampler.hpp
+ *
+ * Periodic sampling of server counters.
+ *
+ * The sampler thread reads the counters of each server once per
+ * interval and records the differences to the previous sample, so
+ * that warm-up effects, flow control stalls and periodic hiccups
+ * are visible in the time series instead of being averaged over
+ * the whole run.
+ */
+
+#ifndef WSREP_DB_SAMPLER_HPP
+#define WSREP_DB_SAMPLER_HPP
+
+#include "wsrep/mutex.hpp"
+#include "wsrep/condition_variable.hpp"
+
+#include <boost/thread.hpp>
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace db
+{
+    class server;
+    class sampler
+    {
+    public:
+        typedef std::chrono::steady_clock clock;
+        typedef std::map<std::string, std::unique_ptr<db::server>> servers;
+
+        struct sample
+        {
+            /** End of the interval in seconds from the start of sampling */
+            double time;
+            /** Length of the interval in seconds, the last interval
+                may be shorter than the sampling interval */
+            double interval;
+            std::string server;
+            long long commits;
+            long long rollbacks;
+            long long bf_aborts;
+            long long replays;
+            long long applied;
+            sample()
+                : time()
+                , interval()
+                , server()
+                , commits()
+                , rollbacks()
+                , bf_aborts()
+                , replays()
+                , applied()
+            { }
+        };
+
+        /**
+         * @param servers Servers to sample, the set of servers must
+         *                not change while the sampler is running.
+         * @param interval Sampling interval.
+         */
+        sampler(const servers& servers, std::chrono::milliseconds interval);
+        ~sampler();
+
+        /**
+         * Start sampler thread.
+         */
+        void start();
+
+        /**
+         * Stop sampler thread. The final sample covers the time
+         * from the previous sample to the stop.
+         */
+        void stop();
+
+        const std::vector<sample>& samples() const { return samples_; }
+
+        void write_csv(std::ostream&) const;
+        void write_json(std::ostream&) const;
+    private:
+        // Return current counter values of server.
+        static sample read_counters(const std::string&, db::server&);
+        void run();
+        void take_sample(clock::time_point now);
+        const servers& servers_;
+        const std::chrono::milliseconds interval_;
+        wsrep::default_mutex mutex_;
+        wsrep::default_condition_variable cond_;
+        bool stop_;
+        boost::thread thread_;
+        clock::time_point start_;
+        clock::time_point last_;
+        // Counter values at the previous sample, in servers order
+        std::vector<sample> previous_;
+        std::vector<sample> samples_;
+    };
+}
+
+#endif // WSREP_DB_SAMPLER_HPP
@@ -22,13 +22,18 @@
 #include "db_high_priority_service.hpp"
 #include "db_client.hpp"
 #include "db_simulator.hpp"
+#include "db_json.hpp"
 
 #include "wsrep/logger.hpp"
 
+#include <algorithm>
+
 db::server::server(simulator& simulator,
                    const std::string& name,
-                   const std::string& address)
+                   const std::string& address,
+                   const db::server_placement& placement)
     : simulator_(simulator)
+    , placement_(placement)
     , storage_engine_(simulator_.params())
     , mutex_()
     , cond_()
@@ -38,41 +43,120 @@ db::server::server(simulator& simulator,
     , last_client_id_(0)
     , last_transaction_id_(0)
     , appliers_()
+    , applier_pool_()
+    , applier_clients_()
     , clients_()
     , client_threads_()
+    , latency_()
+    , counters_()
+{ }
+
+// Defined here where db::client is complete for destroying
+// the applier clients.
+db::server::~server()
 { }
 
 void db::server::applier_thread()
 {
-    wsrep::client_id client_id(last_client_id_.fetch_add(1) + 1);
-    db::client applier(*this, client_id,
+    wsrep::high_priority_service* hps(applier_service());
+    enum wsrep::provider::status ret(
+        server_state_.provider().run_applier(hps));
+    wsrep::log_info() << "Applier thread exited with error code " << ret;
+    release_applier_service(hps);
+}
+
+wsrep::high_priority_service* db::server::applier_service()
+{
+    // Called from the applier thread when it starts, both by
+    // applier_thread() and by the applier pool.
+    if (placement_.appliers.apply())
+    {
+        wsrep::log_warning() << "Failed to apply placement of applier "
+                             << "thread of server " << server_state_.name();
+    }
+    return create_applier_service();
+}
+
+wsrep::high_priority_service* db::server::create_applier_service()
+{
+    std::unique_ptr<db::client> applier(
+        new db::client(*this, next_client_id(),
                        wsrep::client_state::m_high_priority,
-                       simulator_.params());
+                       simulator_.params()));
     wsrep::client_state* cc(static_cast<wsrep::client_state*>(
-                                &applier.client_state()));
-    db::high_priority_service hps(*this, applier);
+                                &applier->client_state()));
+    wsrep::high_priority_service* hps(
+        new db::high_priority_service(*this, *applier));
     cc->open(cc->id());
     cc->before_command();
-    enum wsrep::provider::status ret(
-        server_state_.provider().run_applier(&hps));
-    wsrep::log_info() << "Applier thread exited with error code " << ret;
+    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    applier_clients_[hps] = std::move(applier);
+    return hps;
+}
+
+void db::server::release_applier_service(wsrep::high_priority_service* hps)
+{
+    std::unique_ptr<db::client> applier;
+    {
+        wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+        auto i(applier_clients_.find(hps));
+        assert(i != applier_clients_.end());
+        applier = std::move(i->second);
+        applier_clients_.erase(i);
+        latency_.merge(applier->applier_latency());
+    }
+    wsrep::client_state* cc(static_cast<wsrep::client_state*>(
+                                &applier->client_state()));
     cc->after_command_before_result();
     cc->after_command_after_result();
     cc->close();
     cc->cleanup();
+    delete hps;
 }
 
 void db::server::start_applier()
 {
+    const db::params& params(simulator_.params());
+    if (params.max_appliers > params.min_appliers)
+    {
+        wsrep::applier_pool::params pool_params;
+        pool_params.min_appliers = params.min_appliers;
+        pool_params.max_appliers = params.max_appliers;
+        applier_pool_.reset(
+            new wsrep::applier_pool(server_state_, *this, pool_params));
+        server_state_.applier_pool(applier_pool_.get());
+        if (applier_pool_->start())
+        {
+            throw wsrep::runtime_error("Failed to start applier pool");
+        }
+        return;
+    }
     wsrep::unique_lock<wsrep::mutex> lock(mutex_);
-    appliers_.push_back(boost::thread(&server::applier_thread, this));
+    for (size_t i(0); i < params.min_appliers; ++i)
+    {
+        appliers_.push_back(boost::thread(&server::applier_thread, this));
+    }
 }
 
 void db::server::stop_applier()
 {
-    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
-    appliers_.front().join();
-    appliers_.erase(appliers_.begin());
+    if (applier_pool_)
+    {
+        applier_pool_->stop();
+        server_state_.applier_pool(0);
+        applier_pool_.reset();
+        return;
+    }
+    std::vector<boost::thread> appliers;
+    {
+        wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+        appliers.swap(appliers_);
+    }
+    // Appliers take the mutex when releasing their services.
+    for (auto& i : appliers)
+    {
+        i.join();
+    }
 }
 
 
@@ -91,17 +175,119 @@ void db::server::stop_clients()
     {
         i.join();
     }
+    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
     for (const auto& i : clients_)
     {
         const struct db::client::stats& stats(i->stats());
         simulator_.stats_.commits += stats.commits;
         simulator_.stats_.rollbacks  += stats.rollbacks;
         simulator_.stats_.replays += stats.replays;
+        simulator_.stats_.tois += stats.tois;
+        simulator_.stats_.toi_failures += stats.toi_failures;
+        latency_.merge(i->latency());
+        const std::vector<db::load_step>& steps(i->load_steps());
+        load_steps_.resize(std::max(load_steps_.size(), steps.size()));
+        for (size_t step(0); step < steps.size(); ++step)
+        {
+            load_steps_[step].merge(steps[step]);
+        }
+        toi_stats_.merge(i->toi_stats());
     }
 }
 
+const db::params& db::server::params() const
+{
+    return simulator_.params();
+}
+
+const db::workload& db::server::workload() const
+{
+    return simulator_.workload();
+}
+
+db::latency_stats db::server::latency()
+{
+    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    return latency_with_appliers();
+}
+
+db::latency_stats db::server::latency_with_appliers() const
+{
+    // Appliers are released only when the server stops, include
+    // the latencies of the running ones.
+    db::latency_stats ret(latency_);
+    for (const auto& i : applier_clients_)
+    {
+        ret.merge(i.second->applier_latency());
+    }
+    return ret;
+}
+
+std::vector<db::load_step> db::server::load_steps()
+{
+    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    return load_steps_;
+}
+
+db::toi_stats db::server::toi_stats()
+{
+    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    return toi_stats_;
+}
+
+void db::server::write_results(db::json_writer& writer)
+{
+    const std::vector<wsrep::provider::status_variable> status(
+        server_state_.provider().status());
+    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    struct db::client::stats stats;
+    for (const auto& i : clients_)
+    {
+        stats.commits += i->stats().commits;
+        stats.rollbacks += i->stats().rollbacks;
+        stats.replays += i->stats().replays;
+        stats.tois += i->stats().tois;
+        stats.toi_failures += i->stats().toi_failures;
+    }
+    writer.begin_object();
+    writer.member("name", server_state_.name());
+    writer.member("provider_name", server_state_.provider().name());
+    writer.member("provider_version", server_state_.provider().version());
+    writer.key("placement");
+    placement_.write_json(writer);
+    writer.member("commits", stats.commits);
+    writer.member("rollbacks", stats.rollbacks);
+    writer.member("replays", stats.replays);
+    writer.member("tois", stats.tois);
+    writer.member("toi_failures", stats.toi_failures);
+    writer.member("bf_aborts", storage_engine_.bf_aborts());
+    writer.member("lock_waits", storage_engine_.lock_waits());
+    writer.member("lock_wait_timeouts", storage_engine_.lock_wait_timeouts());
+    writer.member("fragments_stored", storage_engine_.fragments_stored());
+    writer.member("fragments_removed", storage_engine_.fragments_removed());
+    writer.key("latency");
+    latency_with_appliers().write_json(writer);
+    if (load_steps_.empty() == false)
+    {
+        writer.key("load_steps");
+        db::load_step::write_json(writer, load_steps_);
+    }
+    writer.key("provider_status").begin_object();
+    for (const auto& sv : status)
+    {
+        writer.member(sv.name(), sv.value());
+    }
+    writer.end_object();
+    writer.end_object();
+}
+
 void db::server::client_thread(const std::shared_ptr<db::client>& client)
 {
+    if (placement_.clients.apply())
+    {
+        wsrep::log_warning() << "Failed to apply placement of client "
+                             << "thread of server " << server_state_.name();
+    }
     client->store_globals();
     client->start();
 }
@@ -127,6 +313,8 @@ void db::server::donate_sst(const std::string& req,
 
 wsrep::high_priority_service* db::server::streaming_applier_service()
 {
-    throw wsrep::not_implemented_error();
+    // Streaming appliers are released via
+    // server_service::release_high_priority_service().
+    return create_applier_service();
 }
 
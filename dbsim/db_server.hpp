@@ -22,26 +22,53 @@
 
 #include "wsrep/gtid.hpp"
 #include "wsrep/client_state.hpp"
+#include "wsrep/applier_pool.hpp"
 
 #include "db_storage_engine.hpp"
 #include "db_server_state.hpp"
 #include "db_server_service.hpp"
+#include "db_latency.hpp"
+#include "db_workload.hpp"
+#include "db_placement.hpp"
 
 #include <boost/thread.hpp>
 
+#include <atomic>
 #include <string>
 #include <memory>
+#include <map>
 
 namespace db
 {
     class simulator;
     class client;
-    class server
+    class json_writer;
+    class server : public wsrep::applier_pool::service
     {
     public:
+        /**
+         * Counters which are updated while the simulation runs,
+         * for periodic sampling.
+         */
+        struct counters
+        {
+            std::atomic<long long> commits;
+            std::atomic<long long> rollbacks;
+            std::atomic<long long> replays;
+            /** Write sets applied by high priority services */
+            std::atomic<long long> applied;
+            counters()
+                : commits(0)
+                , rollbacks(0)
+                , replays(0)
+                , applied(0)
+            { }
+        };
         server(simulator& simulator,
                const std::string& name,
-               const std::string& address);
+               const std::string& address,
+               const db::server_placement& placement);
+        ~server();
         void applier_thread();
         void start_applier();
         void stop_applier();
@@ -50,6 +77,32 @@ namespace db
         void client_thread(const std::shared_ptr<db::client>& client);
         db::storage_engine& storage_engine() { return storage_engine_; }
         db::server_state& server_state() { return server_state_; }
+        struct counters& counters() { return counters_; }
+        const db::server_placement& placement() const { return placement_; }
+        const db::params& params() const;
+        const db::workload& workload() const;
+        wsrep::client_id next_client_id()
+        {
+            return wsrep::client_id(last_client_id_.fetch_add(1) + 1);
+        }
+        /**
+         * Return latencies recorded by stopped clients and by
+         * appliers.
+         */
+        db::latency_stats latency();
+        /**
+         * Return open loop load step results of stopped clients.
+         */
+        std::vector<db::load_step> load_steps();
+        /**
+         * Return TOI stats of stopped clients.
+         */
+        db::toi_stats toi_stats();
+        /**
+         * Write results of stopped clients, storage engine counters,
+         * latencies and provider status variables as JSON object.
+         */
+        void write_results(db::json_writer&);
         wsrep::transaction_id next_transaction_id()
         {
             return wsrep::transaction_id(last_transaction_id_.fetch_add(1) + 1);
@@ -58,10 +111,16 @@ namespace db
         wsrep::client_state* local_client_state();
         void release_client_state(wsrep::client_state*);
         wsrep::high_priority_service* streaming_applier_service();
+        wsrep::high_priority_service* applier_service() override;
+        void release_applier_service(wsrep::high_priority_service*) override;
     private:
         void start_client(size_t id);
+        // Must be called with mutex_ locked.
+        db::latency_stats latency_with_appliers() const;
+        wsrep::high_priority_service* create_applier_service();
 
         db::simulator& simulator_;
+        const db::server_placement placement_;
         db::storage_engine storage_engine_;
         wsrep::default_mutex mutex_;
         wsrep::default_condition_variable cond_;
@@ -70,8 +129,15 @@ namespace db
         std::atomic<size_t> last_client_id_;
         std::atomic<size_t> last_transaction_id_;
         std::vector<boost::thread> appliers_;
+        std::unique_ptr<wsrep::applier_pool> applier_pool_;
+        std::map<wsrep::high_priority_service*,
+                 std::unique_ptr<db::client>> applier_clients_;
         std::vector<std::shared_ptr<db::client>> clients_;
         std::vector<boost::thread> client_threads_;
+        db::latency_stats latency_;
+        std::vector<db::load_step> load_steps_;
+        db::toi_stats toi_stats_;
+        struct counters counters_;
     };
 };
 
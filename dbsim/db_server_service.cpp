@@ -26,24 +26,58 @@
 
 db::server_service::server_service(db::server& server)
     : server_(server)
+    , mutex_()
+    , storage_services_()
 { }
 
+db::server_service::~server_service()
+{
+    for (auto storage_service : storage_services_)
+    {
+        delete storage_service;
+    }
+}
+
+db::storage_service* db::server_service::acquire_storage_service()
+{
+    db::storage_service* ret(0);
+    {
+        wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+        if (storage_services_.empty() == false)
+        {
+            ret = storage_services_.back();
+            storage_services_.pop_back();
+        }
+    }
+    if (ret == 0)
+    {
+        ret = new db::storage_service(server_, server_.next_client_id(),
+                                      server_.params());
+    }
+    ret->open();
+    return ret;
+}
+
 wsrep::storage_service* db::server_service::storage_service(
     wsrep::client_service&)
 {
-    return new db::storage_service();
+    return acquire_storage_service();
 }
 
 wsrep::storage_service* db::server_service::storage_service(
     wsrep::high_priority_service&)
 {
-    return new db::storage_service();
+    return acquire_storage_service();
 }
 
 void db::server_service::release_storage_service(
     wsrep::storage_service* storage_service)
 {
-    delete storage_service;
+    db::storage_service* ss(static_cast<db::storage_service*>(
+                                storage_service));
+    ss->close();
+    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    storage_services_.push_back(ss);
 }
 
 wsrep::high_priority_service* db::server_service::streaming_applier_service(
@@ -61,7 +95,7 @@ wsrep::high_priority_service* db::server_service::streaming_applier_service(
 void db::server_service::release_high_priority_service(
     wsrep::high_priority_service *high_priority_service)
 {
-    delete high_priority_service;
+    server_.release_applier_service(high_priority_service);
 }
 
 bool db::server_service::sst_before_init() const
@@ -21,15 +21,20 @@
 #define WSREP_DB_SERVER_SERVICE_HPP
 
 #include "wsrep/server_service.hpp"
+#include "wsrep/mutex.hpp"
+
 #include <string>
+#include <vector>
 
 namespace db
 {
     class server;
+    class storage_service;
     class server_service : public wsrep::server_service
     {
     public:
         server_service(db::server& server);
+        ~server_service();
         wsrep::storage_service* storage_service(wsrep::client_service&) override;
         wsrep::storage_service* storage_service(wsrep::high_priority_service&) override;
 
@@ -58,7 +63,11 @@ namespace db
         int wait_committing_transactions(int) override;
         void debug_sync(const char*) override;
     private:
+        db::storage_service* acquire_storage_service();
         db::server& server_;
+        wsrep::default_mutex mutex_;
+        // Released storage services for reuse
+        std::vector<db::storage_service*> storage_services_;
     };
 }
 
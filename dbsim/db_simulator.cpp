@@ -19,10 +19,13 @@
 
 #include "db_simulator.hpp"
 #include "db_client.hpp"
+#include "db_json.hpp"
 
 #include "wsrep/logger.hpp"
 
 #include <boost/filesystem.hpp>
+#include <algorithm>
+#include <fstream>
 #include <sstream>
 
 void db::simulator::run()
@@ -80,9 +83,18 @@ std::string db::simulator::stats() const
                       clients_stop_ - clients_start_).count());
     long long transactions(stats_.commits + stats_.rollbacks);
     long long bf_aborts(0);
+    long long lock_waits(0);
+    long long lock_wait_timeouts(0);
+    long long fragments_stored(0);
+    long long fragments_removed(0);
     for (const auto& s : servers_)
     {
-        bf_aborts += s.second->storage_engine().bf_aborts();
+        const db::storage_engine& se(s.second->storage_engine());
+        bf_aborts += se.bf_aborts();
+        lock_waits += se.lock_waits();
+        lock_wait_timeouts += se.lock_wait_timeouts();
+        fragments_stored += se.fragments_stored();
+        fragments_removed += se.fragments_removed();
     }
     std::ostringstream os;
     os << "Number of transactions: " << transactions
@@ -94,14 +106,143 @@ std::string db::simulator::stats() const
        << "BF aborts: "
        << bf_aborts
        << "\n"
+       << "Row lock waits: " << lock_waits
+       << "\n"
+       << "Row lock wait timeouts: " << lock_wait_timeouts
+       << "\n"
+       << "SR fragments stored: " << fragments_stored
+       << "\n"
+       << "SR fragments removed: " << fragments_removed
+       << "\n"
        << "Client commits: " << stats_.commits
        << "\n"
        << "Client rollbacks: " << stats_.rollbacks
        << "\n"
-       << "Client replays: " << stats_.replays;
+       << "Client replays: " << stats_.replays
+       << "\n"
+       << "TOI operations: " << stats_.tois
+       << "\n"
+       << "TOI failures: " << stats_.toi_failures;
+    for (const auto& s : servers_)
+    {
+        os << "\nLatencies for server " << s.first << " (us):\n";
+        s.second->latency().report(os);
+    }
+    os << "\nLatencies for all servers (us):\n";
+    latency().report(os);
+    if (params_.toi_ratio > 0)
+    {
+        db::toi_stats toi_stats;
+        for (const auto& s : servers_)
+        {
+            toi_stats.merge(s.second->toi_stats());
+        }
+        os << "\nDML around TOI operations (tps, latency us):\n";
+        toi_stats.report(os);
+    }
+    if (params_.rate > 0)
+    {
+        const std::vector<db::load_step> steps(load_steps());
+        os << "\nOpen loop load steps (tps, latency us):\n";
+        db::load_step::report(os, steps);
+        // The first step where the achieved rate falls clearly behind
+        // the target is past the saturation knee.
+        auto knee(std::find_if(steps.begin(), steps.end(),
+                               [](const db::load_step& step)
+                               {
+                                   return (step.achieved_rate <
+                                           0.95 * step.target_rate);
+                               }));
+        if (knee != steps.end())
+        {
+            os << "Saturated at step " << (knee - steps.begin() + 1)
+               << ", target rate " << knee->target_rate << " tps";
+        }
+        else
+        {
+            os << "Not saturated";
+        }
+    }
     return os.str();
 }
 
+void db::simulator::write_results(std::ostream& os) const
+{
+    const db::params& p(params_);
+    db::json_writer writer(os);
+    writer.begin_object();
+    writer.key("params").begin_object();
+    writer.member("servers", p.n_servers);
+    writer.member("topology", p.topology);
+    writer.member("clients", p.n_clients);
+    writer.member("transactions", p.n_transactions);
+    writer.member("rows", p.n_rows);
+    writer.member("alg_freq", p.alg_freq);
+    writer.member("lock_wait_timeout", p.lock_wait_timeout);
+    writer.member("distribution", p.distribution);
+    writer.member("zipf_theta", p.zipf_theta);
+    writer.member("hotspot_rows", p.hotspot_rows);
+    writer.member("hotspot_access_ratio", p.hotspot_access_ratio);
+    writer.member("min_rows_per_transaction", p.min_rows_per_transaction);
+    writer.member("max_rows_per_transaction", p.max_rows_per_transaction);
+    writer.member("read_ratio", p.read_ratio);
+    writer.member("shared_key_ratio", p.shared_key_ratio);
+    writer.member("min_payload", p.min_payload);
+    writer.member("max_payload", p.max_payload);
+    writer.member("2pc_ratio", p.two_pc_ratio);
+    writer.member("seed", p.seed);
+    writer.member("rate", p.rate);
+    writer.member("arrival", p.arrival);
+    writer.member("ramp_steps", p.ramp_steps);
+    writer.member("large_transaction_ratio", p.large_transaction_ratio);
+    writer.member("large_transaction_rows", p.large_transaction_rows);
+    writer.member("sr_fragment_unit", p.sr_fragment_unit);
+    writer.member("sr_fragment_size", p.sr_fragment_size);
+    writer.member("toi_ratio", p.toi_ratio);
+    writer.member("toi_key_scope", p.toi_key_scope);
+    writer.member("toi_duration", p.toi_duration);
+    writer.member("min_appliers", p.min_appliers);
+    writer.member("max_appliers", p.max_appliers);
+    writer.member("wsrep_provider", p.wsrep_provider);
+    writer.member("wsrep_provider_options", p.wsrep_provider_options);
+    writer.member("client_cpus", p.client_cpus);
+    writer.member("applier_cpus", p.applier_cpus);
+    writer.member("provider_cpus", p.provider_cpus);
+    writer.member("numa_nodes", p.numa_nodes);
+    writer.end_object();
+
+    auto duration(std::chrono::duration<double>(
+                      clients_stop_ - clients_start_).count());
+    long long transactions(stats_.commits + stats_.rollbacks);
+    writer.key("results").begin_object();
+    writer.member("transactions", transactions);
+    writer.member("seconds", duration);
+    writer.member("transactions_per_second", transactions/duration);
+    writer.member("commits_per_second", stats_.commits/duration);
+    writer.member("commits", stats_.commits);
+    writer.member("rollbacks", stats_.rollbacks);
+    writer.member("replays", stats_.replays);
+    writer.member("tois", stats_.tois);
+    writer.member("toi_failures", stats_.toi_failures);
+    writer.end_object();
+
+    writer.key("latency");
+    latency().write_json(writer);
+    if (params_.rate > 0)
+    {
+        writer.key("load_steps");
+        db::load_step::write_json(writer, load_steps());
+    }
+
+    writer.key("servers").begin_array();
+    for (const auto& s : servers_)
+    {
+        s.second->write_results(writer);
+    }
+    writer.end_array();
+    writer.end_object();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //                              Private                                       //
 ////////////////////////////////////////////////////////////////////////////////
@@ -121,13 +262,27 @@ void db::simulator::start()
         std::ostringstream address_os;
         address_os << "127.0.0.1:" << server_port(i);
         wsrep::id server_id(id_os.str());
+        const db::server_placement placement(
+            db::server_placement::create(params_, i));
+        log_placement(name_os.str(), placement);
+        // Provider threads inherit the placement of the thread which
+        // loads and connects the provider. The server is also
+        // constructed under the provider placement to allocate its
+        // memory from the NUMA node of the server.
+        const db::placement main_placement(db::placement::current());
+        if (placement.provider.apply())
+        {
+            wsrep::log_warning() << "Failed to apply provider placement "
+                                 << "of server " << name_os.str();
+        }
         auto it(servers_.insert(
                     std::make_pair(
                         name_os.str(),
                         std::make_unique<db::server>(
                             *this,
                             name_os.str(),
-                            address_os.str()))));
+                            address_os.str(),
+                            placement))));
         if (it.second == false)
         {
             throw wsrep::runtime_error("Failed to add server");
@@ -159,11 +314,22 @@ void db::simulator::start()
         server.server_state().wait_until_state(
             wsrep::server_state::s_synced);
         wsrep::log_debug() << "main: Server synced";
+        if (placement.provider.empty() == false && main_placement.apply())
+        {
+            wsrep::log_warning() << "Failed to restore main thread placement";
+        }
     }
 
     // Start client threads
     wsrep::log_info() << "####################### Starting client load";
     clients_start_ = std::chrono::steady_clock::now();
+    if (params_.sample_interval > 0)
+    {
+        sampler_.reset(new db::sampler(
+                           servers_,
+                           std::chrono::milliseconds(params_.sample_interval)));
+        sampler_->start();
+    }
     size_t index(0);
     for (auto& i : servers_)
     {
@@ -183,9 +349,39 @@ void db::simulator::stop()
         server.stop_clients();
     }
     clients_stop_ = std::chrono::steady_clock::now();
+    if (sampler_)
+    {
+        sampler_->stop();
+        std::ofstream ofs(params_.samples_file.c_str());
+        if (params_.samples_format == "json")
+        {
+            sampler_->write_json(ofs);
+        }
+        else
+        {
+            sampler_->write_csv(ofs);
+        }
+        if (!ofs)
+        {
+            wsrep::log_error() << "Failed to write samples to "
+                               << params_.samples_file;
+        }
+    }
     wsrep::log_info() << "######## Stats ############";
     wsrep::log_info()  << stats();
     wsrep::log_info() << "######## Stats ############";
+    // Results are written before fast exit and before the servers
+    // are disconnected to capture the provider status.
+    if (params_.results_file.size())
+    {
+        std::ofstream ofs(params_.results_file.c_str());
+        write_results(ofs);
+        if (!ofs)
+        {
+            wsrep::log_error() << "Failed to write results to "
+                               << params_.results_file;
+        }
+    }
     if (params_.fast_exit)
     {
         exit(0);
@@ -209,6 +405,50 @@ void db::simulator::stop()
     }
 }
 
+db::latency_stats db::simulator::latency() const
+{
+    db::latency_stats ret;
+    for (const auto& s : servers_)
+    {
+        ret.merge(s.second->latency());
+    }
+    return ret;
+}
+
+std::vector<db::load_step> db::simulator::load_steps() const
+{
+    std::vector<db::load_step> ret;
+    for (const auto& s : servers_)
+    {
+        const std::vector<db::load_step> server_steps(
+            s.second->load_steps());
+        ret.resize(std::max(ret.size(), server_steps.size()));
+        for (size_t i(0); i < server_steps.size(); ++i)
+        {
+            ret[i].merge(server_steps[i]);
+        }
+    }
+    return ret;
+}
+
+void db::simulator::log_placement(const std::string& name,
+                                  const db::server_placement& placement)
+{
+    if (placement.clients.empty() && placement.appliers.empty() &&
+        placement.provider.empty())
+    {
+        return;
+    }
+    wsrep::log_info() << "Server " << name << " placement:"
+                      << " NUMA node: " << placement.numa_node
+                      << " client CPUs: "
+                      << db::placement::to_cpu_list(placement.clients.cpus())
+                      << " applier CPUs: "
+                      << db::placement::to_cpu_list(placement.appliers.cpus())
+                      << " provider CPUs: "
+                      << db::placement::to_cpu_list(placement.provider.cpus());
+}
+
 std::string db::simulator::server_port(size_t i) const
 {
     std::ostringstream os;
@@ -26,6 +26,8 @@
 
 #include "db_params.hpp"
 #include "db_server.hpp"
+#include "db_workload.hpp"
+#include "db_sampler.hpp"
 
 #include <memory>
 #include <chrono>
@@ -41,7 +43,9 @@ namespace db
         simulator(const params& params)
             : mutex_()
             , params_(params)
+            , workload_(params)
             , servers_()
+            , sampler_()
             , clients_start_()
             , clients_stop_()
             , stats_()
@@ -52,16 +56,28 @@ namespace db
                  const std::string&, const wsrep::gtid&, bool);
         const db::params& params() const
         { return params_; }
+        const db::workload& workload() const
+        { return workload_; }
         std::string stats() const;
+        /**
+         * Write parameters and results in JSON format.
+         */
+        void write_results(std::ostream&) const;
     private:
         void start();
         void stop();
+        db::latency_stats latency() const;
+        std::vector<db::load_step> load_steps() const;
+        static void log_placement(const std::string& name,
+                                  const db::server_placement&);
         std::string server_port(size_t i) const;
         std::string build_cluster_address() const;
 
         wsrep::default_mutex mutex_;
         const db::params& params_;
+        db::workload workload_;
         std::map<std::string, std::unique_ptr<db::server>> servers_;
+        std::unique_ptr<db::sampler> sampler_;
         std::chrono::time_point<std::chrono::steady_clock> clients_start_;
         std::chrono::time_point<std::chrono::steady_clock> clients_stop_;
     public:
@@ -70,10 +86,14 @@ namespace db
             long long commits;
             long long rollbacks;
             long long replays;
+            long long tois;
+            long long toi_failures;
             stats()
                 : commits(0)
                 , rollbacks(0)
                 , replays(0)
+                , tois(0)
+                , toi_failures(0)
             { }
         } stats_;
     };
@@ -20,30 +20,171 @@
 #include "db_storage_engine.hpp"
 #include "db_client.hpp"
 
-void db::storage_engine::transaction::start(db::client* cc)
+#include <chrono>
+#include <sstream>
+#include <utility>
+
+#include <sys/time.h>
+
+namespace
 {
-    wsrep::unique_lock<wsrep::mutex> lock(se_.mutex_);
-    if (se_.transactions_.insert(cc).second == false)
+    const size_t n_shards = 64;
+    const size_t n_registry_shards = 16;
+
+    // Interval at which a local transaction waiting for a row lock
+    // checks if it has been BF aborted.
+    const long bf_abort_poll_ms = 1;
+
+    struct timespec abstime_after_ms(long ms)
     {
-        ::abort();
+        struct timeval now;
+        gettimeofday(&now, 0);
+        long nsec(now.tv_usec * 1000 + ms * 1000000);
+        struct timespec ret;
+        ret.tv_sec = now.tv_sec + nsec / 1000000000;
+        ret.tv_nsec = nsec % 1000000000;
+        return ret;
+    }
+}
+
+db::storage_engine::storage_engine(const params& params)
+    : registry_()
+    , shards_()
+    , alg_freq_(params.alg_freq)
+    , alg_counter_()
+    , lock_wait_timeout_(params.lock_wait_timeout)
+    , bf_aborts_()
+    , lock_waits_()
+    , lock_wait_timeouts_()
+    , fragments_mutex_()
+    , fragments_()
+    , fragments_stored_()
+    , fragments_removed_()
+    , position_mutex_()
+    , position_()
+    , view_()
+{
+    for (size_t i(0); i < n_registry_shards; ++i)
+    {
+        registry_.push_back(
+            std::unique_ptr<registry_shard>(new registry_shard));
+    }
+    for (size_t i(0); i < n_shards; ++i)
+    {
+        shards_.push_back(std::unique_ptr<shard>(new shard));
     }
+}
+
+void db::storage_engine::transaction::start(db::client* cc)
+{
+    se_.register_transaction(cc);
     cc_ = cc;
+    bf_aborted_ = false;
+}
+
+long long db::storage_engine::transaction::read(unsigned long long row_id,
+                                                std::string& value)
+{
+    assert(cc_);
+    shard& s(se_.shard_of(row_id));
+    wsrep::unique_lock<wsrep::mutex> lock(s.mutex);
+    auto r(s.rows.find(row_id));
+    auto w(writes_.find(row_id));
+    if (w != writes_.end())
+    {
+        value = w->second;
+    }
+    else if (r != s.rows.end())
+    {
+        value = r->second.value;
+    }
+    else
+    {
+        value.clear();
+    }
+    return (r == s.rows.end() ? 0 : r->second.version);
 }
 
-void db::storage_engine::transaction::apply(
-    const wsrep::transaction& transaction)
+int db::storage_engine::transaction::write(unsigned long long row_id,
+                                           const std::string& value)
 {
     assert(cc_);
+    auto i(writes_.find(row_id));
+    if (i == writes_.end())
+    {
+        shard& s(se_.shard_of(row_id));
+        wsrep::unique_lock<wsrep::mutex> lock(s.mutex);
+        if (se_.lock_row(lock, s, s.rows[row_id], *this))
+        {
+            return 1;
+        }
+        writes_.insert(std::make_pair(row_id, value));
+    }
+    else
+    {
+        i->second = value;
+    }
+    return 0;
+}
+
+int db::storage_engine::transaction::apply(
+    const wsrep::transaction& transaction,
+    const wsrep::const_buffer& data)
+{
+    assert(cc_);
+    std::vector<std::pair<unsigned long long, std::string>> writes;
+    if (decode_writes(data, writes))
+    {
+        return 1;
+    }
+    for (const auto& w : writes)
+    {
+        if (write(w.first, w.second))
+        {
+            return 1;
+        }
+    }
     se_.bf_abort_some(transaction);
+    return 0;
+}
+
+void db::storage_engine::transaction::append_fragment(
+    const wsrep::id& server_id,
+    wsrep::transaction_id transaction_id,
+    wsrep::seqno seqno,
+    const wsrep::const_buffer& data)
+{
+    assert(cc_);
+    assert(seqno.is_undefined() == false);
+    fragment_op op;
+    op.server_id = server_id;
+    op.transaction_id = transaction_id;
+    op.seqno = seqno;
+    op.data.assign(data.data(), data.size());
+    fragment_ops_.push_back(op);
+}
+
+void db::storage_engine::transaction::remove_fragments(
+    const wsrep::id& server_id,
+    wsrep::transaction_id transaction_id)
+{
+    assert(cc_);
+    fragment_op op;
+    op.server_id = server_id;
+    op.transaction_id = transaction_id;
+    fragment_ops_.push_back(op);
 }
 
 void db::storage_engine::transaction::commit(const wsrep::gtid& gtid)
 {
     if (cc_)
     {
-        wsrep::unique_lock<wsrep::mutex> lock(se_.mutex_);
-        se_.transactions_.erase(cc_);
-        se_.store_position(gtid);
+        release(&gtid);
+        se_.unregister_transaction(cc_);
+        if (gtid.seqno().is_undefined() == false)
+        {
+            se_.store_position(gtid);
+        }
     }
     cc_ = nullptr;
 }
@@ -53,43 +194,221 @@ void db::storage_engine::transaction::rollback()
 {
     if (cc_)
     {
-        wsrep::unique_lock<wsrep::mutex> lock(se_.mutex_);
-        se_.transactions_.erase(cc_);
+        release(nullptr);
+        se_.unregister_transaction(cc_);
     }
     cc_ = nullptr;
 }
 
+void db::storage_engine::transaction::release(const wsrep::gtid* gtid)
+{
+    for (const auto& w : writes_)
+    {
+        shard& s(se_.shard_of(w.first));
+        wsrep::unique_lock<wsrep::mutex> lock(s.mutex);
+        row& r(s.rows[w.first]);
+        assert(r.owner == this);
+        if (gtid)
+        {
+            r.version = gtid->seqno().get();
+            r.value = w.second;
+        }
+        r.owner = nullptr;
+        s.cond.notify_all();
+    }
+    writes_.clear();
+    if (gtid)
+    {
+        se_.apply_fragment_ops(fragment_ops_);
+    }
+    fragment_ops_.clear();
+}
+
+void db::storage_engine::apply_fragment_ops(
+    const std::vector<transaction::fragment_op>& ops)
+{
+    if (ops.empty()) return;
+    wsrep::unique_lock<wsrep::mutex> lock(fragments_mutex_);
+    for (const auto& op : ops)
+    {
+        auto key(std::make_pair(op.server_id, op.transaction_id));
+        if (op.seqno.is_undefined())
+        {
+            auto i(fragments_.find(key));
+            if (i != fragments_.end())
+            {
+                fragments_removed_ += i->second.size();
+                fragments_.erase(i);
+            }
+        }
+        else
+        {
+            fragments_[key][op.seqno] = op.data;
+            ++fragments_stored_;
+        }
+    }
+}
+
+void db::storage_engine::fragments(const wsrep::id& server_id,
+                                   wsrep::transaction_id transaction_id,
+                                   std::vector<std::string>& data) const
+{
+    wsrep::unique_lock<wsrep::mutex> lock(fragments_mutex_);
+    auto i(fragments_.find(std::make_pair(server_id, transaction_id)));
+    if (i != fragments_.end())
+    {
+        for (const auto& f : i->second)
+        {
+            data.push_back(f.second);
+        }
+    }
+}
+
+int db::storage_engine::lock_row(wsrep::unique_lock<wsrep::mutex>& lock,
+                                 shard& s, row& r, transaction& trx)
+{
+    wsrep::client_state& cs(trx.cc_->client_state());
+    if (cs.mode() == wsrep::client_state::m_high_priority)
+    {
+        if (r.owner)
+        {
+            ++lock_waits_;
+            ++r.bf_waiters;
+            while (r.owner)
+            {
+                transaction* holder(r.owner);
+                wsrep::client_state& holder_cs(holder->cc_->client_state());
+                if (holder->bf_aborted_ == false &&
+                    holder_cs.mode() == wsrep::client_state::m_local &&
+                    holder->cc_->bf_abort(cs.transaction().seqno()))
+                {
+                    ++bf_aborts_;
+                    holder->bf_aborted_ = true;
+                }
+                s.cond.wait(lock);
+            }
+            --r.bf_waiters;
+        }
+    }
+    else if (r.owner || r.bf_waiters)
+    {
+        ++lock_waits_;
+        const auto deadline(std::chrono::steady_clock::now() +
+                            std::chrono::milliseconds(lock_wait_timeout_));
+        while (r.owner || r.bf_waiters)
+        {
+            if (trx.bf_aborted_)
+            {
+                return 1;
+            }
+            if (std::chrono::steady_clock::now() >= deadline)
+            {
+                ++lock_wait_timeouts_;
+                return 1;
+            }
+            s.cond.timedwait(lock, abstime_after_ms(bf_abort_poll_ms));
+        }
+    }
+    r.owner = &trx;
+    return 0;
+}
+
+void db::storage_engine::encode_write(std::string& buf,
+                                      unsigned long long row,
+                                      const std::string& value)
+{
+    std::ostringstream os;
+    os << row << " " << value.size() << " ";
+    buf += os.str();
+    buf += value;
+}
+
+int db::storage_engine::decode_writes(
+    const wsrep::const_buffer& data,
+    std::vector<std::pair<unsigned long long, std::string>>& writes)
+{
+    std::istringstream is(std::string(data.data(), data.size()));
+    unsigned long long row;
+    size_t size;
+    while (is >> row >> size)
+    {
+        std::string value(size, '\0');
+        if (is.get() != ' ' || !is.read(&value[0], size))
+        {
+            return 1;
+        }
+        writes.push_back(std::make_pair(row, value));
+    }
+    return (is.eof() ? 0 : 1);
+}
+
 void db::storage_engine::bf_abort_some(const wsrep::transaction& txc)
 {
-    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
-    if (alg_freq_ && (std::rand() % alg_freq_) == 0)
+    if (alg_freq_ == 0)
     {
-        if (transactions_.empty() == false)
+        return;
+    }
+    size_t const count(
+        alg_counter_.fetch_add(1, std::memory_order_relaxed) + 1);
+    if (count % alg_freq_)
+    {
+        return;
+    }
+    // Start the victim search from a different registry shard
+    // each time to spread the aborts over clients.
+    size_t const start(count / alg_freq_);
+    for (size_t i(0); i < registry_.size(); ++i)
+    {
+        registry_shard& rs(*registry_[(start + i) % registry_.size()]);
+        wsrep::unique_lock<wsrep::mutex> lock(rs.mutex);
+        for (auto victim : rs.transactions)
         {
-            for (auto victim : transactions_)
+            wsrep::client_state& cc(victim->client_state());
+            if (cc.mode() == wsrep::client_state::m_local)
             {
-                wsrep::client_state& cc(victim->client_state());
-                if (cc.mode() == wsrep::client_state::m_local)
+                if (victim->bf_abort(txc.seqno()))
                 {
-                    if (victim->bf_abort(txc.seqno()))
-                    {
-                        ++bf_aborts_;
-                    }
-                    break;
+                    ++bf_aborts_;
                 }
+                return;
             }
         }
     }
 }
 
+db::storage_engine::registry_shard&
+db::storage_engine::registry_shard_of(db::client* cc)
+{
+    return *registry_[cc->client_state().id().get() % registry_.size()];
+}
+
+void db::storage_engine::register_transaction(db::client* cc)
+{
+    registry_shard& rs(registry_shard_of(cc));
+    wsrep::unique_lock<wsrep::mutex> lock(rs.mutex);
+    if (rs.transactions.insert(cc).second == false)
+    {
+        ::abort();
+    }
+}
+
+void db::storage_engine::unregister_transaction(db::client* cc)
+{
+    registry_shard& rs(registry_shard_of(cc));
+    wsrep::unique_lock<wsrep::mutex> lock(rs.mutex);
+    rs.transactions.erase(cc);
+}
+
 void db::storage_engine::store_position(const wsrep::gtid& gtid)
 {
+    wsrep::unique_lock<wsrep::mutex> lock(position_mutex_);
     validate_position(gtid);
     position_ = gtid;
 }
 
 wsrep::gtid db::storage_engine::get_position() const
 {
+    wsrep::unique_lock<wsrep::mutex> lock(position_mutex_);
     return position_;
 }
 
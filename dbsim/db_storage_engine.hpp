@@ -23,25 +23,43 @@
 #include "db_params.hpp"
 
 #include "wsrep/mutex.hpp"
+#include "wsrep/condition_variable.hpp"
 #include "wsrep/client_state.hpp"
 
 #include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 namespace db
 {
     class client;
+    /**
+     * In-memory row store.
+     *
+     * Rows are identified by a row number and hold a value and
+     * a version, which is the seqno of the transaction which
+     * last committed the row. Writes take an exclusive row lock and
+     * are buffered in the transaction until commit. Reads do not
+     * lock and see the last committed version of the row.
+     *
+     * A local transaction waiting for a row lock gives up after
+     * lock wait timeout. A high priority transaction waiting for
+     * a row lock held by a local transaction BF aborts the lock
+     * holder. Local transactions may not acquire row locks which
+     * high priority transactions are waiting for.
+     *
+     * The storage engine also stores streaming replication fragments.
+     * Fragments are appended and removed as part of a transaction
+     * and the changes become visible when the transaction commits.
+     */
     class storage_engine
     {
     public:
-        storage_engine(const params& params)
-            : mutex_()
-            , transactions_()
-            , alg_freq_(params.alg_freq)
-            , bf_aborts_()
-            , position_()
-            , view_()
-        { }
+        storage_engine(const params& params);
 
         class transaction
         {
@@ -49,6 +67,9 @@ namespace db
             transaction(storage_engine& se)
                 : se_(se)
                 , cc_()
+                , writes_()
+                , fragment_ops_()
+                , bf_aborted_()
             { }
             ~transaction()
             {
@@ -56,28 +77,157 @@ namespace db
             }
             bool active() const { return cc_ != nullptr; }
             void start(client* cc);
-            void apply(const wsrep::transaction&);
+            /**
+             * Read the value of a row. Returns the value written
+             * by this transaction or the last committed value.
+             *
+             * @return Version of the row, zero if the row has not
+             *         been written.
+             */
+            long long read(unsigned long long row, std::string& value);
+            /**
+             * Lock a row and buffer the write.
+             *
+             * @return Zero on success, non-zero if the lock could
+             *         not be acquired because of lock wait timeout
+             *         or the transaction was BF aborted.
+             */
+            int write(unsigned long long row, const std::string& value);
+            /**
+             * Apply writes from the write set data.
+             */
+            int apply(const wsrep::transaction&,
+                      const wsrep::const_buffer& data);
+            /**
+             * Store a streaming replication fragment when the
+             * transaction commits.
+             */
+            void append_fragment(const wsrep::id& server_id,
+                                 wsrep::transaction_id transaction_id,
+                                 wsrep::seqno seqno,
+                                 const wsrep::const_buffer& data);
+            /**
+             * Remove stored fragments of a streaming transaction when
+             * the transaction commits.
+             */
+            void remove_fragments(const wsrep::id& server_id,
+                                  wsrep::transaction_id transaction_id);
+            /**
+             * Commit the transaction. The position is not updated if
+             * the GTID is undefined.
+             */
             void commit(const wsrep::gtid&);
             void rollback();
             db::client* client() { return cc_; }
             transaction(const transaction&) = delete;
             transaction& operator=(const transaction&) = delete;
         private:
+            friend class storage_engine;
+            void release(const wsrep::gtid*);
             db::storage_engine& se_;
             db::client* cc_;
+            struct fragment_op
+            {
+                wsrep::id server_id;
+                wsrep::transaction_id transaction_id;
+                // Undefined seqno for removal
+                wsrep::seqno seqno;
+                std::string data;
+            };
+            std::map<unsigned long long, std::string> writes_;
+            std::vector<fragment_op> fragment_ops_;
+            std::atomic<bool> bf_aborted_;
         };
+
+        /**
+         * Append a row write into write set data buffer.
+         */
+        static void encode_write(std::string& buf,
+                                 unsigned long long row,
+                                 const std::string& value);
+        /**
+         * Decode row writes from write set data.
+         *
+         * @return Zero on success, non-zero if the data is malformed.
+         */
+        static int decode_writes(
+            const wsrep::const_buffer& data,
+            std::vector<std::pair<unsigned long long, std::string>>&);
+
         void bf_abort_some(const wsrep::transaction& tc);
         long long bf_aborts() const { return bf_aborts_; }
+        long long lock_waits() const { return lock_waits_; }
+        long long lock_wait_timeouts() const { return lock_wait_timeouts_; }
+        /**
+         * Return data of committed fragments of a streaming
+         * transaction in seqno order.
+         */
+        void fragments(const wsrep::id& server_id,
+                       wsrep::transaction_id transaction_id,
+                       std::vector<std::string>& data) const;
+        long long fragments_stored() const { return fragments_stored_; }
+        long long fragments_removed() const { return fragments_removed_; }
         void store_position(const wsrep::gtid& gtid);
         wsrep::gtid get_position() const;
         void store_view(const wsrep::view& view);
         wsrep::view get_view() const;
     private:
+        struct row
+        {
+            row()
+                : owner()
+                , bf_waiters()
+                , version()
+                , value()
+            { }
+            transaction* owner;
+            size_t bf_waiters;
+            long long version;
+            std::string value;
+        };
+        struct shard
+        {
+            shard() : mutex(), cond(), rows() { }
+            wsrep::default_mutex mutex;
+            wsrep::default_condition_variable cond;
+            std::unordered_map<unsigned long long, row> rows;
+        };
+        shard& shard_of(unsigned long long row)
+        {
+            return *shards_[row % shards_.size()];
+        }
+        // Registry of active transactions, sharded by client id.
+        struct registry_shard
+        {
+            registry_shard() : mutex(), transactions() { }
+            wsrep::default_mutex mutex;
+            std::unordered_set<db::client*> transactions;
+        };
+        registry_shard& registry_shard_of(db::client*);
+        void register_transaction(db::client*);
+        void unregister_transaction(db::client*);
+        int lock_row(wsrep::unique_lock<wsrep::mutex>&, shard&, row&,
+                     transaction&);
+        void apply_fragment_ops(const std::vector<transaction::fragment_op>&);
         void validate_position(const wsrep::gtid& gtid) const;
-        wsrep::default_mutex mutex_;
-        std::unordered_set<db::client*> transactions_;
+        std::vector<std::unique_ptr<registry_shard>> registry_;
+        std::vector<std::unique_ptr<shard>> shards_;
         size_t alg_freq_;
+        // Number of applied write sets
+        std::atomic<size_t> alg_counter_;
+        long long lock_wait_timeout_;
         std::atomic<long long> bf_aborts_;
+        std::atomic<long long> lock_waits_;
+        std::atomic<long long> lock_wait_timeouts_;
+        mutable wsrep::default_mutex fragments_mutex_;
+        // Stored fragments by server id and transaction id
+        std::map<std::pair<wsrep::id, wsrep::transaction_id>,
+                 std::map<wsrep::seqno, std::string>> fragments_;
+        std::atomic<long long> fragments_stored_;
+        std::atomic<long long> fragments_removed_;
+        // Protects position_, validation and store must be atomic
+        // with respect to each other.
+        mutable wsrep::default_mutex position_mutex_;
         wsrep::gtid position_;
         wsrep::view view_;
     };
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "db_storage_service.hpp"
+#include "db_server.hpp"
+
+db::storage_service::storage_service(db::server& server,
+                                     wsrep::client_id client_id,
+                                     const db::params& params)
+    : client_(server, client_id, wsrep::client_state::m_high_priority,
+              params)
+    , fragment_server_id_()
+    , fragment_transaction_id_()
+    , fragment_()
+    , fragment_appended_()
+{ }
+
+void db::storage_service::open()
+{
+    wsrep::client_state& cs(client_.client_state());
+    cs.open(cs.id());
+    cs.before_command();
+}
+
+void db::storage_service::close()
+{
+    client_.se_trx_.rollback();
+    wsrep::client_state& cs(client_.client_state());
+    cs.after_command_before_result();
+    cs.after_command_after_result();
+    cs.close();
+    cs.cleanup();
+}
+
+int db::storage_service::start_transaction(const wsrep::ws_handle& ws_handle)
+{
+    int ret(client_.client_state().start_transaction(
+                ws_handle.transaction_id()));
+    client_.se_trx_.start(&client_);
+    return ret;
+}
+
+void db::storage_service::adopt_transaction(
+    const wsrep::transaction& transaction)
+{
+    client_.client_state().adopt_transaction(transaction);
+    client_.se_trx_.start(&client_);
+}
+
+int db::storage_service::append_fragment(const wsrep::id& server_id,
+                                         wsrep::transaction_id transaction_id,
+                                         int,
+                                         const wsrep::const_buffer& data)
+{
+    fragment_server_id_ = server_id;
+    fragment_transaction_id_ = transaction_id;
+    fragment_.assign(data.data(), data.size());
+    fragment_appended_ = true;
+    return 0;
+}
+
+int db::storage_service::update_fragment_meta(const wsrep::ws_meta& ws_meta)
+{
+    assert(fragment_appended_);
+    client_.se_trx_.append_fragment(
+        fragment_server_id_, fragment_transaction_id_, ws_meta.seqno(),
+        wsrep::const_buffer(fragment_.data(), fragment_.size()));
+    fragment_appended_ = false;
+    return 0;
+}
+
+int db::storage_service::remove_fragments()
+{
+    const wsrep::transaction& transaction(
+        client_.client_state().transaction());
+    client_.se_trx_.remove_fragments(transaction.server_id(),
+                                     transaction.id());
+    return 0;
+}
+
+int db::storage_service::commit(const wsrep::ws_handle& ws_handle,
+                                const wsrep::ws_meta& ws_meta)
+{
+    wsrep::client_state& cs(client_.client_state());
+    int ret(0);
+    if (ws_meta.ordered())
+    {
+        ret = cs.prepare_for_ordering(ws_handle, ws_meta, true) ||
+            cs.before_commit();
+        if (ret == 0)
+        {
+            client_.se_trx_.commit(ws_meta.gtid());
+        }
+        ret = ret || cs.ordered_commit() || cs.after_commit();
+    }
+    else
+    {
+        // Commit which was not ordered does not go through commit
+        // hooks, the changes are committed in the storage engine
+        // and the transaction state is cleaned up by rolling back.
+        client_.se_trx_.commit(wsrep::gtid());
+        ret = cs.before_rollback() || cs.after_rollback();
+    }
+    if (ret)
+    {
+        // Fragment storage commit may get BF aborted in the provider.
+        client_.se_trx_.rollback();
+        cs.before_rollback();
+        cs.after_rollback();
+    }
+    cs.after_applying();
+    fragment_appended_ = false;
+    return ret;
+}
+
+int db::storage_service::rollback(const wsrep::ws_handle& ws_handle,
+                                  const wsrep::ws_meta& ws_meta)
+{
+    wsrep::client_state& cs(client_.client_state());
+    int ret(cs.prepare_for_ordering(ws_handle, ws_meta, false) ||
+            cs.before_rollback());
+    client_.se_trx_.rollback();
+    ret = ret || cs.after_rollback();
+    cs.after_applying();
+    fragment_appended_ = false;
+    return ret;
+}
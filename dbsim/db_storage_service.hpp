@@ -20,33 +20,48 @@
 #ifndef WSREP_DB_STORAGE_SERVICE_HPP
 #define WSREP_DB_STORAGE_SERVICE_HPP
 
+#include "db_client.hpp"
+
 #include "wsrep/storage_service.hpp"
-#include "wsrep/exception.hpp"
 
 namespace db
 {
+    class server;
+    /**
+     * Storage service for streaming replication fragments.
+     *
+     * The storage service runs a high priority client of its own
+     * which stores fragments into the storage engine. Storage
+     * services are reused, the service is opened when it is acquired
+     * by the server service and closed when it is released.
+     */
     class storage_service : public wsrep::storage_service
     {
-        int start_transaction(const wsrep::ws_handle&) override
-        { throw wsrep::not_implemented_error(); }
-        void adopt_transaction(const wsrep::transaction&) override
-        { throw wsrep::not_implemented_error(); }
+    public:
+        storage_service(db::server&, wsrep::client_id, const db::params&);
+        void open();
+        void close();
+        int start_transaction(const wsrep::ws_handle&) override;
+        void adopt_transaction(const wsrep::transaction&) override;
         int append_fragment(const wsrep::id&,
                             wsrep::transaction_id,
                             int,
-                            const wsrep::const_buffer&) override
-        { throw wsrep::not_implemented_error(); }
-        int update_fragment_meta(const wsrep::ws_meta&) override
-        { throw wsrep::not_implemented_error(); }
-        int remove_fragments() override
-        { throw wsrep::not_implemented_error(); }
-        int commit(const wsrep::ws_handle&, const wsrep::ws_meta&) override
-        { throw wsrep::not_implemented_error(); }
+                            const wsrep::const_buffer&) override;
+        int update_fragment_meta(const wsrep::ws_meta&) override;
+        int remove_fragments() override;
+        int commit(const wsrep::ws_handle&, const wsrep::ws_meta&) override;
         int rollback(const wsrep::ws_handle&, const wsrep::ws_meta&)
-            override
-        { throw wsrep::not_implemented_error(); }
-        void store_globals() override { }
+            override;
+        void store_globals() override { client_.store_globals(); }
         void reset_globals() override { }
+    private:
+        db::client client_;
+        // Fragment appended by append_fragment(), stored with the seqno
+        // from update_fragment_meta()
+        wsrep::id fragment_server_id_;
+        wsrep::transaction_id fragment_transaction_id_;
+        std::string fragment_;
+        bool fragment_appended_;
     };
 }
 
@@ -0,0 +1,311 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "db_workload.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+    double zeta(unsigned long long n, double theta)
+    {
+        double ret(0);
+        for (unsigned long long i(1); i <= n; ++i)
+        {
+            ret += 1. / std::pow(double(i), theta);
+        }
+        return ret;
+    }
+}
+
+db::workload::workload(const db::params& params)
+    : params_(params)
+    , distribution_()
+    , arrival_()
+    , fragment_unit_()
+    , toi_key_scope_()
+    , n_clients_()
+    , zeta_n_()
+    , zipf_alpha_()
+    , zipf_eta_()
+    , hotspot_rows_()
+{
+    if (parse_distribution(params.distribution, distribution_))
+    {
+        throw std::invalid_argument("Invalid distribution: "
+                                    + params.distribution);
+    }
+    if (parse_arrival(params.arrival, arrival_))
+    {
+        throw std::invalid_argument("Invalid arrival: " + params.arrival);
+    }
+    if (parse_fragment_unit(params.sr_fragment_unit, fragment_unit_))
+    {
+        throw std::invalid_argument("Invalid fragment unit: "
+                                    + params.sr_fragment_unit);
+    }
+    if (parse_toi_key_scope(params.toi_key_scope, toi_key_scope_))
+    {
+        throw std::invalid_argument("Invalid TOI key scope: "
+                                    + params.toi_key_scope);
+    }
+    size_t const n_masters(
+        params.topology.empty() ? params.n_servers :
+        std::count(params.topology.begin(), params.topology.end(), 'm'));
+    n_clients_ = std::max(size_t(1), n_masters * params.n_clients);
+    switch (distribution_)
+    {
+    case zipfian:
+    {
+        // Constants for the algorithm from Gray et al.
+        // "Quickly generating billion-record synthetic databases".
+        double const theta(params.zipf_theta);
+        double const n(params.n_rows);
+        zeta_n_ = zeta(params.n_rows, theta);
+        zipf_alpha_ = 1. / (1. - theta);
+        zipf_eta_ = (1. - std::pow(2. / n, 1. - theta))
+            / (1. - zeta(2, theta) / zeta_n_);
+        break;
+    }
+    case hotspot:
+        hotspot_rows_ = std::max(
+            1ULL, static_cast<unsigned long long>(
+                params.hotspot_rows * params.n_rows));
+        break;
+    case uniform:
+        break;
+    }
+}
+
+int db::workload::parse_distribution(const std::string& name,
+                                     enum distribution& distribution)
+{
+    if (name == "uniform")
+    {
+        distribution = uniform;
+    }
+    else if (name == "zipfian")
+    {
+        distribution = zipfian;
+    }
+    else if (name == "hotspot")
+    {
+        distribution = hotspot;
+    }
+    else
+    {
+        return 1;
+    }
+    return 0;
+}
+
+int db::workload::parse_arrival(const std::string& name,
+                                enum arrival& arrival)
+{
+    if (name == "poisson")
+    {
+        arrival = poisson;
+    }
+    else if (name == "fixed")
+    {
+        arrival = fixed;
+    }
+    else
+    {
+        return 1;
+    }
+    return 0;
+}
+
+int db::workload::parse_fragment_unit(
+    const std::string& name,
+    enum wsrep::streaming_context::fragment_unit& fragment_unit)
+{
+    if (name == "bytes")
+    {
+        fragment_unit = wsrep::streaming_context::bytes;
+    }
+    else if (name == "rows")
+    {
+        fragment_unit = wsrep::streaming_context::row;
+    }
+    else if (name == "statements")
+    {
+        fragment_unit = wsrep::streaming_context::statement;
+    }
+    else
+    {
+        return 1;
+    }
+    return 0;
+}
+
+int db::workload::parse_toi_key_scope(const std::string& name,
+                                      enum toi_key_scope& toi_key_scope)
+{
+    if (name == "table")
+    {
+        toi_key_scope = table;
+    }
+    else if (name == "wildcard")
+    {
+        toi_key_scope = wildcard;
+    }
+    else
+    {
+        return 1;
+    }
+    return 0;
+}
+
+double db::workload::client_rate(size_t step) const
+{
+    return params_.rate * (step + 1) / params_.ramp_steps / n_clients_;
+}
+
+db::workload::generator::generator(const workload& workload,
+                                   unsigned long long seed)
+    : workload_(workload)
+    , rng_(seed)
+    , double_dist_(0., 1.)
+{ }
+
+bool db::workload::generator::next_toi()
+{
+    return (next_double() < workload_.params_.toi_ratio);
+}
+
+bool db::workload::generator::next_large()
+{
+    return (next_double() < workload_.params_.large_transaction_ratio);
+}
+
+void db::workload::generator::next_transaction(std::vector<operation>& ops,
+                                               bool large)
+{
+    const db::params& params(workload_.params_);
+    ops.clear();
+    size_t const n_ops(large ? params.large_transaction_rows :
+                       next_in_range(params.min_rows_per_transaction,
+                                     params.max_rows_per_transaction));
+    for (size_t i(0); i < n_ops; ++i)
+    {
+        operation op;
+        op.row = next_row();
+        if (next_double() < params.read_ratio)
+        {
+            op.type = operation::read;
+            op.shared_key = (next_double() < params.shared_key_ratio);
+            op.payload_size = 0;
+        }
+        else
+        {
+            op.type = operation::write;
+            op.shared_key = false;
+            op.payload_size = next_in_range(params.min_payload,
+                                            params.max_payload);
+        }
+        ops.push_back(op);
+    }
+    // Make sure that the transaction produces a write set.
+    operation& last(ops.back());
+    if (last.type == operation::read &&
+        std::none_of(ops.begin(), ops.end(),
+                     [](const operation& op)
+                     { return op.type == operation::write; }))
+    {
+        last.type = operation::write;
+        last.shared_key = false;
+        last.payload_size = next_in_range(params.min_payload,
+                                          params.max_payload);
+    }
+}
+
+bool db::workload::generator::next_2pc()
+{
+    return (next_double() < workload_.params_.two_pc_ratio);
+}
+
+std::chrono::nanoseconds db::workload::generator::first_arrival(double rate)
+{
+    if (workload_.arrival_ == fixed)
+    {
+        return std::chrono::nanoseconds(
+            static_cast<long long>(next_double() * 1e9 / rate));
+    }
+    return next_arrival(rate);
+}
+
+std::chrono::nanoseconds db::workload::generator::next_arrival(double rate)
+{
+    double interval(1. / rate);
+    if (workload_.arrival_ == poisson)
+    {
+        // Exponentially distributed inter-arrival time,
+        // 1 - u is in range (0, 1].
+        interval *= -std::log(1. - next_double());
+    }
+    return std::chrono::nanoseconds(static_cast<long long>(interval * 1e9));
+}
+
+double db::workload::generator::next_double()
+{
+    return double_dist_(rng_);
+}
+
+size_t db::workload::generator::next_in_range(size_t min, size_t max)
+{
+    return (min == max ? min : min + rng_() % (max - min + 1));
+}
+
+unsigned long long db::workload::generator::next_row()
+{
+    unsigned long long const n_rows(workload_.params_.n_rows);
+    switch (workload_.distribution_)
+    {
+    case uniform:
+        break;
+    case zipfian:
+    {
+        double const theta(workload_.params_.zipf_theta);
+        double const u(next_double());
+        double const uz(u * workload_.zeta_n_);
+        if (uz < 1.) return 0;
+        if (uz < 1. + std::pow(0.5, theta)) return 1;
+        unsigned long long const ret(
+            n_rows * std::pow(workload_.zipf_eta_ * u
+                              - workload_.zipf_eta_ + 1.,
+                              workload_.zipf_alpha_));
+        return std::min(ret, n_rows - 1);
+    }
+    case hotspot:
+    {
+        unsigned long long const hot(workload_.hotspot_rows_);
+        if (next_double() < workload_.params_.hotspot_access_ratio ||
+            hot == n_rows)
+        {
+            return rng_() % hot;
+        }
+        return hot + rng_() % (n_rows - hot);
+    }
+    }
+    return rng_() % n_rows;
+}
@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/** @file db_workload.hpp
+ *
+ * Workload generator for dbsim clients.
+ *
+ * The workload describes the shape of transactions: how rows are
+ * chosen (uniform, zipfian or hotspot distribution), how many rows
+ * each transaction accesses, the share of reads, the share of
+ * reads which append a shared certification key, payload sizes
+ * and the share of transactions which use 2PC. A share of
+ * transactions can be large, large transactions are replicated
+ * with streaming replication if the fragment size is set. A share of
+ * client operations can be TOI operations which simulate DDL. In open
+ * loop mode the workload also defines the transaction arrival process.
+ *
+ * The workload object is shared by all clients and immutable after
+ * construction. Each client owns a generator with its own random
+ * number generator state, so that generating transactions does not
+ * need any synchronization.
+ */
+
+#ifndef WSREP_DB_WORKLOAD_HPP
+#define WSREP_DB_WORKLOAD_HPP
+
+#include "db_params.hpp"
+
+#include "wsrep/streaming_context.hpp"
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+namespace db
+{
+    class workload
+    {
+    public:
+        enum distribution
+        {
+            uniform,
+            zipfian,
+            hotspot
+        };
+
+        enum arrival
+        {
+            poisson,
+            fixed
+        };
+
+        enum toi_key_scope
+        {
+            /** Exclusive key on the table all rows belong to */
+            table,
+            /** Exclusive key without key parts, conflicts with
+                all other keys */
+            wildcard
+        };
+
+        struct operation
+        {
+            enum type
+            {
+                read,
+                write
+            } type;
+            unsigned long long row;
+            // Append shared key for read
+            bool shared_key;
+            // Size of the written value
+            size_t payload_size;
+        };
+
+        workload(const db::params&);
+
+        class generator
+        {
+        public:
+            generator(const workload&, unsigned long long seed);
+            /**
+             * Return true if the next client operation should be
+             * a TOI operation instead of a transaction.
+             */
+            bool next_toi();
+            /**
+             * Return true if the next transaction should be large.
+             */
+            bool next_large();
+            /**
+             * Generate operations for the next transaction. Every
+             * transaction writes at least one row.
+             *
+             * @param large Generate operations for a large transaction.
+             */
+            void next_transaction(std::vector<operation>&, bool large);
+            /**
+             * Return true if the next transaction should use 2PC.
+             */
+            bool next_2pc();
+            /**
+             * Return delay from the start of the open loop step
+             * to the first transaction arrival. With fixed arrival
+             * the first arrival is spread uniformly over the
+             * inter-arrival time to avoid clients starting in
+             * lockstep.
+             *
+             * @param rate Arrival rate of the client.
+             */
+            std::chrono::nanoseconds first_arrival(double rate);
+            /**
+             * Return delay to the next transaction arrival.
+             *
+             * @param rate Arrival rate of the client.
+             */
+            std::chrono::nanoseconds next_arrival(double rate);
+        private:
+            double next_double();
+            size_t next_in_range(size_t min, size_t max);
+            unsigned long long next_row();
+            const workload& workload_;
+            std::mt19937_64 rng_;
+            std::uniform_real_distribution<double> double_dist_;
+        };
+
+        /**
+         * Parse distribution name.
+         *
+         * @return Zero on success, non-zero if the name is not valid.
+         */
+        static int parse_distribution(const std::string&, enum distribution&);
+
+        /**
+         * Parse arrival process name.
+         *
+         * @return Zero on success, non-zero if the name is not valid.
+         */
+        static int parse_arrival(const std::string&, enum arrival&);
+
+        /**
+         * Parse TOI key scope name.
+         *
+         * @return Zero on success, non-zero if the name is not valid.
+         */
+        static int parse_toi_key_scope(const std::string&,
+                                       enum toi_key_scope&);
+
+        /**
+         * Return certification key scope of TOI operations.
+         */
+        enum toi_key_scope toi_key_scope() const { return toi_key_scope_; }
+
+        /**
+         * Return target arrival rate of a single client in open
+         * loop step. The aggregate target rate is divided evenly
+         * between the clients of all master servers.
+         */
+        double client_rate(size_t step) const;
+
+        /**
+         * Parse streaming replication fragment unit name.
+         *
+         * @return Zero on success, non-zero if the name is not valid.
+         */
+        static int parse_fragment_unit(
+            const std::string&,
+            enum wsrep::streaming_context::fragment_unit&);
+
+        /**
+         * Return streaming replication fragment unit for large
+         * transactions.
+         */
+        enum wsrep::streaming_context::fragment_unit fragment_unit() const
+        { return fragment_unit_; }
+    private:
+        const db::params& params_;
+        enum distribution distribution_;
+        enum arrival arrival_;
+        enum wsrep::streaming_context::fragment_unit fragment_unit_;
+        enum toi_key_scope toi_key_scope_;
+        size_t n_clients_;
+        // Constants for zipfian distribution
+        double zeta_n_;
+        double zipf_alpha_;
+        double zipf_eta_;
+        // Number of rows in hotspot
+        unsigned long long hotspot_rows_;
+    };
+}
+
+#endif // WSREP_DB_WORKLOAD_HPP
@@ -0,0 +1,253 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/** @file dbsim_compare.cpp
+ *
+ * Compare two dbsim result files written with --results-file.
+ *
+ * Throughput and latency percentiles of the candidate run are
+ * compared against the baseline run. A metric is a regression if
+ * the throughput decreased or the latency increased more than the
+ * given tolerance. Exit status is 0 if no regressions were found,
+ * 1 if there were regressions and 2 on error.
+ */
+
+#include <boost/program_options.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    typedef boost::property_tree::ptree ptree;
+
+    struct params
+    {
+        std::string baseline;
+        std::string candidate;
+        double throughput_tolerance;
+        double latency_tolerance;
+        std::string percentiles;
+        params()
+            : baseline()
+            , candidate()
+            , throughput_tolerance(5)
+            , latency_tolerance(10)
+            , percentiles("p50,p99")
+        { }
+    };
+
+    // Latency percentile keys contain dots, use slash as path
+    // separator.
+    ptree::path_type path(const std::string& str)
+    {
+        return ptree::path_type(str, '/');
+    }
+
+    class comparator
+    {
+    public:
+        comparator(const params& params,
+                   const ptree& baseline,
+                   const ptree& candidate)
+            : params_(params)
+            , baseline_(baseline)
+            , candidate_(candidate)
+            , regressions_()
+        { }
+
+        void compare_params()
+        {
+            const ptree& b(baseline_.get_child("params"));
+            const ptree& c(candidate_.get_child("params"));
+            for (const auto& param : b)
+            {
+                const std::string value(
+                    c.get<std::string>(path(param.first), "<unset>"));
+                if (value != param.second.data())
+                {
+                    std::cout << "Warning: parameter " << param.first
+                              << " differs: " << param.second.data()
+                              << " != " << value << "\n";
+                }
+            }
+        }
+
+        void compare()
+        {
+            header();
+            // Higher is better for throughput.
+            compare("results/transactions_per_second",
+                    -params_.throughput_tolerance);
+            compare("results/commits_per_second",
+                    -params_.throughput_tolerance);
+            std::vector<std::string> percentiles;
+            std::istringstream is(params_.percentiles);
+            std::string percentile;
+            while (std::getline(is, percentile, ','))
+            {
+                percentiles.push_back(percentile);
+            }
+            const ptree& latency(baseline_.get_child("latency"));
+            for (const auto& phase : latency)
+            {
+                for (const auto& p : percentiles)
+                {
+                    compare("latency/" + phase.first + "/" + p,
+                            params_.latency_tolerance);
+                }
+            }
+        }
+
+        size_t regressions() const { return regressions_; }
+    private:
+        void header()
+        {
+            std::cout << std::left << std::setw(40) << "metric" << std::right
+                      << std::setw(16) << "baseline"
+                      << std::setw(16) << "candidate"
+                      << std::setw(10) << "change"
+                      << "  status\n";
+        }
+
+        // Compare metric, positive tolerance is the maximum allowed
+        // increase and negative tolerance maximum allowed decrease
+        // in percent.
+        void compare(const std::string& metric, double tolerance)
+        {
+            boost::optional<double> b(baseline_.get_optional<double>(
+                                          path(metric)));
+            boost::optional<double> c(candidate_.get_optional<double>(
+                                          path(metric)));
+            if (!b || !c)
+            {
+                if (b)
+                {
+                    std::cout << std::left << std::setw(40) << metric
+                              << std::right << std::setw(16) << *b
+                              << std::setw(16) << "-"
+                              << std::setw(10) << "-"
+                              << "  missing\n";
+                }
+                return;
+            }
+            const double change(*b == 0 ? 0 : 100. * (*c - *b) / *b);
+            const char* status("ok");
+            if ((tolerance >= 0 && change > tolerance) ||
+                (tolerance < 0 && change < tolerance))
+            {
+                status = "REGRESSION";
+                ++regressions_;
+            }
+            std::ios_base::fmtflags flags(std::cout.flags());
+            std::cout << std::left << std::setw(40) << metric << std::right
+                      << std::fixed << std::setprecision(1)
+                      << std::setw(16) << *b
+                      << std::setw(16) << *c
+                      << std::setw(9) << std::showpos << change << "%"
+                      << std::noshowpos
+                      << "  " << status << "\n";
+            std::cout.flags(flags);
+        }
+
+        const params& params_;
+        const ptree& baseline_;
+        const ptree& candidate_;
+        size_t regressions_;
+    };
+
+    params parse_args(int argc, char** argv)
+    {
+        namespace po = boost::program_options;
+        params params;
+        po::options_description desc("Allowed options");
+        desc.add_options()
+            ("help", "produce help message")
+            ("baseline", po::value<std::string>(&params.baseline)->required(),
+             "baseline results file")
+            ("candidate",
+             po::value<std::string>(&params.candidate)->required(),
+             "candidate results file")
+            ("throughput-tolerance",
+             po::value<double>(&params.throughput_tolerance),
+             "allowed throughput decrease in percent")
+            ("latency-tolerance",
+             po::value<double>(&params.latency_tolerance),
+             "allowed latency percentile increase in percent, note that "
+             "latency histogram precision is 1.5-3%")
+            ("percentiles", po::value<std::string>(&params.percentiles),
+             "comma separated list of latency percentiles to compare, "
+             "one of p50, p90, p99, p99.9, max");
+        po::positional_options_description pos;
+        pos.add("baseline", 1).add("candidate", 1);
+        try
+        {
+            po::variables_map vm;
+            po::store(po::command_line_parser(argc, argv)
+                      .options(desc).positional(pos).run(), vm);
+            if (vm.count("help"))
+            {
+                std::cerr << "Usage: dbsim_compare [options] "
+                          << "<baseline> <candidate>\n" << desc << "\n";
+                exit(0);
+            }
+            po::notify(vm);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << "\n"
+                      << "Usage: dbsim_compare [options] "
+                      << "<baseline> <candidate>\n" << desc << "\n";
+            exit(2);
+        }
+        return params;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const params params(parse_args(argc, argv));
+    try
+    {
+        ptree baseline;
+        ptree candidate;
+        boost::property_tree::read_json(params.baseline, baseline);
+        boost::property_tree::read_json(params.candidate, candidate);
+        comparator comparator(params, baseline, candidate);
+        comparator.compare_params();
+        comparator.compare();
+        if (comparator.regressions())
+        {
+            std::cout << comparator.regressions() << " regression(s)\n";
+            return 1;
+        }
+        std::cout << "No regressions\n";
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+    return 0;
+}
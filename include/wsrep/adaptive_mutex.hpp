@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/** @file adaptive_mutex.hpp
+ *
+ * Adaptive spin-then-park mutex and matching condition variable.
+ *
+ * The adaptive mutex is meant for locks which are held only for
+ * short periods, like the client mutex. A contended lock() spins
+ * for a bounded number of rounds before parking the thread in
+ * the kernel. On Linux threads are parked on a futex, on other
+ * platforms the parked thread yields the processor in a loop.
+ *
+ * The mutex counts acquisitions, spin rounds and parks so that
+ * hot locks can be identified.
+ */
+
+#ifndef WSREP_ADAPTIVE_MUTEX_HPP
+#define WSREP_ADAPTIVE_MUTEX_HPP
+
+#include "mutex.hpp"
+#include "condition_variable.hpp"
+#include "atomic.hpp"
+#include "compiler.hpp"
+
+#include <cstddef>
+#include <ctime>
+
+namespace wsrep
+{
+    class adaptive_mutex WSREP_FINAL : public wsrep::mutex
+    {
+    public:
+        /** Default maximum number of spin rounds before parking. */
+        static const size_t default_max_spins = 100;
+
+        adaptive_mutex(size_t max_spins = default_max_spins)
+            : wsrep::mutex()
+            , state_(unlocked)
+            , max_spins_(max_spins)
+            , acquisitions_(0)
+            , spins_(0)
+            , parks_(0)
+        { }
+
+        void lock()
+        {
+            acquisitions_.fetch_add(1, std::memory_order_relaxed);
+            int expected(unlocked);
+            if (state_.compare_exchange_strong(expected, locked,
+                                               std::memory_order_acquire)
+                == false)
+            {
+                lock_contended();
+            }
+        }
+
+        void unlock()
+        {
+            if (state_.exchange(unlocked, std::memory_order_release)
+                == contended)
+            {
+                wake();
+            }
+        }
+
+        /**
+         * Return pointer to the lock word. The adaptive mutex is
+         * not a pthread mutex and cannot be used with
+         * wsrep::default_condition_variable,
+         * use wsrep::adaptive_condition_variable instead.
+         */
+        void* native()
+        {
+            return &state_;
+        }
+
+        /** Return the number of lock() calls. */
+        size_t acquisitions() const
+        {
+            return acquisitions_.load(std::memory_order_relaxed);
+        }
+
+        /** Return the total number of spin rounds in contended lock(). */
+        size_t spins() const
+        {
+            return spins_.load(std::memory_order_relaxed);
+        }
+
+        /** Return the number of times a thread was parked. */
+        size_t parks() const
+        {
+            return parks_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        enum
+        {
+            unlocked,
+            locked,
+            // Locked and there may be parked waiters.
+            contended
+        };
+        void lock_contended();
+        void wake();
+
+        std::atomic<int> state_;
+        size_t max_spins_;
+        std::atomic<size_t> acquisitions_;
+        std::atomic<size_t> spins_;
+        std::atomic<size_t> parks_;
+    };
+
+    /**
+     * Condition variable which works with any wsrep::mutex, meant to
+     * be used together with wsrep::adaptive_mutex. Waiters are parked
+     * on a futex on Linux.
+     */
+    class adaptive_condition_variable WSREP_FINAL
+        : public wsrep::condition_variable
+    {
+    public:
+        adaptive_condition_variable()
+            : wsrep::condition_variable()
+            , seq_(0)
+            , waiters_(0)
+            , waits_(0)
+        { }
+
+        void notify_one();
+        void notify_all();
+
+        void wait(wsrep::unique_lock<wsrep::mutex>& lock)
+        {
+            (void)do_wait(lock.mutex(), 0);
+        }
+
+        void wait(wsrep::unique_lock<wsrep::adaptive_mutex>& lock)
+        {
+            (void)do_wait(lock.mutex(), 0);
+        }
+
+        /**
+         * Wait until notified or the absolute time given in abstime
+         * has passed. The time is measured by realtime clock.
+         *
+         * As with pthread_cond_timedwait(), spurious wakeups are
+         * possible.
+         *
+         * @return Zero if notified, ETIMEDOUT on timeout.
+         */
+        int timedwait(wsrep::unique_lock<wsrep::mutex>& lock,
+                      const struct timespec& abstime)
+        {
+            return do_wait(lock.mutex(), &abstime);
+        }
+
+        int timedwait(wsrep::unique_lock<wsrep::adaptive_mutex>& lock,
+                      const struct timespec& abstime)
+        {
+            return do_wait(lock.mutex(), &abstime);
+        }
+
+        /** Return the number of waits. */
+        size_t waits() const
+        {
+            return waits_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        int do_wait(wsrep::mutex&, const struct timespec*);
+
+        std::atomic<int> seq_;
+        std::atomic<int> waiters_;
+        std::atomic<size_t> waits_;
+    };
+}
+
+#endif // WSREP_ADAPTIVE_MUTEX_HPP
@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/** @file applier_pool.hpp
+ *
+ * Dynamically sized pool of applier threads.
+ *
+ * The pool runs provider applier loops (provider::run_applier())
+ * in a number of threads which is adjusted at runtime between
+ * configured bounds. The pool manager thread samples the provider
+ * receive queue length, apply latency and time spent waiting for
+ * commit order at regular intervals:
+ *
+ * - If write sets are queueing up and appliers are not mostly waiting
+ *   for commit order, more appliers are started.
+ * - If the receive queue is empty and appliers are mostly idle for
+ *   a number of consecutive intervals, or appliers spend most of the
+ *   time waiting for commit order, appliers are retired one by one.
+ *
+ * An applier is retired by letting it exit from the provider applier
+ * loop after it has applied its next write set. If no write sets
+ * were applied during the last interval, the appliers are blocked
+ * in the provider waiting for write sets. The manager then retires
+ * the appliers itself and wakes them up with service::wake_applier().
+ */
+
+#ifndef WSREP_APPLIER_POOL_HPP
+#define WSREP_APPLIER_POOL_HPP
+
+#include "mutex.hpp"
+#include "condition_variable.hpp"
+#include "atomic.hpp"
+
+#include <list>
+#include <string>
+
+#include <pthread.h>
+
+namespace wsrep
+{
+    class server_state;
+    class high_priority_service;
+
+    class applier_pool
+    {
+    public:
+        /**
+         * Interface for creating high priority services for applier
+         * threads. Implemented by the DBMS.
+         */
+        class service
+        {
+        public:
+            virtual ~service() { }
+            /**
+             * Create a high priority service for applier thread.
+             * This method is called from the applier thread.
+             */
+            virtual wsrep::high_priority_service* applier_service() = 0;
+
+            /**
+             * Release high priority service created by
+             * applier_service(). This method is called from the
+             * applier thread after the applier loop has exited.
+             */
+            virtual void release_applier_service(
+                wsrep::high_priority_service*) = 0;
+
+            /**
+             * Wake up an applier thread which is blocked in the
+             * provider applier loop waiting for write sets, so that
+             * provider::run_applier() returns. The
+             * high_priority_service::must_exit() of the applier has
+             * been set. This method is called by the pool manager
+             * thread with the pool mutex locked and must not call
+             * back into the pool.
+             *
+             * The default implementation does nothing, in which case
+             * the applier exits after it has applied its next
+             * write set.
+             */
+            virtual void wake_applier(wsrep::high_priority_service&) { }
+        };
+
+        struct params
+        {
+            /** Minimum number of appliers. */
+            size_t min_appliers;
+            /** Maximum number of appliers. */
+            size_t max_appliers;
+            /** Interval between scaling decisions in milliseconds. */
+            int interval_ms;
+            /** Name of provider status variable for receive queue
+                length. */
+            std::string recv_queue_status;
+            /** Receive queue length above which appliers are added. */
+            long long scale_out_queue_length;
+            /** Busy ratio of appliers below which they are
+                considered idle. */
+            double idle_ratio;
+            /** Number of consecutive idle intervals before an applier
+                is retired. */
+            size_t idle_intervals;
+            /** Ratio of commit order wait to apply time above which
+                adding appliers does not help. */
+            double commit_order_wait_ratio;
+
+            params()
+                : min_appliers(1)
+                , max_appliers(1)
+                , interval_ms(1000)
+                , recv_queue_status("local_recv_queue")
+                , scale_out_queue_length(16)
+                , idle_ratio(0.1)
+                , idle_intervals(5)
+                , commit_order_wait_ratio(0.5)
+            { }
+        };
+
+        /**
+         * Observations collected over one sampling interval.
+         */
+        struct sample
+        {
+            /** Length of the sampling interval in nanoseconds. */
+            long long interval_ns;
+            /** Number of write sets applied. */
+            long long applied;
+            /** Total time spent applying in nanoseconds. */
+            long long apply_ns;
+            /** Total time spent waiting for commit order in
+                nanoseconds. */
+            long long commit_order_wait_ns;
+            /** Provider receive queue length. */
+            long long recv_queue_length;
+        };
+
+        applier_pool(wsrep::server_state& server_state,
+                     service& service,
+                     const params& = params());
+        ~applier_pool();
+
+        /**
+         * Start the pool manager and the minimum number of appliers.
+         * The provider must be loaded before calling this.
+         *
+         * @return Zero on success, non-zero on failure.
+         */
+        int start();
+
+        /**
+         * Stop the pool manager and wait until all applier threads
+         * have exited. Applier threads exit when the provider
+         * applier loop returns, so this should be called only after
+         * the server has disconnected from the cluster.
+         */
+        void stop();
+
+        /**
+         * Record the time spent applying a write set. Called by
+         * server state for every applied write set.
+         */
+        void applied(wsrep::high_priority_service& high_priority_service,
+                     long long apply_ns);
+
+        /**
+         * Record the time spent waiting for commit order.
+         */
+        void commit_order_waited(long long wait_ns)
+        {
+            commit_order_wait_ns_.fetch_add(wait_ns,
+                                            std::memory_order_relaxed);
+        }
+
+        /**
+         * Return the time waited for commit order since the pool
+         * manager last sampled it, in nanoseconds.
+         */
+        long long commit_order_wait_ns() const
+        {
+            return commit_order_wait_ns_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Return the number of running appliers.
+         */
+        size_t appliers() const;
+
+        /**
+         * Return the current target number of appliers.
+         */
+        size_t target() const;
+
+        /**
+         * Compute the target number of appliers for the next
+         * interval.
+         *
+         * @param params Pool parameters
+         * @param current Current number of appliers
+         * @param sample Observations from the last interval
+         * @param[in,out] idle Number of consecutive idle intervals
+         *
+         * @return Target number of appliers.
+         */
+        static size_t target_appliers(const params& params,
+                                      size_t current,
+                                      const sample& sample,
+                                      size_t& idle);
+
+    private:
+        applier_pool(const applier_pool&);
+        applier_pool& operator=(const applier_pool&);
+
+        struct applier
+        {
+            applier(wsrep::applier_pool& pool_arg)
+                : pool(pool_arg)
+                , high_priority_service()
+                , thread()
+                , retired()
+                , exited()
+            { }
+            wsrep::applier_pool& pool;
+            wsrep::high_priority_service* high_priority_service;
+            pthread_t thread;
+            bool retired;
+            bool exited;
+        };
+
+        static void* applier_thread(void*);
+        static void* manager_thread(void*);
+        void run_applier(applier&);
+        void run_manager();
+        int start_applier(wsrep::unique_lock<wsrep::mutex>&);
+        void retire_applier(wsrep::unique_lock<wsrep::mutex>&, applier&);
+        void retire_idle_appliers(wsrep::unique_lock<wsrep::mutex>&);
+        void reap_appliers(wsrep::unique_lock<wsrep::mutex>&);
+        long long recv_queue_length() const;
+
+        wsrep::server_state& server_state_;
+        service& service_;
+        params params_;
+        mutable wsrep::default_mutex mutex_;
+        wsrep::default_condition_variable cond_;
+        std::list<applier> appliers_;
+        // Number of appliers which have not been retired.
+        size_t running_;
+        size_t target_;
+        // Number of appliers to be retired, read without locking
+        // for every applied write set.
+        std::atomic<size_t> retire_;
+        std::atomic<long long> applied_;
+        std::atomic<long long> apply_ns_;
+        std::atomic<long long> commit_order_wait_ns_;
+        pthread_t manager_;
+        bool manager_started_;
+        bool stopping_;
+    };
+}
+
+#endif // WSREP_APPLIER_POOL_HPP
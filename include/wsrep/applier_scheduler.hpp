@@ -0,0 +1,226 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/** @file applier_scheduler.hpp
+ *
+ * Dependency aware parallel applier scheduler.
+ *
+ * When an applier scheduler is attached to server state, write sets
+ * passed to server_state::on_apply() by the receiving thread are
+ * queued and applied by a pool of worker threads, each of which
+ * owns a high priority service. A write set is started as soon as
+ * all the queued write sets it depends on (seqno less than or equal
+ * to ws_meta::depends_on()) have been committed. Commit ordering
+ * is enforced by the provider through commit_order_enter() and
+ * commit_order_leave() as usual.
+ *
+ * Commutative write sets are started without waiting for their
+ * dependencies.
+ *
+ * Fragments of a streaming transaction are pinned to one worker,
+ * chosen when the first fragment is queued. Consecutive fragments
+ * are then applied by the same worker, so that the streaming applier
+ * stays bound to the execution context of the worker and the context
+ * switch in high_priority_switch can be skipped.
+ *
+ * Other write sets are applied in parallel only if they start and
+ * commit a transaction without any additional flags other than
+ * commutative. All other write sets (TOI, XA prepare, write sets with
+ * PA unsafe or implicit dependencies) act as barriers: the receiving
+ * thread waits until the queued write sets ordered before the barrier
+ * have been committed and applies the write set itself. Write sets
+ * ordered after the barrier, which other receiving threads may have
+ * queued meanwhile, are not waited for as they may be waiting for
+ * the barrier in commit order.
+ *
+ * The receiving thread waits in enqueue() until the write set has
+ * been applied and committed by a worker, and the result of applying
+ * is returned to the provider from the apply callback. The provider
+ * releases the write set handle and data once the apply callback
+ * returns, so the write set must not outlive the callback. Write sets
+ * are therefore applied in parallel only if the provider runs several
+ * receiving threads. The scheduler then lets the write sets received
+ * by different threads overlap according to their dependencies, and
+ * keeps fragments of a streaming transaction on one worker.
+ *
+ * A write set which fails to apply is passed through commit order
+ * by server_state as a dummy write set, so the failure does not
+ * block the write sets which follow it.
+ */
+
+#ifndef WSREP_APPLIER_SCHEDULER_HPP
+#define WSREP_APPLIER_SCHEDULER_HPP
+
+#include "provider.hpp"
+#include "mutex.hpp"
+#include "condition_variable.hpp"
+
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
+
+#include <pthread.h>
+
+namespace wsrep
+{
+    class server_state;
+    class high_priority_service;
+
+    class applier_scheduler
+    {
+    public:
+        /**
+         * Default maximum number of write sets waiting in queue.
+         */
+        static const size_t default_max_queued = 1024;
+
+        /**
+         * @param server_state Server state the write sets are applied to
+         * @param max_queued Maximum number of write sets waiting in
+         *        queue. The receiving thread blocks if the queue is full.
+         */
+        applier_scheduler(wsrep::server_state& server_state,
+                          size_t max_queued = default_max_queued);
+        ~applier_scheduler();
+
+        /**
+         * Start worker threads, one for each of the given high
+         * priority services. The services are owned by the caller
+         * and must remain valid until stop() has returned.
+         *
+         * @return Zero on success, non-zero if the worker threads
+         *         could not be started.
+         */
+        int start(const std::vector<wsrep::high_priority_service*>& services);
+
+        /**
+         * Apply all queued write sets and stop worker threads.
+         */
+        void stop();
+
+        /**
+         * Return true if the write set can be scheduled for parallel
+         * applying.
+         */
+        bool schedulable(const wsrep::ws_meta& ws_meta) const;
+
+        /**
+         * Return true if the high priority service belongs to
+         * one of the worker threads.
+         */
+        bool is_worker(const wsrep::high_priority_service*) const;
+
+        /**
+         * Queue write set for applying and wait until it has been
+         * applied by a worker.
+         *
+         * @return Zero on success, non-zero if applying of the write
+         *         set failed.
+         */
+        int enqueue(const wsrep::ws_handle& ws_handle,
+                    const wsrep::ws_meta& ws_meta,
+                    const wsrep::const_buffer& data);
+
+        /**
+         * Wait until the queued write sets with seqno less than
+         * the given seqno have been applied. If the seqno is
+         * undefined, wait until all queued write sets have been
+         * applied.
+         */
+        void drain(wsrep::seqno seqno = wsrep::seqno::undefined());
+
+        /**
+         * Return the number of worker threads.
+         */
+        size_t workers() const { return workers_.size(); }
+
+        /**
+         * Return the number of write sets applied by worker threads.
+         */
+        size_t applied() const;
+
+    private:
+        applier_scheduler(const applier_scheduler&);
+        applier_scheduler& operator=(const applier_scheduler&);
+
+        struct write_set
+        {
+            static const size_t any_worker = size_t(-1);
+            write_set(const wsrep::ws_handle& ws_handle_arg,
+                      const wsrep::ws_meta& ws_meta_arg,
+                      const wsrep::const_buffer& data_arg)
+                : ws_handle(ws_handle_arg)
+                , ws_meta(ws_meta_arg)
+                , data(data_arg)
+                , worker_index(any_worker)
+                , result()
+                , done()
+            { }
+            // The write set is owned by the receiving thread waiting
+            // in enqueue(), which keeps the referenced handle, meta
+            // and data valid until the write set is done.
+            const wsrep::ws_handle& ws_handle;
+            const wsrep::ws_meta& ws_meta;
+            const wsrep::const_buffer& data;
+            // Index of the worker the write set is pinned to.
+            size_t worker_index;
+            // Result of applying, passed back to the receiving thread.
+            int result;
+            bool done;
+        };
+
+        struct worker
+        {
+            wsrep::applier_scheduler* scheduler;
+            wsrep::high_priority_service* high_priority_service;
+            size_t index;
+            pthread_t thread;
+        };
+
+        static void* worker_thread(void*);
+        void run_worker(size_t index);
+        size_t affine_worker(wsrep::unique_lock<wsrep::mutex>&,
+                             const wsrep::ws_meta&);
+        write_set* next_ready(wsrep::unique_lock<wsrep::mutex>&,
+                              size_t index);
+
+        wsrep::server_state& server_state_;
+        size_t max_queued_;
+        mutable wsrep::default_mutex mutex_;
+        // Signaled when a worker may be able to start a write set.
+        wsrep::default_condition_variable worker_cond_;
+        // Signaled when a write set has been dequeued or applied.
+        wsrep::default_condition_variable producer_cond_;
+        std::vector<worker> workers_;
+        // Write sets waiting to be started, in seqno order.
+        std::deque<write_set*> queue_;
+        // Seqnos of queued and running write sets.
+        std::set<long long> in_flight_;
+        // Workers of streaming transactions which have fragments
+        // still to come.
+        std::map<std::pair<wsrep::id, wsrep::transaction_id>, size_t>
+        affinity_;
+        size_t next_worker_;
+        size_t applied_;
+        bool stopping_;
+    };
+}
+
+#endif // WSREP_APPLIER_SCHEDULER_HPP
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/** @file client_mutex.hpp
+ *
+ * Mutex and condition variable types used for client_state and
+ * transaction hot paths.
+ *
+ * By default these are the abstract wsrep::mutex and
+ * wsrep::condition_variable, so that any DBMS provided
+ * implementation can be used. Integrators may define
+ * WSREP_LIB_CLIENT_MUTEX and WSREP_LIB_CLIENT_CONDITION_VARIABLE to name
+ * concrete types derived from wsrep::mutex and
+ * wsrep::condition_variable. The client mutex lock and unlock calls
+ * can then be devirtualized, unconditionally if the types are final.
+ * The condition variable must support waiting with
+ * wsrep::unique_lock<wsrep::client_mutex>. Suitable pairs are
+ * wsrep::default_mutex with wsrep::default_condition_variable and
+ * wsrep::adaptive_mutex with wsrep::adaptive_condition_variable.
+ * wsrep::default_mutex and wsrep::default_condition_variable are not
+ * final so that the DBMS may derive its own types from them.
+ *
+ * If the types are declared in a separate header, the header can be
+ * given in WSREP_LIB_CLIENT_MUTEX_INCLUDE. The same definitions must
+ * be used when compiling the library and the application.
+ */
+
+#ifndef WSREP_CLIENT_MUTEX_HPP
+#define WSREP_CLIENT_MUTEX_HPP
+
+#include "mutex.hpp"
+#include "condition_variable.hpp"
+
+#ifdef WSREP_LIB_CLIENT_MUTEX_INCLUDE
+#include WSREP_LIB_CLIENT_MUTEX_INCLUDE
+#endif /* WSREP_LIB_CLIENT_MUTEX_INCLUDE */
+
+namespace wsrep
+{
+#if defined(WSREP_LIB_CLIENT_MUTEX) && \
+    defined(WSREP_LIB_CLIENT_CONDITION_VARIABLE)
+    typedef WSREP_LIB_CLIENT_MUTEX client_mutex;
+    typedef WSREP_LIB_CLIENT_CONDITION_VARIABLE client_condition_variable;
+#elif defined(WSREP_LIB_CLIENT_MUTEX) || \
+    defined(WSREP_LIB_CLIENT_CONDITION_VARIABLE)
+#error "Both WSREP_LIB_CLIENT_MUTEX and WSREP_LIB_CLIENT_CONDITION_VARIABLE required"
+#else
+    typedef wsrep::mutex client_mutex;
+    typedef wsrep::condition_variable client_condition_variable;
+#endif
+}
+
+#endif // WSREP_CLIENT_MUTEX_HPP
@@ -31,6 +31,7 @@
 #include "provider.hpp"
 #include "mutex.hpp"
 #include "lock.hpp"
+#include "client_mutex.hpp"
 
 namespace wsrep
 {
@@ -48,7 +49,8 @@ namespace wsrep
          *
          * @param lock Lock object grabbed by the client_state
          */
-        virtual bool interrupted(wsrep::unique_lock<wsrep::mutex>& lock) const = 0;
+        virtual bool interrupted(
+            wsrep::unique_lock<wsrep::client_mutex>& lock) const = 0;
 
         /**
          * Reset possible global or thread local parameters associated
@@ -158,7 +160,8 @@ namespace wsrep
          * @todo This should not be visible to DBMS level, should be
          * handled internally by wsrep-lib.
          */
-        virtual void wait_for_replayers(wsrep::unique_lock<wsrep::mutex>&) = 0;
+        virtual void wait_for_replayers(
+            wsrep::unique_lock<wsrep::client_mutex>&) = 0;
 
         //
         // Debug interface
@@ -39,6 +39,7 @@
 #include "client_service.hpp"
 #include "mutex.hpp"
 #include "lock.hpp"
+#include "client_mutex.hpp"
 #include "buffer.hpp"
 #include "thread.hpp"
 
@@ -99,10 +100,12 @@ namespace wsrep
             /** Client is in total order isolation mode */
             m_toi,
             /** Client is executing rolling schema upgrade */
-            m_rsu
+            m_rsu,
+            /** Client is executing non-blocking operation */
+            m_nbo
         };
 
-        static const int n_modes_ = m_rsu + 1;
+        static const int n_modes_ = m_nbo + 1;
         /**
          * Client state enumeration.
          *
@@ -145,7 +148,7 @@ namespace wsrep
          */
         void acquire_ownership()
         {
-            wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+            wsrep::unique_lock<wsrep::client_mutex> lock(mutex_);
             do_acquire_ownership(lock);
         }
 
@@ -281,7 +284,7 @@ namespace wsrep
          */
         int start_transaction(const wsrep::transaction_id& id)
         {
-            wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+            wsrep::unique_lock<wsrep::client_mutex> lock(mutex_);
             assert(state_ == s_exec);
             return transaction_.start_transaction(id);
         }
@@ -325,6 +328,19 @@ namespace wsrep
             return transaction_.append_data(data);
         }
 
+        /**
+         * Mark the current transaction commutative.
+         *
+         * The write set of a commutative transaction does not depend
+         * on any preceding write set and may be applied out of order
+         * on the other nodes. Commit order is still preserved.
+         * The marking is cleared when the transaction is cleaned up.
+         *
+         * @return Zero on success, non-zero if the transaction is
+         *         streaming.
+         */
+        int mark_commutative();
+
         /** @} */
 
         /** @name Streaming replication interface */
@@ -405,7 +421,7 @@ namespace wsrep
         int start_transaction(const wsrep::ws_handle& wsh,
                               const wsrep::ws_meta& meta)
         {
-            wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+            wsrep::unique_lock<wsrep::client_mutex> lock(mutex_);
             assert(owning_thread_id_ == wsrep::this_thread::get_id());
             assert(mode_ == m_high_priority);
             return transaction_.start_transaction(wsh, meta);
@@ -415,7 +431,7 @@ namespace wsrep
         /** @{ */
         int before_prepare()
         {
-            wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+            wsrep::unique_lock<wsrep::client_mutex> lock(mutex_);
             assert(owning_thread_id_ == wsrep::this_thread::get_id());
             assert(state_ == s_exec);
             return transaction_.before_prepare(lock);
@@ -423,7 +439,7 @@ namespace wsrep
 
         int after_prepare()
         {
-            wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+            wsrep::unique_lock<wsrep::client_mutex> lock(mutex_);
             assert(owning_thread_id_ == wsrep::this_thread::get_id());
             assert(state_ == s_exec);
             return transaction_.after_prepare(lock);
@@ -500,7 +516,7 @@ namespace wsrep
          */
         int bf_abort(wsrep::seqno bf_seqno)
         {
-            wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+            wsrep::unique_lock<wsrep::client_mutex> lock(mutex_);
             assert(mode_ == m_local || transaction_.is_streaming());
             return transaction_.bf_abort(lock, bf_seqno);
         }
@@ -511,7 +527,7 @@ namespace wsrep
          */
         int total_order_bf_abort(wsrep::seqno bf_seqno)
         {
-            wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+            wsrep::unique_lock<wsrep::client_mutex> lock(mutex_);
             assert(mode_ == m_local || transaction_.is_streaming());
             return transaction_.total_order_bf_abort(lock, bf_seqno);
         }
@@ -645,20 +661,89 @@ namespace wsrep
 
         /**
          * Begin non-blocking operation.
+         *
+         * The NBO operation is started by entering the TOI critical
+         * section with the start transaction flag. The keys and the
+         * buffer are certified as in a regular TOI operation. On
+         * success the client is switched to m_nbo mode and the TOI
+         * critical section must be left with end_nbo_phase_one()
+         * once the operation has acquired its resources.
+         *
+         * If the call fails due to error returned by the provider,
+         * the provider error code can be retrieved with
+         * current_error_status().
+         *
+         * @param keys Array of keys for NBO operation.
+         * @param buffer NBO write set
+         *
+         * @return Zero in case of success, non-zero in case of failure.
          */
-        int begin_nbo(const wsrep::key_array&);
+        int begin_nbo_phase_one(const wsrep::key_array& keys,
+                                const wsrep::const_buffer& buffer);
 
         /**
-         * End non-blocking operation
+         * End the first phase of NBO operation. The TOI critical
+         * section is released and the operation continues to
+         * execute outside of total order in m_nbo mode.
+         *
+         * @param err definition of the error that happened during the
+         *            first phase of the operation (empty for no error)
+         *
+         * @return Zero in case of success, non-zero in case of failure.
          */
-        int end_nbo();
+        int end_nbo_phase_one(const wsrep::mutable_buffer& err);
+
+        /**
+         * Enter NBO mode. This method is called from the thread
+         * which continues the execution of an NBO operation which
+         * was started by applying an NBO begin write set.
+         *
+         * @param ws_meta Write set meta data of the NBO begin event.
+         *
+         * @return Zero in case of success, non-zero in case of failure.
+         */
+        int enter_nbo_mode(const wsrep::ws_meta& ws_meta);
+
+        /**
+         * Begin the second phase of NBO operation. The TOI critical
+         * section is entered with the commit flag in order to
+         * totally order the end of the operation.
+         *
+         * If the call fails, the client remains in m_nbo mode as
+         * the NBO end has not been replicated.
+         *
+         * @param keys Array of keys for NBO operation.
+         *
+         * @return Zero in case of success, non-zero in case of failure.
+         */
+        int begin_nbo_phase_two(const wsrep::key_array& keys);
+
+        /**
+         * End the second phase of NBO operation. The TOI critical
+         * section is released and the client is switched back to
+         * m_local mode.
+         *
+         * @param err definition of the error that happened during the
+         *            execution of NBO operation (empty for no error)
+         *
+         * @return Zero in case of success, non-zero in case of failure.
+         */
+        int end_nbo_phase_two(const wsrep::mutable_buffer& err);
+
+        /**
+         * Return true if the client is executing an NBO operation.
+         */
+        bool in_nbo() const
+        {
+            return (nbo_meta_.seqno().is_undefined() == false);
+        }
 
         /**
          * Get reference to the client mutex.
          *
          * @return Reference to the client mutex.
          */
-        wsrep::mutex& mutex() { return mutex_; }
+        wsrep::client_mutex& mutex() { return mutex_; }
 
         /**
          * Get server context associated the the client session.
@@ -721,6 +806,11 @@ namespace wsrep
             return toi_meta_;
         }
 
+        const wsrep::ws_meta& nbo_meta() const
+        {
+            return nbo_meta_;
+        }
+
         /**
          * Do sync wait operation. If the method fails, current_error()
          * can be inspected about the reason of error.
@@ -824,8 +914,8 @@ namespace wsrep
          * Client context constuctor. This is protected so that it
          * can be called from derived class constructors only.
          */
-        client_state(wsrep::mutex& mutex,
-                     wsrep::condition_variable& cond,
+        client_state(wsrep::client_mutex& mutex,
+                     wsrep::client_condition_variable& cond,
                      wsrep::server_state& server_state,
                      wsrep::client_service& client_service,
                      const client_id& id,
@@ -843,6 +933,7 @@ namespace wsrep
             , state_hist_()
             , transaction_(*this)
             , toi_meta_()
+            , nbo_meta_()
             , allow_dirty_reads_()
             , sync_wait_gtid_()
             , last_written_gtid_()
@@ -860,15 +951,18 @@ namespace wsrep
         friend class client_toi_mode;
         friend class transaction;
 
-        void do_acquire_ownership(wsrep::unique_lock<wsrep::mutex>& lock);
+        void do_acquire_ownership(
+            wsrep::unique_lock<wsrep::client_mutex>& lock);
         // Wait for sync rollbacker to finish, with lock. Changes state
         // to exec.
         void do_wait_rollback_complete_and_acquire_ownership(
-            wsrep::unique_lock<wsrep::mutex>& lock);
+            wsrep::unique_lock<wsrep::client_mutex>& lock);
         void update_last_written_gtid(const wsrep::gtid&);
         void debug_log_state(const char*) const;
-        void state(wsrep::unique_lock<wsrep::mutex>& lock, enum state state);
-        void mode(wsrep::unique_lock<wsrep::mutex>& lock, enum mode mode);
+        void state(wsrep::unique_lock<wsrep::client_mutex>& lock,
+                   enum state state);
+        void mode(wsrep::unique_lock<wsrep::client_mutex>& lock,
+                  enum mode mode);
 
         // Override current client error status. Optionally provide
         // an error status from the provider if the error was caused
@@ -882,8 +976,8 @@ namespace wsrep
 
         wsrep::thread::id owning_thread_id_;
         bool rollbacker_active_;
-        wsrep::mutex& mutex_;
-        wsrep::condition_variable& cond_;
+        wsrep::client_mutex& mutex_;
+        wsrep::client_condition_variable& cond_;
         wsrep::server_state& server_state_;
         wsrep::client_service& client_service_;
         wsrep::client_id id_;
@@ -893,6 +987,7 @@ namespace wsrep
         std::vector<enum state> state_hist_;
         wsrep::transaction transaction_;
         wsrep::ws_meta toi_meta_;
+        wsrep::ws_meta nbo_meta_;
         bool allow_dirty_reads_;
         wsrep::gtid sync_wait_gtid_;
         wsrep::gtid last_written_gtid_;
@@ -944,6 +1039,7 @@ namespace wsrep
         case wsrep::client_state::m_high_priority: return "high priority";
         case wsrep::client_state::m_toi: return "toi";
         case wsrep::client_state::m_rsu: return "rsu";
+        case wsrep::client_state::m_nbo: return "nbo";
         }
         return "unknown";
     }
@@ -965,12 +1061,12 @@ namespace wsrep
             : client_(client)
             , orig_mode_(client.mode_)
         {
-            wsrep::unique_lock<wsrep::mutex> lock(client.mutex_);
+            wsrep::unique_lock<wsrep::client_mutex> lock(client.mutex_);
             client.mode(lock, wsrep::client_state::m_high_priority);
         }
         virtual ~high_priority_context()
         {
-            wsrep::unique_lock<wsrep::mutex> lock(client_.mutex_);
+            wsrep::unique_lock<wsrep::client_mutex> lock(client_.mutex_);
             assert(client_.mode() == wsrep::client_state::m_high_priority);
             client_.mode(lock, orig_mode_);
         }
@@ -989,12 +1085,12 @@ namespace wsrep
             : client_(client)
             , orig_mode_(client.mode_)
         {
-            wsrep::unique_lock<wsrep::mutex> lock(client.mutex_);
+            wsrep::unique_lock<wsrep::client_mutex> lock(client.mutex_);
             client.mode(lock, wsrep::client_state::m_toi);
         }
         ~client_toi_mode()
         {
-            wsrep::unique_lock<wsrep::mutex> lock(client_.mutex_);
+            wsrep::unique_lock<wsrep::client_mutex> lock(client_.mutex_);
             assert(client_.mode() == wsrep::client_state::m_toi);
             client_.mode(lock, orig_mode_);
         }
@@ -26,6 +26,8 @@
 #define WSREP_UNUSED __attribute__((unused))
 #if __cplusplus >= 201103L
 #define WSREP_OVERRIDE override
+#define WSREP_FINAL final
 #else
 #define WSREP_OVERRIDE
+#define WSREP_FINAL
 #endif // __cplusplus >= 201103L
@@ -23,6 +23,8 @@
 #include "lock.hpp"
 
 #include <cstdlib>
+#include <cerrno>
+#include <ctime>
 
 namespace wsrep
 {
@@ -39,7 +41,11 @@ namespace wsrep
         condition_variable& operator=(const condition_variable&);
     };
 
-    // Default pthreads based condition variable implementation
+    // Default pthreads based condition variable implementation.
+    // In addition to the wsrep::condition_variable interface, waiting
+    // with a lock on wsrep::default_mutex is supported so that it can
+    // be used as a concrete client condition variable type, see
+    // client_mutex.hpp.
     class default_condition_variable : public condition_variable
     {
     public:
@@ -70,6 +76,36 @@ namespace wsrep
         }
 
         void wait(wsrep::unique_lock<wsrep::mutex>& lock)
+        {
+            do_wait(lock);
+        }
+
+        void wait(wsrep::unique_lock<wsrep::default_mutex>& lock)
+        {
+            do_wait(lock);
+        }
+
+        /**
+         * Wait until notified or the absolute time given in abstime
+         * has passed.
+         *
+         * @return Zero if notified, ETIMEDOUT on timeout.
+         */
+        int timedwait(wsrep::unique_lock<wsrep::mutex>& lock,
+                      const struct timespec& abstime)
+        {
+            return do_timedwait(lock, abstime);
+        }
+
+        int timedwait(wsrep::unique_lock<wsrep::default_mutex>& lock,
+                      const struct timespec& abstime)
+        {
+            return do_timedwait(lock, abstime);
+        }
+
+    private:
+        template <class M>
+        void do_wait(wsrep::unique_lock<M>& lock)
         {
             if (pthread_cond_wait(
                     &cond_,
@@ -79,7 +115,22 @@ namespace wsrep
             }
         }
 
-    private:
+        template <class M>
+        int do_timedwait(wsrep::unique_lock<M>& lock,
+                         const struct timespec& abstime)
+        {
+            int const ret(pthread_cond_timedwait(
+                              &cond_,
+                              reinterpret_cast<pthread_mutex_t*>(
+                                  lock.mutex().native()),
+                              &abstime));
+            if (ret && ret != ETIMEDOUT)
+            {
+                throw wsrep::runtime_error("Cond timedwait failed");
+            }
+            return ret;
+        }
+
         pthread_cond_t cond_;
     };
 
@@ -25,6 +25,7 @@
 #define WSREP_HIGH_PRIORITY_SERVICE_HPP
 
 #include "server_state.hpp"
+#include "atomic.hpp"
 
 namespace wsrep
 {
@@ -37,7 +38,9 @@ namespace wsrep
     public:
         high_priority_service(wsrep::server_state& server_state)
             : server_state_(server_state)
-            , must_exit_() { }
+            , must_exit_(false)
+            , context_id_(next_context_id())
+            , switched_context_id_() { }
         virtual ~high_priority_service() { }
 
         int apply(const ws_handle& ws_handle, const ws_meta& ws_meta,
@@ -154,6 +157,27 @@ namespace wsrep
                               const wsrep::const_buffer& ws,
                               wsrep::mutable_buffer& err) = 0;
 
+        /**
+         * Apply NBO begin event.
+         *
+         * The responsibility of the implementation is to start
+         * an asynchronous process which will complete the operation.
+         * The call is done under commit order critical section
+         * and it should return only after the operation has acquired
+         * the resources it needs. The process completing the operation
+         * must switch the client into NBO mode with
+         * client_state::enter_nbo_mode() and release the operation
+         * with client_state::begin_nbo_phase_two() and
+         * client_state::end_nbo_phase_two().
+         *
+         * @params ws_meta Write set meta data
+         * @params ws Write set buffer
+         * @params err Buffer to store error data
+         */
+        virtual int apply_nbo_begin(const wsrep::ws_meta& ws_meta,
+                                    const wsrep::const_buffer& ws,
+                                    wsrep::mutable_buffer& err) = 0;
+
         /**
          * Actions to take after applying a write set was completed.
          */
@@ -200,7 +224,7 @@ namespace wsrep
 
         virtual bool is_replaying() const = 0;
 
-        bool must_exit() const { return must_exit_; }
+        bool must_exit() const { return must_exit_.load(); }
 
         /**
          * Debug facility to crash the server at given point.
@@ -208,8 +232,31 @@ namespace wsrep
         virtual void debug_crash(const char* crash_point) = 0;
 
     protected:
+        // Applier pool retires appliers by setting must_exit_,
+        // possibly from the pool manager thread.
+        friend class applier_pool;
         wsrep::server_state& server_state_;
-        bool must_exit_;
+        std::atomic<bool> must_exit_;
+    private:
+        friend class high_priority_switch;
+        friend class streaming_applier_pool;
+        // Identifiers are never reused, so unlike the address of
+        // a service the identifier cannot match a service which was
+        // released and a new one allocated in its place.
+        static unsigned long long next_context_id()
+        {
+            static std::atomic<unsigned long long> context_id(0);
+            return ++context_id;
+        }
+        // Unique identifier of the service execution context.
+        unsigned long long context_id_;
+        // Identifier of the service whose execution context was
+        // last switched to this service.
+        unsigned long long switched_context_id_;
+        // Forget the execution context switched to this service,
+        // so that the next high_priority_switch switches it again.
+        // Called when the service is reset for reuse.
+        void reset_switched_context() { switched_context_id_ = 0; }
     };
 
     class high_priority_switch
@@ -221,7 +268,17 @@ namespace wsrep
             , current_service_(current_service)
         {
             orig_service_.reset_globals();
-            current_service_.switch_execution_context(orig_service_);
+            // Execution context needs to be switched only if the
+            // current service is not already bound to the original
+            // service, e.g. if the previous fragment of streaming
+            // transaction was applied by the same applier.
+            if (current_service_.switched_context_id_ !=
+                orig_service_.context_id_)
+            {
+                current_service_.switch_execution_context(orig_service_);
+                current_service_.switched_context_id_ =
+                    orig_service_.context_id_;
+            }
             current_service_.store_globals();
         }
         ~high_priority_switch()
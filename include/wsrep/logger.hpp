@@ -27,9 +27,20 @@
 #include <iosfwd>
 #include <sstream>
 
+/**
+ * Maximum debug level compiled in. Debug log call sites with level
+ * above this are removed at compile time, and neither the message
+ * nor the dynamic debug level is evaluated. The default allows
+ * all debug levels. Define as zero to compile out all debug logging.
+ */
+#ifndef WSREP_LIB_MAX_DEBUG_LEVEL
+#define WSREP_LIB_MAX_DEBUG_LEVEL 1024
+#endif /* WSREP_LIB_MAX_DEBUG_LEVEL */
+
 #define WSREP_LOG_DEBUG(debug_level_fn, debug_level, msg)               \
     do {                                                                \
-        if (debug_level_fn >= debug_level) wsrep::log_debug() << msg;   \
+        if (debug_level <= wsrep::log::max_debug_level &&               \
+            debug_level_fn >= debug_level) wsrep::log_debug() << msg;   \
     } while (0)
 
 namespace wsrep
@@ -53,6 +64,12 @@ namespace wsrep
             debug_level_client_state
         };
 
+        /**
+         * Maximum debug level which is compiled in, see
+         * WSREP_LIB_MAX_DEBUG_LEVEL.
+         */
+        static const int max_debug_level = WSREP_LIB_MAX_DEBUG_LEVEL;
+
         /**
          * Signature for user defined logger callback function.
          */
@@ -73,26 +90,15 @@ namespace wsrep
         log(enum wsrep::log::level level, const char* prefix = "")
             : level_(level)
             , prefix_(prefix)
-            , oss_()
+            , oss_(acquire_buffer())
         { }
 
-        ~log()
-        {
-            if (logger_fn_)
-            {
-                logger_fn_(level_, oss_.str().c_str());
-            }
-            else
-            {
-                wsrep::unique_lock<wsrep::mutex> lock(mutex_);
-                os_ << prefix_ << ": " << oss_.str() << std::endl;
-            }
-        }
+        ~log();
 
         template <typename T>
         std::ostream& operator<<(const T& val)
         {
-            return (oss_ << val);
+            return (*oss_ << val);
         }
 
         /**
@@ -100,6 +106,11 @@ namespace wsrep
          */
         static void logger_fn(logger_fn_type);
 
+        /**
+         * Get user defined logger callback function.
+         */
+        static logger_fn_type logger_fn();
+
         /**
          * Set debug log level from client
          */
@@ -110,12 +121,59 @@ namespace wsrep
          */
         static int debug_log_level();
 
+        /**
+         * Default number of messages which can be queued for
+         * asynchronous logging.
+         */
+        static const size_t default_async_capacity = 4096;
+
+        /**
+         * Start asynchronous logging. Messages other than errors
+         * are queued into a bounded lock free ring buffer and written
+         * by a background flusher thread, either into the log stream
+         * or via the user defined logger callback. If the ring buffer
+         * is full, the message is dropped and the drop counter is
+         * incremented. Long messages are truncated.
+         *
+         * Error messages are always written synchronously so that
+         * they are not lost if the process terminates.
+         *
+         * @param capacity Number of messages which can be queued,
+         *        rounded up to the nearest power of two. The capacity
+         *        is fixed on the first call.
+         *
+         * @return Zero on success, non-zero if the flusher thread
+         *         could not be started.
+         */
+        static int start_async(size_t capacity = default_async_capacity);
+
+        /**
+         * Stop asynchronous logging. Queued messages, including
+         * messages being queued concurrently with the call, are
+         * written before the call returns. Messages logged after
+         * the stop has been observed are written synchronously.
+         */
+        static void stop_async();
+
+        /**
+         * Return the number of messages dropped because the
+         * asynchronous logging ring buffer was full.
+         */
+        static size_t async_dropped();
+
     private:
         log(const log&);
         log& operator=(const log&);
+        // Return thread specific formatting buffer, or a new buffer
+        // if the thread specific one is in use by an enclosing
+        // log object.
+        static std::ostream* acquire_buffer();
+        static void release_buffer(std::ostream*);
+        static void write(enum level, const char* prefix, const char* msg);
+        static void* flusher_thread(void*);
         enum level level_;
         const char* prefix_;
-        std::ostringstream oss_;
+        std::ostream* oss_;
         static wsrep::mutex& mutex_;
         static std::ostream& os_;
         static logger_fn_type logger_fn_;
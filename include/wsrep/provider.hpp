@@ -346,6 +346,10 @@ namespace wsrep
 
         /**
          * Enter total order isolation critical section
+         *
+         * For NBO end (commit flag without start transaction flag)
+         * the ws_meta must contain the meta data of the
+         * corresponding NBO begin event on input.
          */
         virtual enum status enter_toi(wsrep::client_id,
                                       const wsrep::key_array& keys,
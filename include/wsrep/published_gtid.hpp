@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/** @file published_gtid.hpp
+ *
+ * GTID which can be read without locking.
+ *
+ * The GTID is published under a sequence lock. Readers retry if
+ * they observe a concurrent update, so they never block writers
+ * or each other. Writers are serialized by an internal mutex, which
+ * is also used by threads waiting for the seqno to advance.
+ */
+
+#ifndef WSREP_PUBLISHED_GTID_HPP
+#define WSREP_PUBLISHED_GTID_HPP
+
+#include "gtid.hpp"
+#include "mutex.hpp"
+#include "condition_variable.hpp"
+#include "atomic.hpp"
+
+namespace wsrep
+{
+    class published_gtid
+    {
+    public:
+        published_gtid();
+
+        /**
+         * Publish a new GTID. The seqno is not allowed to go
+         * backwards within the same history: if the id of the given
+         * GTID equals to the published one and the seqno is not
+         * greater than the published seqno, the GTID is ignored.
+         * Threads waiting in wait() are woken up if the GTID was
+         * published.
+         *
+         * @return True if the GTID was published, false if it was
+         *         ignored.
+         */
+        bool store(const wsrep::gtid& gtid);
+
+        /**
+         * Return the published GTID. This method does not lock.
+         */
+        wsrep::gtid load() const;
+
+        /**
+         * Return seqno of the published GTID. This method does not
+         * lock and is cheaper than load().
+         */
+        wsrep::seqno seqno() const
+        {
+            return wsrep::seqno(seqno_.load(std::memory_order_acquire));
+        }
+
+        /**
+         * Wait until the published seqno is equal to or greater than
+         * the given seqno.
+         *
+         * @param seqno Seqno to wait for
+         * @param timeout Timeout in seconds, negative value to wait
+         *                infinitely.
+         *
+         * @return Zero if the seqno was reached, non-zero on timeout.
+         */
+        int wait(wsrep::seqno seqno, int timeout) const;
+
+    private:
+        published_gtid(const published_gtid&);
+        published_gtid& operator=(const published_gtid&);
+
+        // Sequence number of the lock, odd while an update is
+        // in progress.
+        std::atomic<unsigned long long> sequence_;
+        std::atomic<unsigned long long> id_[2];
+        std::atomic<long long> seqno_;
+        mutable wsrep::default_mutex mutex_;
+        mutable wsrep::default_condition_variable cond_;
+        // Number of threads waiting in wait(), protected by mutex_.
+        mutable size_t waiters_;
+    };
+}
+
+#endif // WSREP_PUBLISHED_GTID_HPP
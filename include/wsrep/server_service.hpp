@@ -32,6 +32,8 @@
 #include "server_state.hpp"
 
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace wsrep
 {
@@ -83,6 +85,23 @@ namespace wsrep
         virtual void release_high_priority_service(
             wsrep::high_priority_service*) = 0;
 
+        /**
+         * Reset a streaming applier service so that it can be reused
+         * for another streaming transaction. This is called when
+         * the streaming applier is returned to the streaming applier
+         * pool (see server_state::streaming_applier_pool_size()).
+         * The transaction of the service has been completed.
+         *
+         * The default implementation returns non-zero, in which case
+         * the services are never pooled.
+         *
+         * @return Zero if the service was reset and can be reused,
+         *         non-zero if the service must be released.
+         */
+        virtual int reset_streaming_applier_service(
+            wsrep::high_priority_service&)
+        { return 1; }
+
         /**
          * Perform a background rollback for a transaction.
          */
@@ -159,6 +178,75 @@ namespace wsrep
         virtual void recover_streaming_appliers(
             wsrep::high_priority_service& high_priority_service) = 0;
 
+        /**
+         * Identifiers of streaming transactions found from the
+         * streaming log.
+         */
+        typedef std::vector<std::pair<wsrep::id, wsrep::transaction_id> >
+        streaming_transactions;
+
+        /**
+         * Scan the streaming log and store the identifiers of all
+         * streaming transactions which have fragments stored.
+         *
+         * Implementing this and recover_streaming_applier() allows
+         * the library to rebuild streaming appliers concurrently
+         * if server_state::streaming_applier_recovery_threads()
+         * is greater than one. The default implementation returns
+         * non-zero, in which case the library falls back to
+         * recover_streaming_appliers().
+         *
+         * This is overload for calls which are done from client context.
+         *
+         * @param client_service Reference to client service object
+         * @param[out] transactions Streaming transactions found
+         *
+         * @return Zero on success, non-zero if the streaming log
+         *         could not be scanned.
+         */
+        virtual int scan_streaming_log(wsrep::client_service&,
+                                       streaming_transactions&)
+        { return 1; }
+
+        /**
+         * Scan the streaming log, overload for calls which are done
+         * from high priority context.
+         *
+         * @param high_priority_service Reference to high priority service
+         *        object.
+         * @param[out] transactions Streaming transactions found
+         *
+         * @return Zero on success, non-zero if the streaming log
+         *         could not be scanned.
+         */
+        virtual int scan_streaming_log(wsrep::high_priority_service&,
+                                       streaming_transactions&)
+        { return 1; }
+
+        /**
+         * Recover a single streaming applier from the streaming log.
+         * The streaming applier has been created and registered
+         * into server state by the library. The implementation must
+         * start the transaction and apply all stored fragments of the
+         * transaction in order.
+         *
+         * The method may be called concurrently from several threads
+         * for different transactions. The globals of the streaming
+         * applier have been stored for the calling thread.
+         *
+         * @param streaming_applier Streaming applier to recover
+         * @param server_id Originating server of the transaction
+         * @param transaction_id Transaction identifier
+         *
+         * @return Zero on success, non-zero on failure. On failure
+         *         the streaming applier is unregistered and released
+         *         by the library.
+         */
+        virtual int recover_streaming_applier(wsrep::high_priority_service&,
+                                              const wsrep::id&,
+                                              const wsrep::transaction_id&)
+        { return 1; }
+
         /**
          * Recover a cluster view change event.
          * The method takes own node ID.
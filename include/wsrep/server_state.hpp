@@ -89,6 +89,9 @@
 #include "transaction_id.hpp"
 #include "logger.hpp"
 #include "provider.hpp"
+#include "streaming_applier_registry.hpp"
+#include "streaming_applier_pool.hpp"
+#include "published_gtid.hpp"
 #include "compiler.hpp"
 
 #include <vector>
@@ -106,6 +109,8 @@ namespace wsrep
     class server_service;
     class client_service;
     class encryption_service;
+    class applier_scheduler;
+    class applier_pool;
 
     /** @class Server Context
      *
@@ -234,6 +239,142 @@ namespace wsrep
          */
         enum rollback_mode rollback_mode() const { return rollback_mode_; }
 
+        /**
+         * Set the maximum number of threads used to roll back
+         * streaming transactions whose originator has left the
+         * cluster. The rollbacks are dispatched to a bounded pool
+         * of worker threads and the view handler waits until the
+         * whole batch has been processed. With values less than two
+         * the transactions are rolled back one after another in
+         * the view handler thread.
+         *
+         * @param threads Maximum number of rollback threads.
+         */
+        void orphaned_sr_rollback_threads(size_t threads)
+        {
+            orphaned_sr_rollback_threads_ = threads;
+        }
+
+        /**
+         * Return the maximum number of threads used to roll back
+         * orphaned streaming transactions.
+         */
+        size_t orphaned_sr_rollback_threads() const
+        {
+            return orphaned_sr_rollback_threads_;
+        }
+
+        /**
+         * Set the maximum number of threads used to recover streaming
+         * appliers from the streaming log at startup and after SST.
+         * Parallel recovery requires that the server service implements
+         * scan_streaming_log() and recover_streaming_applier().
+         * With values less than two the recovery is done by
+         * server_service::recover_streaming_appliers().
+         *
+         * @param threads Maximum number of recovery threads.
+         */
+        void streaming_applier_recovery_threads(size_t threads)
+        {
+            streaming_applier_recovery_threads_ = threads;
+        }
+
+        /**
+         * Return the maximum number of threads used to recover
+         * streaming appliers.
+         */
+        size_t streaming_applier_recovery_threads() const
+        {
+            return streaming_applier_recovery_threads_;
+        }
+
+        /**
+         * Attach applier scheduler to server state. If the scheduler
+         * is attached, write sets passed to on_apply() are applied in
+         * parallel by scheduler worker threads when possible. The
+         * scheduler must be attached before the server connects to
+         * the cluster and detached only after it has disconnected.
+         *
+         * @param scheduler Pointer to applier scheduler, null to detach.
+         */
+        void applier_scheduler(wsrep::applier_scheduler* scheduler)
+        {
+            applier_scheduler_ = scheduler;
+        }
+
+        /**
+         * Return pointer to attached applier scheduler or null if
+         * no scheduler is attached.
+         */
+        wsrep::applier_scheduler* applier_scheduler() const
+        {
+            return applier_scheduler_;
+        }
+
+        /**
+         * Attach applier pool to server state. If the pool is
+         * attached, apply latency of every write set and time spent
+         * waiting for commit order are reported to the pool.
+         * The pool must be attached before it is started and
+         * detached only after it has been stopped.
+         *
+         * @param pool Pointer to applier pool, null to detach.
+         */
+        void applier_pool(wsrep::applier_pool* pool)
+        {
+            applier_pool_ = pool;
+        }
+
+        /**
+         * Return pointer to attached applier pool or null if
+         * no pool is attached.
+         */
+        wsrep::applier_pool* applier_pool() const
+        {
+            return applier_pool_;
+        }
+
+        /**
+         * Set the maximum number of released streaming applier
+         * services which are kept in pool for reuse. Pooling requires
+         * that the server service implements
+         * server_service::reset_streaming_applier_service().
+         * Zero disables pooling. Pooled services are released on
+         * disconnect() and when the final view is delivered. If
+         * the server state is destroyed without disconnecting,
+         * the pool size must be set to zero first.
+         *
+         * @param size Maximum number of pooled services.
+         */
+        void streaming_applier_pool_size(size_t size)
+        {
+            streaming_applier_pool_.max_size(size);
+        }
+
+        /**
+         * Return the maximum number of pooled streaming applier
+         * services.
+         */
+        size_t streaming_applier_pool_size() const
+        {
+            return streaming_applier_pool_.max_size();
+        }
+
+        /**
+         * Return the pool of streaming applier services. Streaming
+         * applier services are acquired from and released into
+         * the pool by the library.
+         */
+        wsrep::streaming_applier_pool& streaming_applier_pool()
+        {
+            return streaming_applier_pool_;
+        }
+
+        const wsrep::streaming_applier_pool& streaming_applier_pool() const
+        {
+            return streaming_applier_pool_;
+        }
+
         /**
          * Registers a streaming client.
          */
@@ -357,15 +498,48 @@ namespace wsrep
         const wsrep::view& current_view() const { return current_view_; }
 
         /**
-         * Set last committed GTID.
+         * Set last committed GTID. Threads waiting in
+         * wait_for_last_committed_seqno() are woken up.
+         *
+         * The library publishes the GTID of every event it passes
+         * through commit order: committed and rolled back
+         * transactions, TOI and NBO events and the dummy write sets
+         * logged via high_priority_service::log_dummy_write_set().
+         * The DBMS needs to call this method only for events it
+         * passes through commit order by itself. Positions which
+         * would move the seqno backwards are ignored.
          */
         void last_committed_gtid(const wsrep::gtid&);
         /**
          * Return the last committed GTID known to be committed
-         * on server.
+         * on server. This method does not lock server state mutex
+         * and can be called frequently without causing contention.
          */
         wsrep::gtid last_committed_gtid() const;
 
+        /**
+         * Return seqno of the last committed GTID. This is cheaper
+         * than last_committed_gtid() if only the seqno is needed.
+         */
+        wsrep::seqno last_committed_seqno() const
+        {
+            return last_committed_gtid_.seqno();
+        }
+
+        /**
+         * Wait until the last committed GTID set by
+         * last_committed_gtid() has reached the given seqno.
+         * Unlike wait_for_gtid(), this does not involve the provider.
+         *
+         * @param seqno Seqno to wait for
+         * @param timeout Timeout in seconds, negative value to wait
+         *                infinitely.
+         *
+         * @return Zero if the seqno was reached, non-zero on timeout.
+         */
+        int wait_for_last_committed_seqno(wsrep::seqno seqno,
+                                          int timeout) const;
+
         /**
          * Wait until all the write sets up to given GTID have been
          * committed.
@@ -610,6 +784,11 @@ namespace wsrep
             , streaming_clients_()
             , streaming_appliers_()
             , streaming_appliers_recovered_()
+            , orphaned_sr_rollback_threads_()
+            , streaming_applier_recovery_threads_()
+            , applier_scheduler_()
+            , applier_pool_()
+            , streaming_applier_pool_(server_service_)
             , provider_()
             , name_(name)
             , id_(wsrep::id::undefined())
@@ -637,6 +816,12 @@ namespace wsrep
         // Interrupt all threads which are waiting for state
         void interrupt_state_waiters(wsrep::unique_lock<wsrep::mutex>&);
 
+        // Apply write set, called from on_apply()
+        int apply(wsrep::high_priority_service&,
+                  const wsrep::ws_handle&,
+                  const wsrep::ws_meta&,
+                  const wsrep::const_buffer&);
+
         // Recover streaming appliers if not already recoverd
         template <class C>
         void recover_streaming_appliers_if_not_recovered(
@@ -682,8 +867,6 @@ namespace wsrep
         typedef std::map<wsrep::client_id, wsrep::client_state*>
         streaming_clients_map;
         streaming_clients_map streaming_clients_;
-        typedef std::map<std::pair<wsrep::id, wsrep::transaction_id>,
-                         wsrep::high_priority_service*> streaming_appliers_map;
         class server_id_cmp
         {
         public:
@@ -698,8 +881,16 @@ namespace wsrep
             wsrep::id server_id_;
         };
 
-        streaming_appliers_map streaming_appliers_;
+        // Streaming appliers are kept in sharded registry which
+        // has its own locking, server state mutex is not needed
+        // for accessing it.
+        wsrep::streaming_applier_registry streaming_appliers_;
         bool streaming_appliers_recovered_;
+        size_t orphaned_sr_rollback_threads_;
+        size_t streaming_applier_recovery_threads_;
+        wsrep::applier_scheduler* applier_scheduler_;
+        wsrep::applier_pool* applier_pool_;
+        wsrep::streaming_applier_pool streaming_applier_pool_;
         wsrep::provider* provider_;
         std::string name_;
         wsrep::id id_;
@@ -712,7 +903,7 @@ namespace wsrep
         wsrep::gtid connected_gtid_;
         wsrep::view previous_primary_view_;
         wsrep::view current_view_;
-        wsrep::gtid last_committed_gtid_;
+        wsrep::published_gtid last_committed_gtid_;
     };
 
 
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/** @file streaming_applier_pool.hpp
+ *
+ * Pool of streaming applier services.
+ *
+ * Streaming applier services are normally created for every streaming
+ * transaction applied and released when the transaction completes.
+ * The pool keeps a configurable number of released services around
+ * so that they can be reused for the following streaming transactions.
+ * A service is reset with server_service::reset_streaming_applier_service()
+ * before it is put into the pool. Services which cannot be reset or
+ * which do not fit into the pool are released as usual.
+ */
+
+#ifndef WSREP_STREAMING_APPLIER_POOL_HPP
+#define WSREP_STREAMING_APPLIER_POOL_HPP
+
+#include "mutex.hpp"
+
+#include <vector>
+
+namespace wsrep
+{
+    class server_service;
+    class client_service;
+    class high_priority_service;
+
+    class streaming_applier_pool
+    {
+    public:
+        /**
+         * @param server_service Server service which creates, resets
+         *        and releases the streaming applier services.
+         */
+        explicit streaming_applier_pool(wsrep::server_service& server_service);
+
+        /**
+         * The pool must have been emptied with clear() before
+         * destruction. Pooled services are released via the server
+         * service, which cannot be relied on while the owning
+         * server state is being destroyed.
+         */
+        ~streaming_applier_pool();
+
+        /**
+         * Set the maximum number of pooled services. Zero disables
+         * pooling. Pooled services exceeding the new maximum are
+         * released.
+         */
+        void max_size(size_t max_size);
+
+        /**
+         * Return the maximum number of pooled services.
+         */
+        size_t max_size() const;
+
+        /**
+         * Get a streaming applier service from the pool or create
+         * a new one if the pool is empty.
+         *
+         * @param orig_hps High priority service requesting the service
+         */
+        wsrep::high_priority_service* acquire(
+            wsrep::high_priority_service& orig_hps);
+
+        /**
+         * Get a streaming applier service from the pool or create
+         * a new one if the pool is empty.
+         *
+         * @param orig_cs Client service requesting the service
+         */
+        wsrep::high_priority_service* acquire(
+            wsrep::client_service& orig_cs);
+
+        /**
+         * Return a streaming applier service to the pool. The service
+         * is released if it cannot be reset or the pool is full.
+         */
+        void release(wsrep::high_priority_service* streaming_applier);
+
+        /**
+         * Release all pooled services.
+         */
+        void clear();
+
+        /**
+         * Return the number of pooled services.
+         */
+        size_t size() const;
+
+        /**
+         * Return the number of services acquired from the pool.
+         */
+        size_t hits() const;
+
+        /**
+         * Return the number of services which had to be created
+         * because the pool was empty.
+         */
+        size_t misses() const;
+    private:
+        streaming_applier_pool(const streaming_applier_pool&);
+        streaming_applier_pool& operator=(const streaming_applier_pool&);
+
+        wsrep::high_priority_service* pop();
+
+        wsrep::server_service& server_service_;
+        mutable wsrep::default_mutex mutex_;
+        std::vector<wsrep::high_priority_service*> services_;
+        size_t max_size_;
+        size_t hits_;
+        size_t misses_;
+    };
+}
+
+#endif // WSREP_STREAMING_APPLIER_POOL_HPP
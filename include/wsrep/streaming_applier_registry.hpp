@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/** @file streaming_applier_registry.hpp
+ *
+ * Registry of streaming appliers.
+ *
+ * Streaming appliers are looked up for every streaming fragment
+ * which is applied. In order to allow fragments of different
+ * transactions to be applied concurrently without contending
+ * on a single lock, the registry is divided into shards which
+ * are selected by digest of (server id, transaction id) and
+ * protected by a shard specific mutex.
+ */
+
+#ifndef WSREP_STREAMING_APPLIER_REGISTRY_HPP
+#define WSREP_STREAMING_APPLIER_REGISTRY_HPP
+
+#include "id.hpp"
+#include "transaction_id.hpp"
+#include "mutex.hpp"
+
+#include <map>
+#include <vector>
+
+namespace wsrep
+{
+    class high_priority_service;
+
+    class streaming_applier_registry
+    {
+    public:
+        typedef std::pair<wsrep::id, wsrep::transaction_id> key_type;
+        typedef std::pair<key_type, wsrep::high_priority_service*> value_type;
+
+        /**
+         * Default number of shards.
+         */
+        static const size_t default_shards = 64;
+
+        /**
+         * @param shards Number of shards. The number is rounded up to
+         *        the nearest power of two.
+         */
+        explicit streaming_applier_registry(size_t shards = default_shards);
+        ~streaming_applier_registry();
+
+        /**
+         * Insert streaming applier into registry.
+         *
+         * @return True if the applier was inserted, false if an applier
+         *         for the same transaction already exists.
+         */
+        bool insert(const wsrep::id& server_id,
+                    const wsrep::transaction_id& transaction_id,
+                    wsrep::high_priority_service* streaming_applier);
+
+        /**
+         * Remove streaming applier from registry.
+         *
+         * @return Pointer to removed applier or null if the applier
+         *         was not found.
+         */
+        wsrep::high_priority_service* erase(
+            const wsrep::id& server_id,
+            const wsrep::transaction_id& transaction_id);
+
+        /**
+         * Find streaming applier.
+         *
+         * @return Pointer to applier or null if the applier was
+         *         not found.
+         */
+        wsrep::high_priority_service* find(
+            const wsrep::id& server_id,
+            const wsrep::transaction_id& transaction_id) const;
+
+        /**
+         * Return a snapshot of registered streaming appliers. The
+         * snapshot is consistent per shard only, concurrent inserts
+         * and removals may or may not be reflected in it.
+         */
+        std::vector<value_type> entries() const;
+
+        /**
+         * Return the number of registered streaming appliers.
+         */
+        size_t size() const;
+
+        /**
+         * Return true if there are no registered streaming appliers.
+         */
+        bool empty() const { return (size() == 0); }
+
+        /**
+         * Return the number of shards.
+         */
+        size_t shards() const { return n_shards_; }
+    private:
+        streaming_applier_registry(const streaming_applier_registry&);
+        streaming_applier_registry& operator=(
+            const streaming_applier_registry&);
+
+        typedef std::map<key_type, wsrep::high_priority_service*> map_type;
+        struct shard
+        {
+            shard() : mutex(), map(), pad() { }
+            wsrep::default_mutex mutex;
+            map_type map;
+            // Keep shards on separate cache lines
+            char pad[64];
+        };
+
+        shard& get_shard(const wsrep::id&, const wsrep::transaction_id&) const;
+
+        size_t n_shards_;
+        shard* shards_;
+    };
+}
+
+#endif // WSREP_STREAMING_APPLIER_REGISTRY_HPP
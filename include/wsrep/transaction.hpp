@@ -26,6 +26,7 @@
 #include "transaction_id.hpp"
 #include "streaming_context.hpp"
 #include "lock.hpp"
+#include "client_mutex.hpp"
 #include "sr_key_set.hpp"
 #include "buffer.hpp"
 
@@ -75,7 +76,7 @@ namespace wsrep
         { return (id_ != wsrep::transaction_id::undefined()); }
 
 
-        void state(wsrep::unique_lock<wsrep::mutex>&, enum state);
+        void state(wsrep::unique_lock<wsrep::client_mutex>&, enum state);
 
         // Return true if the certification of the last
         // fragment succeeded
@@ -132,6 +133,9 @@ namespace wsrep
         bool implicit_deps() const { return implicit_deps_; }
         void implicit_deps(bool implicit) { implicit_deps_ = implicit; }
 
+        bool commutative() const { return commutative_; }
+        void commutative(bool commutative) { commutative_ = commutative; }
+
         int start_transaction(const wsrep::transaction_id& id);
 
         int start_transaction(const wsrep::ws_handle& ws_handle,
@@ -152,9 +156,9 @@ namespace wsrep
 
         int after_row();
 
-        int before_prepare(wsrep::unique_lock<wsrep::mutex>&);
+        int before_prepare(wsrep::unique_lock<wsrep::client_mutex>&);
 
-        int after_prepare(wsrep::unique_lock<wsrep::mutex>&);
+        int after_prepare(wsrep::unique_lock<wsrep::client_mutex>&);
 
         int before_commit();
 
@@ -172,9 +176,9 @@ namespace wsrep
 
         void after_applying();
 
-        bool bf_abort(wsrep::unique_lock<wsrep::mutex>& lock,
+        bool bf_abort(wsrep::unique_lock<wsrep::client_mutex>& lock,
                       wsrep::seqno bf_seqno);
-        bool total_order_bf_abort(wsrep::unique_lock<wsrep::mutex>&,
+        bool total_order_bf_abort(wsrep::unique_lock<wsrep::client_mutex>&,
                                   wsrep::seqno bf_seqno);
 
         void clone_for_replay(const wsrep::transaction& other);
@@ -223,13 +227,13 @@ namespace wsrep
         // as indicated by client_service::interrupted() call.
         // The call will adjust transaction state and set client_state
         // error status accordingly.
-        bool abort_or_interrupt(wsrep::unique_lock<wsrep::mutex>&);
-        int streaming_step(wsrep::unique_lock<wsrep::mutex>&);
-        int certify_fragment(wsrep::unique_lock<wsrep::mutex>&);
-        int certify_commit(wsrep::unique_lock<wsrep::mutex>&);
+        bool abort_or_interrupt(wsrep::unique_lock<wsrep::client_mutex>&);
+        int streaming_step(wsrep::unique_lock<wsrep::client_mutex>&);
+        int certify_fragment(wsrep::unique_lock<wsrep::client_mutex>&);
+        int certify_commit(wsrep::unique_lock<wsrep::client_mutex>&);
         int append_sr_keys_for_commit();
-        int release_commit_order(wsrep::unique_lock<wsrep::mutex>&);
-        void streaming_rollback(wsrep::unique_lock<wsrep::mutex>&);
+        int release_commit_order(wsrep::unique_lock<wsrep::client_mutex>&);
+        void streaming_rollback(wsrep::unique_lock<wsrep::client_mutex>&);
         void clear_fragments();
         void cleanup();
         void debug_log_state(const char*) const;
@@ -251,6 +255,7 @@ namespace wsrep
         int flags_;
         bool pa_unsafe_;
         bool implicit_deps_;
+        bool commutative_;
         bool certified_;
         bool force_bf_rollback_;
         size_t fragments_certified_for_statement_;
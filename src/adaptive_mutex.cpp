@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "wsrep/adaptive_mutex.hpp"
+
+#include <climits>
+#include <cerrno>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <sched.h>
+#include <sys/time.h>
+#endif /* __linux__ */
+
+namespace
+{
+    inline void cpu_relax()
+    {
+#if defined(__i386__) || defined(__x86_64__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        __asm__ __volatile__("yield");
+#endif
+    }
+
+    inline int* futex_word(std::atomic<int>& val)
+    {
+        return reinterpret_cast<int*>(&val);
+    }
+
+#ifdef __linux__
+    //
+    // Wait until woken up if the value of word equals to val. If
+    // abstime is given, wait until realtime clock passes abstime.
+    //
+    // Return zero if woken up, ETIMEDOUT on timeout or other error
+    // code for spurious wakeup.
+    //
+    int futex_wait(std::atomic<int>& word, int val,
+                   const struct timespec* abstime)
+    {
+        long ret;
+        if (abstime)
+        {
+            ret = syscall(SYS_futex, futex_word(word),
+                          FUTEX_WAIT_BITSET | FUTEX_PRIVATE_FLAG
+                          | FUTEX_CLOCK_REALTIME,
+                          val, abstime, 0, FUTEX_BITSET_MATCH_ANY);
+        }
+        else
+        {
+            ret = syscall(SYS_futex, futex_word(word),
+                          FUTEX_WAIT | FUTEX_PRIVATE_FLAG,
+                          val, 0, 0, 0);
+        }
+        return (ret == 0 ? 0 : errno);
+    }
+
+    void futex_wake(std::atomic<int>& word, int count)
+    {
+        (void)syscall(SYS_futex, futex_word(word),
+                      FUTEX_WAKE | FUTEX_PRIVATE_FLAG, count, 0, 0, 0);
+    }
+#else
+    //
+    // Fallback for platforms without futex: the waiting thread yields
+    // the processor until the value changes.
+    //
+    int futex_wait(std::atomic<int>& word, int val,
+                   const struct timespec* abstime)
+    {
+        while (word.load(std::memory_order_acquire) == val)
+        {
+            if (abstime)
+            {
+                struct timeval now;
+                gettimeofday(&now, 0);
+                if (now.tv_sec > abstime->tv_sec ||
+                    (now.tv_sec == abstime->tv_sec &&
+                     now.tv_usec * 1000 >= abstime->tv_nsec))
+                {
+                    return ETIMEDOUT;
+                }
+            }
+            sched_yield();
+        }
+        return 0;
+    }
+
+    void futex_wake(std::atomic<int>&, int)
+    { }
+#endif /* __linux__ */
+}
+
+const size_t wsrep::adaptive_mutex::default_max_spins;
+
+void wsrep::adaptive_mutex::lock_contended()
+{
+    size_t spins(0);
+    while (spins < max_spins_)
+    {
+        ++spins;
+        cpu_relax();
+        int expected(unlocked);
+        if (state_.load(std::memory_order_relaxed) == unlocked &&
+            state_.compare_exchange_weak(expected, locked,
+                                         std::memory_order_acquire))
+        {
+            spins_.fetch_add(spins, std::memory_order_relaxed);
+            return;
+        }
+    }
+    spins_.fetch_add(spins, std::memory_order_relaxed);
+
+    // Mark the mutex contended so that the owner will wake up a
+    // parked waiter on unlock. Once acquired this way, the state
+    // stays contended, which may cause a redundant wakeup but
+    // never a lost one.
+    while (state_.exchange(contended, std::memory_order_acquire) != unlocked)
+    {
+        parks_.fetch_add(1, std::memory_order_relaxed);
+        (void)futex_wait(state_, contended, 0);
+    }
+}
+
+void wsrep::adaptive_mutex::wake()
+{
+    futex_wake(state_, 1);
+}
+
+void wsrep::adaptive_condition_variable::notify_one()
+{
+    seq_.fetch_add(1);
+    if (waiters_.load() > 0)
+    {
+        futex_wake(seq_, 1);
+    }
+}
+
+void wsrep::adaptive_condition_variable::notify_all()
+{
+    seq_.fetch_add(1);
+    if (waiters_.load() > 0)
+    {
+        futex_wake(seq_, INT_MAX);
+    }
+}
+
+int wsrep::adaptive_condition_variable::do_wait(
+    wsrep::mutex& mutex, const struct timespec* abstime)
+{
+    waits_.fetch_add(1, std::memory_order_relaxed);
+    // The sequence number is read while holding the mutex, so a
+    // notification sent after the mutex is released changes it and
+    // the futex wait returns immediately.
+    int const seq(seq_.load());
+    waiters_.fetch_add(1);
+    mutex.unlock();
+    int const ret(futex_wait(seq_, seq, abstime));
+    waiters_.fetch_sub(1);
+    mutex.lock();
+    return (ret == ETIMEDOUT ? ETIMEDOUT : 0);
+}
@@ -0,0 +1,412 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "wsrep/applier_pool.hpp"
+#include "wsrep/server_state.hpp"
+#include "wsrep/high_priority_service.hpp"
+#include "wsrep/provider.hpp"
+#include "wsrep/logger.hpp"
+#include "wsrep/compiler.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <sys/time.h>
+
+wsrep::applier_pool::applier_pool(wsrep::server_state& server_state,
+                                  service& service,
+                                  const params& params)
+    : server_state_(server_state)
+    , service_(service)
+    , params_(params)
+    , mutex_()
+    , cond_()
+    , appliers_()
+    , running_()
+    , target_()
+    , retire_(0)
+    , applied_(0)
+    , apply_ns_(0)
+    , commit_order_wait_ns_(0)
+    , manager_()
+    , manager_started_()
+    , stopping_()
+{
+    params_.min_appliers = std::max(params_.min_appliers, size_t(1));
+    params_.max_appliers = std::max(params_.max_appliers,
+                                    params_.min_appliers);
+}
+
+wsrep::applier_pool::~applier_pool()
+{
+    stop();
+}
+
+int wsrep::applier_pool::start()
+{
+    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    assert(manager_started_ == false);
+    target_ = params_.min_appliers;
+    while (running_ < target_)
+    {
+        if (start_applier(lock))
+        {
+            return 1;
+        }
+    }
+    if (pthread_create(&manager_, 0, manager_thread, this))
+    {
+        wsrep::log_error() << "Failed to start applier pool manager";
+        return 1;
+    }
+    manager_started_ = true;
+    wsrep::log_info() << "Started applier pool with " << running_
+                      << " appliers, maximum " << params_.max_appliers;
+    return 0;
+}
+
+void wsrep::applier_pool::stop()
+{
+    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    stopping_ = true;
+    cond_.notify_all();
+    if (manager_started_)
+    {
+        lock.unlock();
+        pthread_join(manager_, 0);
+        lock.lock();
+        manager_started_ = false;
+    }
+    for (std::list<applier>::iterator i(appliers_.begin());
+         i != appliers_.end(); ++i)
+    {
+        lock.unlock();
+        pthread_join(i->thread, 0);
+        lock.lock();
+    }
+    appliers_.clear();
+    running_ = 0;
+    retire_.store(0, std::memory_order_relaxed);
+    stopping_ = false;
+}
+
+void wsrep::applier_pool::applied(
+    wsrep::high_priority_service& high_priority_service,
+    long long apply_ns)
+{
+    applied_.fetch_add(1, std::memory_order_relaxed);
+    apply_ns_.fetch_add(apply_ns, std::memory_order_relaxed);
+    if (retire_.load(std::memory_order_relaxed) == 0)
+    {
+        return;
+    }
+    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    if (retire_.load(std::memory_order_relaxed) == 0)
+    {
+        return;
+    }
+    for (std::list<applier>::iterator i(appliers_.begin());
+         i != appliers_.end(); ++i)
+    {
+        if (i->high_priority_service == &high_priority_service &&
+            i->retired == false)
+        {
+            // Applier exits from the provider applier loop after
+            // returning from the apply callback.
+            retire_applier(lock, *i);
+            break;
+        }
+    }
+}
+
+size_t wsrep::applier_pool::appliers() const
+{
+    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    return running_;
+}
+
+size_t wsrep::applier_pool::target() const
+{
+    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    return target_;
+}
+
+size_t wsrep::applier_pool::target_appliers(const params& params,
+                                            size_t current,
+                                            const sample& sample,
+                                            size_t& idle)
+{
+    if (current < params.min_appliers)
+    {
+        idle = 0;
+        return params.min_appliers;
+    }
+    if (current > params.max_appliers)
+    {
+        idle = 0;
+        return params.max_appliers;
+    }
+
+    const double busy(
+        sample.interval_ns > 0 && current > 0 ?
+        double(sample.apply_ns) / (double(sample.interval_ns) * current) : 0);
+    const double commit_order_wait(
+        sample.apply_ns > 0 ?
+        double(sample.commit_order_wait_ns) / sample.apply_ns : 0);
+
+    // Appliers are mostly waiting for each other, adding more
+    // would only increase contention.
+    if (commit_order_wait > params.commit_order_wait_ratio)
+    {
+        idle = 0;
+        return std::max(current - 1, params.min_appliers);
+    }
+
+    // Write sets are queueing up, scale out fast to catch up.
+    if (sample.recv_queue_length > params.scale_out_queue_length ||
+        (sample.recv_queue_length > 0 && busy > 1 - params.idle_ratio))
+    {
+        idle = 0;
+        return std::min(std::max(current * 2, current + 1),
+                        params.max_appliers);
+    }
+
+    // Scale in slowly, one applier after a number of idle intervals.
+    if (sample.recv_queue_length == 0 && busy < params.idle_ratio)
+    {
+        if (++idle >= params.idle_intervals)
+        {
+            idle = 0;
+            return std::max(current - 1, params.min_appliers);
+        }
+    }
+    else
+    {
+        idle = 0;
+    }
+    return current;
+}
+
+void* wsrep::applier_pool::applier_thread(void* arg)
+{
+    applier* a(static_cast<applier*>(arg));
+    a->pool.run_applier(*a);
+    return 0;
+}
+
+void* wsrep::applier_pool::manager_thread(void* arg)
+{
+    static_cast<wsrep::applier_pool*>(arg)->run_manager();
+    return 0;
+}
+
+void wsrep::applier_pool::run_applier(applier& a)
+{
+    wsrep::high_priority_service* high_priority_service(
+        service_.applier_service());
+    {
+        wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+        a.high_priority_service = high_priority_service;
+    }
+    enum wsrep::provider::status ret(
+        server_state_.provider().run_applier(high_priority_service));
+    WSREP_LOG_DEBUG(wsrep::log::debug_log_level(),
+                    wsrep::log::debug_level_server_state,
+                    "Applier thread exited with status " << ret);
+    {
+        wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+        a.high_priority_service = 0;
+        if (a.retired == false)
+        {
+            --running_;
+        }
+    }
+    service_.release_applier_service(high_priority_service);
+    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    a.exited = true;
+}
+
+int wsrep::applier_pool::start_applier(
+    wsrep::unique_lock<wsrep::mutex>& lock WSREP_UNUSED)
+{
+    assert(lock.owns_lock());
+    appliers_.push_back(applier(*this));
+    if (pthread_create(&appliers_.back().thread, 0, applier_thread,
+                       &appliers_.back()))
+    {
+        appliers_.pop_back();
+        wsrep::log_error() << "Failed to start applier thread";
+        return 1;
+    }
+    ++running_;
+    return 0;
+}
+
+void wsrep::applier_pool::retire_applier(
+    wsrep::unique_lock<wsrep::mutex>& lock WSREP_UNUSED,
+    applier& a)
+{
+    assert(lock.owns_lock());
+    assert(a.retired == false);
+    assert(a.high_priority_service);
+    a.retired = true;
+    --running_;
+    retire_.fetch_sub(1, std::memory_order_relaxed);
+    a.high_priority_service->must_exit_ = true;
+    WSREP_LOG_DEBUG(wsrep::log::debug_log_level(),
+                    wsrep::log::debug_level_server_state,
+                    "Retiring applier, " << running_
+                    << " appliers remaining");
+}
+
+void wsrep::applier_pool::retire_idle_appliers(
+    wsrep::unique_lock<wsrep::mutex>& lock)
+{
+    assert(lock.owns_lock());
+    // Appliers are blocked in the provider waiting for write sets
+    // and would not be retired in applied() until write sets arrive.
+    // Retire the most recently started ones and wake them up.
+    for (std::list<applier>::reverse_iterator i(appliers_.rbegin());
+         i != appliers_.rend() &&
+             retire_.load(std::memory_order_relaxed) > 0; ++i)
+    {
+        if (i->retired == false && i->high_priority_service)
+        {
+            retire_applier(lock, *i);
+            service_.wake_applier(*i->high_priority_service);
+        }
+    }
+}
+
+void wsrep::applier_pool::reap_appliers(
+    wsrep::unique_lock<wsrep::mutex>& lock WSREP_UNUSED)
+{
+    assert(lock.owns_lock());
+    std::list<applier>::iterator i(appliers_.begin());
+    while (i != appliers_.end())
+    {
+        if (i->exited)
+        {
+            // The thread has released all resources, so joining
+            // under the lock does not block for long.
+            pthread_join(i->thread, 0);
+            i = appliers_.erase(i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
+long long wsrep::applier_pool::recv_queue_length() const
+{
+    const std::vector<wsrep::provider::status_variable> status(
+        server_state_.provider().status());
+    for (std::vector<wsrep::provider::status_variable>::const_iterator
+             i(status.begin()); i != status.end(); ++i)
+    {
+        if (i->name() == params_.recv_queue_status)
+        {
+            return std::strtoll(i->value().c_str(), 0, 10);
+        }
+    }
+    return 0;
+}
+
+void wsrep::applier_pool::run_manager()
+{
+    size_t idle(0);
+    std::chrono::steady_clock::time_point last(
+        std::chrono::steady_clock::now());
+    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    while (stopping_ == false)
+    {
+        struct timeval now;
+        gettimeofday(&now, 0);
+        long long const usec(now.tv_usec + params_.interval_ms * 1000LL);
+        struct timespec abstime;
+        abstime.tv_sec = now.tv_sec + usec / 1000000;
+        abstime.tv_nsec = (usec % 1000000) * 1000;
+        cond_.timedwait(lock, abstime);
+        if (stopping_)
+        {
+            break;
+        }
+        reap_appliers(lock);
+
+        lock.unlock();
+        const std::chrono::steady_clock::time_point now_tp(
+            std::chrono::steady_clock::now());
+        sample s;
+        s.interval_ns = std::chrono::duration_cast<
+            std::chrono::nanoseconds>(now_tp - last).count();
+        s.applied = applied_.exchange(0, std::memory_order_relaxed);
+        s.apply_ns = apply_ns_.exchange(0, std::memory_order_relaxed);
+        s.commit_order_wait_ns = commit_order_wait_ns_.exchange(
+            0, std::memory_order_relaxed);
+        s.recv_queue_length = recv_queue_length();
+        last = now_tp;
+        lock.lock();
+
+        if (stopping_)
+        {
+            break;
+        }
+        // Appliers which are still to be retired are not counted.
+        const size_t retire(retire_.load(std::memory_order_relaxed));
+        const size_t current(running_ > retire ? running_ - retire : 0);
+        const size_t target(target_appliers(params_, current, s, idle));
+        if (target != target_)
+        {
+            WSREP_LOG_DEBUG(
+                wsrep::log::debug_log_level(),
+                wsrep::log::debug_level_server_state,
+                "Applier pool: applied " << s.applied
+                << " apply ns " << s.apply_ns
+                << " commit order wait ns " << s.commit_order_wait_ns
+                << " recv queue " << s.recv_queue_length
+                << ", adjusting appliers " << current << " -> " << target);
+        }
+        target_ = target;
+        if (target > current)
+        {
+            // Cancel pending retirements first.
+            size_t add(target - current);
+            while (add > 0 && retire_.load(std::memory_order_relaxed) > 0)
+            {
+                retire_.fetch_sub(1, std::memory_order_relaxed);
+                --add;
+            }
+            while (add > 0 && start_applier(lock) == 0)
+            {
+                --add;
+            }
+        }
+        else if (target < current)
+        {
+            retire_.fetch_add(current - target, std::memory_order_relaxed);
+            if (s.applied == 0)
+            {
+                retire_idle_appliers(lock);
+            }
+        }
+    }
+}
@@ -0,0 +1,310 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "wsrep/applier_scheduler.hpp"
+#include "wsrep/server_state.hpp"
+#include "wsrep/high_priority_service.hpp"
+#include "wsrep/logger.hpp"
+#include "wsrep/compiler.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+const size_t wsrep::applier_scheduler::default_max_queued;
+
+wsrep::applier_scheduler::applier_scheduler(wsrep::server_state& server_state,
+                                            size_t max_queued)
+    : server_state_(server_state)
+    , max_queued_(std::max(max_queued, size_t(1)))
+    , mutex_()
+    , worker_cond_()
+    , producer_cond_()
+    , workers_()
+    , queue_()
+    , in_flight_()
+    , affinity_()
+    , next_worker_()
+    , applied_()
+    , stopping_()
+{ }
+
+wsrep::applier_scheduler::~applier_scheduler()
+{
+    stop();
+}
+
+int wsrep::applier_scheduler::start(
+    const std::vector<wsrep::high_priority_service*>& services)
+{
+    assert(workers_.empty());
+    workers_.resize(services.size());
+    for (size_t i(0); i < services.size(); ++i)
+    {
+        workers_[i].scheduler = this;
+        workers_[i].index = i;
+        workers_[i].high_priority_service = services[i];
+    }
+    for (size_t i(0); i < workers_.size(); ++i)
+    {
+        if (pthread_create(&workers_[i].thread, 0, worker_thread,
+                           &workers_[i]))
+        {
+            wsrep::log_error() << "Failed to start applier worker thread";
+            workers_.resize(i);
+            stop();
+            return 1;
+        }
+    }
+    wsrep::log_info() << "Started " << workers_.size()
+                      << " parallel applier threads";
+    return 0;
+}
+
+void wsrep::applier_scheduler::stop()
+{
+    if (workers_.empty())
+    {
+        return;
+    }
+    {
+        wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+        stopping_ = true;
+        worker_cond_.notify_all();
+    }
+    for (size_t i(0); i < workers_.size(); ++i)
+    {
+        pthread_join(workers_[i].thread, 0);
+    }
+    workers_.clear();
+    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    assert(queue_.empty());
+    affinity_.clear();
+    stopping_ = false;
+}
+
+bool wsrep::applier_scheduler::schedulable(
+    const wsrep::ws_meta& ws_meta) const
+{
+    if (workers_.empty() || ws_meta.ordered() == false)
+    {
+        return false;
+    }
+    const int one_shot(wsrep::provider::flag::start_transaction |
+                       wsrep::provider::flag::commit);
+    if ((ws_meta.flags() & ~wsrep::provider::flag::commutative) == one_shot)
+    {
+        return true;
+    }
+    // Fragments of streaming transactions.
+    return ((ws_meta.flags() & one_shot) != one_shot &&
+            (ws_meta.flags() & (wsrep::provider::flag::isolation |
+                                wsrep::provider::flag::commutative |
+                                wsrep::provider::flag::native |
+                                wsrep::provider::flag::prepare)) == 0);
+}
+
+bool wsrep::applier_scheduler::is_worker(
+    const wsrep::high_priority_service* high_priority_service) const
+{
+    for (std::vector<worker>::const_iterator i(workers_.begin());
+         i != workers_.end(); ++i)
+    {
+        if (i->high_priority_service == high_priority_service)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+int wsrep::applier_scheduler::enqueue(const wsrep::ws_handle& ws_handle,
+                                      const wsrep::ws_meta& ws_meta,
+                                      const wsrep::const_buffer& data)
+{
+    assert(schedulable(ws_meta));
+    write_set ws(ws_handle, ws_meta, data);
+    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    while (queue_.size() >= max_queued_)
+    {
+        producer_cond_.wait(lock);
+    }
+    if (wsrep::starts_transaction(ws_meta.flags()) == false ||
+        wsrep::commits_transaction(ws_meta.flags()) == false)
+    {
+        ws.worker_index = affine_worker(lock, ws_meta);
+    }
+    in_flight_.insert(ws_meta.seqno().get());
+    // With several receiving threads write sets may be queued out
+    // of order, keep the queue in seqno order.
+    std::deque<write_set*>::iterator pos(queue_.end());
+    while (pos != queue_.begin() &&
+           ws_meta.seqno() < (*(pos - 1))->ws_meta.seqno())
+    {
+        --pos;
+    }
+    queue_.insert(pos, &ws);
+    // The write set may be pinned to a worker, wake up all workers
+    // so that the right one gets to see it.
+    worker_cond_.notify_all();
+    while (ws.done == false)
+    {
+        producer_cond_.wait(lock);
+    }
+    return ws.result;
+}
+
+void wsrep::applier_scheduler::drain(wsrep::seqno seqno)
+{
+    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    while (in_flight_.empty() == false &&
+           (seqno.is_undefined() || *in_flight_.begin() < seqno.get()))
+    {
+        producer_cond_.wait(lock);
+    }
+}
+
+size_t wsrep::applier_scheduler::applied() const
+{
+    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    return applied_;
+}
+
+void* wsrep::applier_scheduler::worker_thread(void* arg)
+{
+    worker* w(static_cast<worker*>(arg));
+    w->scheduler->run_worker(w->index);
+    return 0;
+}
+
+size_t wsrep::applier_scheduler::affine_worker(
+    wsrep::unique_lock<wsrep::mutex>& lock WSREP_UNUSED,
+    const wsrep::ws_meta& ws_meta)
+{
+    assert(lock.owns_lock());
+    const std::pair<wsrep::id, wsrep::transaction_id> key(
+        ws_meta.server_id(), ws_meta.transaction_id());
+    const bool last_fragment(
+        wsrep::commits_transaction(ws_meta.flags()) ||
+        wsrep::rolls_back_transaction(ws_meta.flags()));
+    std::map<std::pair<wsrep::id, wsrep::transaction_id>, size_t>::iterator
+        i(affinity_.find(key));
+    size_t ret;
+    if (i == affinity_.end())
+    {
+        ret = next_worker_++ % workers_.size();
+        if (last_fragment == false)
+        {
+            affinity_.insert(std::make_pair(key, ret));
+        }
+    }
+    else
+    {
+        ret = i->second;
+        if (last_fragment)
+        {
+            affinity_.erase(i);
+        }
+    }
+    return ret;
+}
+
+wsrep::applier_scheduler::write_set*
+wsrep::applier_scheduler::next_ready(
+    wsrep::unique_lock<wsrep::mutex>& lock WSREP_UNUSED,
+    size_t index)
+{
+    assert(lock.owns_lock());
+    // Write set can be started if none of the queued or running
+    // write sets with seqno less than or equal to depends_on is
+    // still in flight. Write sets which are ready may overtake
+    // the ones which are still waiting for their dependencies.
+    // Commutative write sets do not have dependencies.
+    //
+    // Write sets pinned to a worker are applied only by that worker.
+    // The worker must not start a write set which follows its own
+    // pinned write set which is not ready: the following write set
+    // could wait in commit order for the pinned one, which no other
+    // worker can apply.
+    const long long min_in_flight(
+        in_flight_.empty() ? 0 : *in_flight_.begin());
+    for (std::deque<write_set*>::iterator i(queue_.begin());
+         i != queue_.end(); ++i)
+    {
+        if ((*i)->worker_index != write_set::any_worker &&
+            (*i)->worker_index != index)
+        {
+            continue;
+        }
+        const bool ready(wsrep::is_commutative((*i)->ws_meta.flags()) ||
+                         (*i)->ws_meta.depends_on().get() < min_in_flight);
+        if (ready == false && (*i)->worker_index == index)
+        {
+            break;
+        }
+        if (ready)
+        {
+            write_set* ret(*i);
+            queue_.erase(i);
+            producer_cond_.notify_all();
+            return ret;
+        }
+    }
+    return 0;
+}
+
+void wsrep::applier_scheduler::run_worker(size_t index)
+{
+    wsrep::high_priority_service& high_priority_service(
+        *workers_[index].high_priority_service);
+    high_priority_service.store_globals();
+    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    for (;;)
+    {
+        write_set* ws;
+        while ((ws = next_ready(lock, index)) == 0)
+        {
+            if (stopping_ && queue_.empty())
+            {
+                high_priority_service.reset_globals();
+                return;
+            }
+            worker_cond_.wait(lock);
+        }
+        lock.unlock();
+        int const ret(server_state_.on_apply(high_priority_service,
+                                             ws->ws_handle, ws->ws_meta,
+                                             ws->data));
+        lock.lock();
+        if (ret)
+        {
+            wsrep::log_error() << "Failed to apply write set "
+                               << ws->ws_meta;
+        }
+        in_flight_.erase(ws->ws_meta.seqno().get());
+        ++applied_;
+        // The receiving thread waiting in enqueue() may return and
+        // destroy the write set once it is done.
+        ws->result = ret;
+        ws->done = true;
+        // Completion may make write sets waiting for their
+        // dependencies ready.
+        worker_cond_.notify_all();
+        producer_cond_.notify_all();
+    }
+}
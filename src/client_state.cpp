@@ -32,7 +32,7 @@ wsrep::provider& wsrep::client_state::provider() const
 
 void wsrep::client_state::open(wsrep::client_id id)
 {
-    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    wsrep::unique_lock<wsrep::client_mutex> lock(mutex_);
     assert(state_ == s_none);
     debug_log_state("open: enter");
     owning_thread_id_ = wsrep::this_thread::get_id();
@@ -46,7 +46,7 @@ void wsrep::client_state::open(wsrep::client_id id)
 
 void wsrep::client_state::close()
 {
-    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    wsrep::unique_lock<wsrep::client_mutex> lock(mutex_);
     debug_log_state("close: enter");
     state(lock, s_quitting);
     lock.unlock();
@@ -64,7 +64,7 @@ void wsrep::client_state::close()
 
 void wsrep::client_state::cleanup()
 {
-    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    wsrep::unique_lock<wsrep::client_mutex> lock(mutex_);
     debug_log_state("cleanup: enter");
     state(lock, s_none);
     debug_log_state("cleanup: leave");
@@ -85,7 +85,7 @@ void wsrep::client_state::override_error(enum wsrep::client_error error,
 
 int wsrep::client_state::before_command()
 {
-    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    wsrep::unique_lock<wsrep::client_mutex> lock(mutex_);
     debug_log_state("before_command: enter");
     // If the state is s_exec, the processing thread has already grabbed
     // control with wait_rollback_complete_and_acquire_ownership()
@@ -148,7 +148,7 @@ int wsrep::client_state::before_command()
 
 void wsrep::client_state::after_command_before_result()
 {
-    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    wsrep::unique_lock<wsrep::client_mutex> lock(mutex_);
     debug_log_state("after_command_before_result: enter");
     assert(state() == s_exec);
     if (transaction_.active() &&
@@ -168,7 +168,7 @@ void wsrep::client_state::after_command_before_result()
 
 void wsrep::client_state::after_command_after_result()
 {
-    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    wsrep::unique_lock<wsrep::client_mutex> lock(mutex_);
     debug_log_state("after_command_after_result_enter");
     assert(state() == s_result);
     assert(transaction_.state() != wsrep::transaction::s_aborting);
@@ -192,7 +192,7 @@ void wsrep::client_state::after_command_after_result()
 
 int wsrep::client_state::before_statement()
 {
-    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    wsrep::unique_lock<wsrep::client_mutex> lock(mutex_);
     debug_log_state("before_statement: enter");
 #if 0
     /**
@@ -219,7 +219,7 @@ int wsrep::client_state::before_statement()
 
 int wsrep::client_state::after_statement()
 {
-    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    wsrep::unique_lock<wsrep::client_mutex> lock(mutex_);
     debug_log_state("after_statement: enter");
     assert(state() == s_exec);
     assert(mode() == m_local);
@@ -266,7 +266,7 @@ int wsrep::client_state::after_statement()
 
 void wsrep::client_state::sync_rollback_complete()
 {
-    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    wsrep::unique_lock<wsrep::client_mutex> lock(mutex_);
     debug_log_state("sync_rollback_complete: enter");
     assert(state_ == s_idle && mode_ == m_local &&
            transaction_.state() == wsrep::transaction::s_aborted);
@@ -277,7 +277,7 @@ void wsrep::client_state::sync_rollback_complete()
 
 void wsrep::client_state::wait_rollback_complete_and_acquire_ownership()
 {
-    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    wsrep::unique_lock<wsrep::client_mutex> lock(mutex_);
     debug_log_state("wait_rollback_complete_and_acquire_ownership: enter");
     if (state_ == s_idle)
     {
@@ -325,13 +325,27 @@ void wsrep::client_state::disable_streaming()
     transaction_.streaming_context().disable();
 }
 
+int wsrep::client_state::mark_commutative()
+{
+    assert(mode_ == m_local);
+    assert(state_ == s_exec);
+    if (transaction_.is_streaming())
+    {
+        wsrep::log_error()
+            << "Streaming transaction cannot be marked commutative";
+        return 1;
+    }
+    transaction_.commutative(true);
+    return 0;
+}
+
 //////////////////////////////////////////////////////////////////////////////
 //                                 TOI                                      //
 //////////////////////////////////////////////////////////////////////////////
 
 void wsrep::client_state::enter_toi_common()
 {
-    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    wsrep::unique_lock<wsrep::client_mutex> lock(mutex_);
     toi_mode_ = mode_;
     mode(lock, m_toi);
 }
@@ -369,7 +383,7 @@ void wsrep::client_state::enter_toi_mode(const wsrep::ws_meta& ws_meta)
 
 void wsrep::client_state::leave_toi_common()
 {
-    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    wsrep::unique_lock<wsrep::client_mutex> lock(mutex_);
     mode(lock, toi_mode_);
     toi_mode_ = m_undefined;
     if (toi_meta_.gtid().is_undefined() == false)
@@ -382,9 +396,18 @@ void wsrep::client_state::leave_toi_common()
 int wsrep::client_state::leave_toi_local(const wsrep::mutable_buffer& err)
 {
     assert(toi_mode_ == m_local);
+    const wsrep::gtid gtid(toi_meta_.gtid());
     leave_toi_common();
 
-    return (provider().leave_toi(id_, err) == provider::success ? 0 : 1);
+    if (provider().leave_toi(id_, err) != provider::success)
+    {
+        return 1;
+    }
+    if (gtid.is_undefined() == false)
+    {
+        server_state_.last_committed_gtid(gtid);
+    }
+    return 0;
 }
 
 void wsrep::client_state::leave_toi_mode()
@@ -418,7 +441,7 @@ int wsrep::client_state::begin_rsu(int timeout)
         return 1;
     }
     wsrep::log_info() << "Provider paused at: " << pause_seqno;
-    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    wsrep::unique_lock<wsrep::client_mutex> lock(mutex_);
     toi_mode_ = mode_;
     mode(lock, m_rsu);
     return 0;
@@ -437,13 +460,171 @@ int wsrep::client_state::end_rsu()
         wsrep::log_warning() << "End RSU failed: " << e.what();
         ret = 1;
     }
-    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    wsrep::unique_lock<wsrep::client_mutex> lock(mutex_);
     mode(lock, toi_mode_);
     return ret;
 }
 
 
 
+///////////////////////////////////////////////////////////////////////////////
+//                                 NBO                                       //
+///////////////////////////////////////////////////////////////////////////////
+
+int wsrep::client_state::begin_nbo_phase_one(const wsrep::key_array& keys,
+                                             const wsrep::const_buffer& buffer)
+{
+    debug_log_state("begin_nbo_phase_one: enter");
+    assert(state_ == s_exec);
+    assert(mode_ == m_local);
+    assert(toi_mode_ == m_undefined);
+    enum wsrep::provider::status status(
+        provider().enter_toi(id_, keys, buffer, toi_meta_,
+                             wsrep::provider::flag::start_transaction));
+    wsrep::unique_lock<wsrep::client_mutex> lock(mutex_);
+    int ret;
+    switch (status)
+    {
+    case wsrep::provider::success:
+        toi_mode_ = mode_;
+        nbo_meta_ = toi_meta_;
+        mode(lock, m_nbo);
+        ret = 0;
+        break;
+    default:
+        toi_meta_ = wsrep::ws_meta();
+        override_error(wsrep::e_error_during_commit, status);
+        ret = 1;
+        break;
+    }
+    debug_log_state("begin_nbo_phase_one: leave");
+    return ret;
+}
+
+int wsrep::client_state::end_nbo_phase_one(const wsrep::mutable_buffer& err)
+{
+    debug_log_state("end_nbo_phase_one: enter");
+    assert(state_ == s_exec);
+    assert(mode_ == m_nbo);
+    assert(in_toi());
+    enum wsrep::provider::status status(provider().leave_toi(id_, err));
+    wsrep::unique_lock<wsrep::client_mutex> lock(mutex_);
+    int ret;
+    wsrep::gtid gtid;
+    switch (status)
+    {
+    case wsrep::provider::success:
+        gtid = toi_meta_.gtid();
+        ret = 0;
+        break;
+    default:
+        override_error(wsrep::e_error_during_commit, status);
+        ret = 1;
+        break;
+    }
+    if (toi_meta_.gtid().is_undefined() == false)
+    {
+        update_last_written_gtid(toi_meta_.gtid());
+    }
+    toi_meta_ = wsrep::ws_meta();
+    toi_mode_ = m_undefined;
+    debug_log_state("end_nbo_phase_one: leave");
+    if (gtid.is_undefined() == false)
+    {
+        // Publish the position outside of client mutex, server state
+        // mutex is taken to wake up waiters.
+        lock.unlock();
+        server_state_.last_committed_gtid(gtid);
+    }
+    return ret;
+}
+
+int wsrep::client_state::enter_nbo_mode(const wsrep::ws_meta& ws_meta)
+{
+    assert(state_ == s_exec);
+    assert(mode_ == m_local);
+    assert(toi_mode_ == m_undefined);
+    wsrep::unique_lock<wsrep::client_mutex> lock(mutex_);
+    nbo_meta_ = ws_meta;
+    mode(lock, m_nbo);
+    return 0;
+}
+
+int wsrep::client_state::begin_nbo_phase_two(const wsrep::key_array& keys)
+{
+    debug_log_state("begin_nbo_phase_two: enter");
+    assert(state_ == s_exec);
+    assert(mode_ == m_nbo);
+    assert(toi_mode_ == m_undefined);
+    assert(in_toi() == false);
+    // The meta data of NBO begin is passed to the provider so that
+    // the provider can match the NBO end with the corresponding
+    // NBO begin. The provider assigns the meta data of NBO end
+    // into toi_meta_.
+    wsrep::ws_meta meta(nbo_meta_);
+    enum wsrep::provider::status status(
+        provider().enter_toi(id_, keys, wsrep::const_buffer(), meta,
+                             wsrep::provider::flag::commit));
+    wsrep::unique_lock<wsrep::client_mutex> lock(mutex_);
+    int ret;
+    switch (status)
+    {
+    case wsrep::provider::success:
+        toi_meta_ = meta;
+        toi_mode_ = m_local;
+        ret = 0;
+        break;
+    default:
+        // The mode is left as m_nbo as the NBO end was not replicated.
+        override_error(wsrep::e_error_during_commit, status);
+        ret = 1;
+        break;
+    }
+    debug_log_state("begin_nbo_phase_two: leave");
+    return ret;
+}
+
+int wsrep::client_state::end_nbo_phase_two(const wsrep::mutable_buffer& err)
+{
+    debug_log_state("end_nbo_phase_two: enter");
+    assert(state_ == s_exec);
+    assert(mode_ == m_nbo);
+    assert(toi_mode_ == m_local);
+    assert(in_toi());
+    enum wsrep::provider::status status(provider().leave_toi(id_, err));
+    wsrep::unique_lock<wsrep::client_mutex> lock(mutex_);
+    int ret;
+    wsrep::gtid gtid;
+    switch (status)
+    {
+    case wsrep::provider::success:
+        gtid = toi_meta_.gtid();
+        ret = 0;
+        break;
+    default:
+        override_error(wsrep::e_error_during_commit, status);
+        ret = 1;
+        break;
+    }
+    if (toi_meta_.gtid().is_undefined() == false)
+    {
+        update_last_written_gtid(toi_meta_.gtid());
+    }
+    toi_meta_ = wsrep::ws_meta();
+    toi_mode_ = m_undefined;
+    nbo_meta_ = wsrep::ws_meta();
+    mode(lock, m_local);
+    debug_log_state("end_nbo_phase_two: leave");
+    if (gtid.is_undefined() == false)
+    {
+        // Publish the position outside of client mutex, server state
+        // mutex is taken to wake up waiters.
+        lock.unlock();
+        server_state_.last_committed_gtid(gtid);
+    }
+    return ret;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 //                                 Misc                                      //
 ///////////////////////////////////////////////////////////////////////////////
@@ -474,7 +655,7 @@ int wsrep::client_state::sync_wait(int timeout)
 ///////////////////////////////////////////////////////////////////////////////
 
 void wsrep::client_state::do_acquire_ownership(
-    wsrep::unique_lock<wsrep::mutex>& lock WSREP_UNUSED)
+    wsrep::unique_lock<wsrep::client_mutex>& lock WSREP_UNUSED)
 {
     assert(lock.owns_lock());
     // Be strict about client state for clients in local mode. The
@@ -487,7 +668,7 @@ void wsrep::client_state::do_acquire_ownership(
 }
 
 void wsrep::client_state::do_wait_rollback_complete_and_acquire_ownership(
-    wsrep::unique_lock<wsrep::mutex>& lock)
+    wsrep::unique_lock<wsrep::client_mutex>& lock)
 {
     assert(lock.owns_lock());
     assert(state_ == s_idle);
@@ -521,7 +702,7 @@ void wsrep::client_state::debug_log_state(const char* context) const
 }
 
 void wsrep::client_state::state(
-    wsrep::unique_lock<wsrep::mutex>& lock WSREP_UNUSED,
+    wsrep::unique_lock<wsrep::client_mutex>& lock WSREP_UNUSED,
     enum wsrep::client_state::state state)
 {
     // Verify that the current thread has gained control to the
@@ -552,18 +733,19 @@ void wsrep::client_state::state(
 }
 
 void wsrep::client_state::mode(
-    wsrep::unique_lock<wsrep::mutex>& lock WSREP_UNUSED,
+    wsrep::unique_lock<wsrep::client_mutex>& lock WSREP_UNUSED,
     enum mode mode)
 {
     assert(lock.owns_lock());
 
     static const char allowed[n_modes_][n_modes_] =
-        {   /* u  l  h  t  r */
-            {  0, 0, 0, 0, 0 }, /* undefined */
-            {  0, 0, 1, 1, 1 }, /* local */
-            {  0, 1, 0, 1, 0 }, /* high prio */
-            {  0, 1, 1, 0, 0 }, /* toi */
-            {  0, 1, 0, 0, 0 }  /* rsu */
+        {   /* u  l  h  t  r  n */
+            {  0, 0, 0, 0, 0, 0 }, /* undefined */
+            {  0, 0, 1, 1, 1, 1 }, /* local */
+            {  0, 1, 0, 1, 0, 0 }, /* high prio */
+            {  0, 1, 1, 0, 0, 0 }, /* toi */
+            {  0, 1, 0, 0, 0, 0 }, /* rsu */
+            {  0, 1, 0, 0, 0, 0 }  /* nbo */
         };
     if (!allowed[mode_][mode])
     {
@@ -18,20 +18,340 @@
  */
 
 #include "wsrep/logger.hpp"
+#include "wsrep/condition_variable.hpp"
 
 #include <iostream>
+#include <streambuf>
+#include <vector>
+#include <cstring>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/time.h>
 
 std::ostream& wsrep::log::os_ = std::cout;
 static wsrep::default_mutex log_mutex_;
 wsrep::mutex& wsrep::log::mutex_ = log_mutex_;
 wsrep::log::logger_fn_type wsrep::log::logger_fn_ = 0;
 std::atomic_int wsrep::log::debug_log_level_(0);
+const int wsrep::log::max_debug_level;
+const size_t wsrep::log::default_async_capacity;
+
+namespace
+{
+    //
+    // Thread specific formatting buffer. The buffer keeps its
+    // capacity between messages, so formatting a message does not
+    // normally allocate memory.
+    //
+    class format_buffer : public std::streambuf
+    {
+    public:
+        format_buffer()
+            : buf_()
+            , os_(this)
+            , in_use_()
+        { }
+
+        std::ostream& stream() { return os_; }
+        bool in_use() const { return in_use_; }
+        void in_use(bool in_use) { in_use_ = in_use; }
+
+        // Return null terminated message
+        const char* c_str()
+        {
+            buf_.push_back('\0');
+            return &buf_[0];
+        }
+        size_t size() const { return buf_.size(); }
+
+        void reset()
+        {
+            buf_.clear();
+            // Undo formatting changes made by the previous message.
+            os_.clear();
+            os_.flags(std::ios_base::dec | std::ios_base::skipws);
+            os_.width(0);
+            os_.precision(6);
+            os_.fill(' ');
+        }
+    protected:
+        int_type overflow(int_type c)
+        {
+            if (traits_type::eq_int_type(c, traits_type::eof()) == false)
+            {
+                buf_.push_back(traits_type::to_char_type(c));
+            }
+            return traits_type::not_eof(c);
+        }
+
+        std::streamsize xsputn(const char* s, std::streamsize n)
+        {
+            buf_.insert(buf_.end(), s, s + n);
+            return n;
+        }
+    private:
+        std::vector<char> buf_;
+        std::ostream os_;
+        bool in_use_;
+    };
+
+    pthread_key_t format_buffer_key;
+    pthread_once_t format_buffer_once = PTHREAD_ONCE_INIT;
+
+    void delete_format_buffer(void* ptr)
+    {
+        delete static_cast<format_buffer*>(ptr);
+    }
+
+    void create_format_buffer_key()
+    {
+        pthread_key_create(&format_buffer_key, delete_format_buffer);
+    }
+
+    format_buffer* thread_format_buffer()
+    {
+        pthread_once(&format_buffer_once, create_format_buffer_key);
+        format_buffer* ret(static_cast<format_buffer*>(
+                               pthread_getspecific(format_buffer_key)));
+        if (ret == 0)
+        {
+            ret = new format_buffer();
+            pthread_setspecific(format_buffer_key, ret);
+        }
+        return ret;
+    }
+
+    //
+    // Bounded lock free multi producer single consumer ring buffer
+    // of log messages. Each cell carries a sequence number which
+    // tells whether the cell is free for the producer at given
+    // position or contains a message for the consumer.
+    //
+    class log_ring
+    {
+    public:
+        static const size_t prefix_size = 32;
+        static const size_t message_size = 480;
+
+        struct message
+        {
+            wsrep::log::level level;
+            char prefix[prefix_size];
+            char text[message_size];
+        };
+
+        explicit log_ring(size_t capacity)
+            : mask_()
+            , cells_()
+            , enqueue_pos_(0)
+            , dequeue_pos_(0)
+        {
+            size_t size(1);
+            while (size < capacity)
+            {
+                size <<= 1;
+            }
+            mask_ = size - 1;
+            cells_ = new cell[size];
+            for (size_t i(0); i < size; ++i)
+            {
+                cells_[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        ~log_ring() { delete[] cells_; }
+
+        // Return false if the ring is full.
+        bool push(wsrep::log::level level, const char* prefix,
+                  const char* text, size_t text_len)
+        {
+            cell* c;
+            size_t pos(enqueue_pos_.load(std::memory_order_relaxed));
+            for (;;)
+            {
+                c = &cells_[pos & mask_];
+                size_t const seq(c->sequence.load(std::memory_order_acquire));
+                long const diff(long(seq) - long(pos));
+                if (diff == 0)
+                {
+                    if (enqueue_pos_.compare_exchange_weak(
+                            pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    pos = enqueue_pos_.load(std::memory_order_relaxed);
+                }
+            }
+            c->msg.level = level;
+            copy(c->msg.prefix, prefix_size, prefix, std::strlen(prefix));
+            copy(c->msg.text, message_size, text, text_len);
+            c->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Must be called only from the flusher thread.
+        bool pop(message& msg)
+        {
+            cell& c(cells_[dequeue_pos_ & mask_]);
+            if (c.sequence.load(std::memory_order_acquire) != dequeue_pos_ + 1)
+            {
+                return false;
+            }
+            msg = c.msg;
+            c.sequence.store(dequeue_pos_ + mask_ + 1,
+                             std::memory_order_release);
+            ++dequeue_pos_;
+            return true;
+        }
+    private:
+        log_ring(const log_ring&);
+        log_ring& operator=(const log_ring&);
+
+        // Copy at most dst_size - 1 characters and null terminate.
+        static void copy(char* dst, size_t dst_size,
+                         const char* src, size_t src_len)
+        {
+            size_t const len(std::min(src_len, dst_size - 1));
+            std::memcpy(dst, src, len);
+            dst[len] = '\0';
+        }
+
+        struct cell
+        {
+            std::atomic<size_t> sequence;
+            message msg;
+        };
+        size_t mask_;
+        cell* cells_;
+        std::atomic<size_t> enqueue_pos_;
+        size_t dequeue_pos_;
+    };
+
+    // Interval at which the flusher thread polls the ring. Producers
+    // do not signal the flusher in order to stay lock free.
+    const long flush_interval_ms = 10;
+
+    // The ring is allocated on the first start and never freed, so
+    // that producers racing with stop_async() never see it deleted.
+    log_ring* async_ring(0);
+    std::atomic<bool> async_running(false);
+    std::atomic<size_t> async_dropped_count(0);
+    // Number of producers which have seen asynchronous logging
+    // running and may be pushing into the ring.
+    std::atomic<size_t> async_producers(0);
+    wsrep::default_mutex async_mutex;
+    wsrep::default_condition_variable async_cond;
+    bool async_stop(false);
+    pthread_t async_flusher;
+
+    // Register the calling thread as a producer. Return false if
+    // asynchronous logging is not running, in which case the message
+    // must be written synchronously. The running flag is re-checked
+    // after the registration so that stop_async() either sees the
+    // producer or the producer sees the stop.
+    bool async_enter()
+    {
+        if (async_running.load(std::memory_order_acquire) == false)
+        {
+            return false;
+        }
+        async_producers.fetch_add(1);
+        if (async_running.load() == false)
+        {
+            async_producers.fetch_sub(1);
+            return false;
+        }
+        return true;
+    }
+
+    void async_leave()
+    {
+        async_producers.fetch_sub(1);
+    }
+}
+
+wsrep::log::~log()
+{
+    format_buffer* buf(thread_format_buffer());
+    if (oss_ != &buf->stream())
+    {
+        // Nested log object formatted into a buffer of its own,
+        // write it synchronously.
+        write(level_, prefix_,
+              static_cast<std::ostringstream*>(oss_)->str().c_str());
+    }
+    else if (level_ != error && async_enter())
+    {
+        const char* const msg(buf->c_str());
+        if (async_ring->push(level_, prefix_, msg, buf->size() - 1) == false)
+        {
+            async_dropped_count.fetch_add(1, std::memory_order_relaxed);
+        }
+        async_leave();
+    }
+    else
+    {
+        write(level_, prefix_, buf->c_str());
+    }
+    release_buffer(oss_);
+}
+
+std::ostream* wsrep::log::acquire_buffer()
+{
+    format_buffer* buf(thread_format_buffer());
+    if (buf->in_use())
+    {
+        return new std::ostringstream();
+    }
+    buf->in_use(true);
+    return &buf->stream();
+}
+
+void wsrep::log::release_buffer(std::ostream* oss)
+{
+    format_buffer* buf(thread_format_buffer());
+    if (oss == &buf->stream())
+    {
+        buf->reset();
+        buf->in_use(false);
+    }
+    else
+    {
+        delete oss;
+    }
+}
+
+void wsrep::log::write(enum level level, const char* prefix, const char* msg)
+{
+    if (logger_fn_)
+    {
+        logger_fn_(level, msg);
+    }
+    else
+    {
+        wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+        os_ << prefix << ": " << msg << std::endl;
+    }
+}
 
 void wsrep::log::logger_fn(wsrep::log::logger_fn_type logger_fn)
 {
     logger_fn_ = logger_fn;
 }
 
+wsrep::log::logger_fn_type wsrep::log::logger_fn()
+{
+    return logger_fn_;
+}
+
 void wsrep::log::debug_log_level(int debug_log_level)
 {
     debug_log_level_.store(debug_log_level, std::memory_order_relaxed);
@@ -41,3 +361,94 @@ int wsrep::log::debug_log_level()
 {
     return debug_log_level_.load(std::memory_order_relaxed);
 }
+
+void* wsrep::log::flusher_thread(void*)
+{
+    size_t reported(0);
+    log_ring::message msg;
+    wsrep::unique_lock<wsrep::mutex> lock(async_mutex);
+    for (;;)
+    {
+        // Read the stop flag before draining so that the messages
+        // queued before stop_async() are written.
+        bool const stop(async_stop);
+        lock.unlock();
+        while (async_ring->pop(msg))
+        {
+            write(msg.level, msg.prefix, msg.text);
+        }
+        size_t const dropped(
+            async_dropped_count.load(std::memory_order_relaxed));
+        if (dropped != reported)
+        {
+            std::ostringstream os;
+            os << (dropped - reported)
+               << " log messages dropped, asynchronous log buffer full";
+            write(warning, "", os.str().c_str());
+            reported = dropped;
+        }
+        lock.lock();
+        if (stop)
+        {
+            break;
+        }
+        if (async_stop == false)
+        {
+            struct timeval now;
+            gettimeofday(&now, 0);
+            long nsec(now.tv_usec * 1000 + flush_interval_ms * 1000000);
+            struct timespec abstime;
+            abstime.tv_sec = now.tv_sec + nsec / 1000000000;
+            abstime.tv_nsec = nsec % 1000000000;
+            async_cond.timedwait(lock, abstime);
+        }
+    }
+    return 0;
+}
+
+int wsrep::log::start_async(size_t capacity)
+{
+    wsrep::unique_lock<wsrep::mutex> lock(async_mutex);
+    if (async_running.load(std::memory_order_relaxed))
+    {
+        return 0;
+    }
+    if (async_ring == 0)
+    {
+        async_ring = new log_ring(std::max(capacity, size_t(1)));
+    }
+    async_stop = false;
+    if (pthread_create(&async_flusher, 0, flusher_thread, 0))
+    {
+        return 1;
+    }
+    async_running.store(true, std::memory_order_release);
+    return 0;
+}
+
+void wsrep::log::stop_async()
+{
+    {
+        wsrep::unique_lock<wsrep::mutex> lock(async_mutex);
+        if (async_running.load(std::memory_order_relaxed) == false)
+        {
+            return;
+        }
+        async_running.store(false);
+        // Producers which registered before seeing the stop may still
+        // be pushing. Wait for them so that the flusher drains their
+        // messages, later producers write synchronously.
+        while (async_producers.load() != 0)
+        {
+            sched_yield();
+        }
+        async_stop = true;
+        async_cond.notify_one();
+    }
+    pthread_join(async_flusher, 0);
+}
+
+size_t wsrep::log::async_dropped()
+{
+    return async_dropped_count.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "wsrep/published_gtid.hpp"
+
+#include <cstring>
+#include <sys/time.h>
+
+wsrep::published_gtid::published_gtid()
+    : sequence_(0)
+    , id_()
+    , seqno_(wsrep::seqno::undefined().get())
+    , mutex_()
+    , cond_()
+    , waiters_()
+{
+    id_[0].store(0, std::memory_order_relaxed);
+    id_[1].store(0, std::memory_order_relaxed);
+}
+
+bool wsrep::published_gtid::store(const wsrep::gtid& gtid)
+{
+    unsigned long long id[2];
+    std::memcpy(id, gtid.id().data(), sizeof(id));
+
+    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    // Only the writer holding the mutex modifies the values, so
+    // relaxed loads are enough here.
+    if (id[0] == id_[0].load(std::memory_order_relaxed) &&
+        id[1] == id_[1].load(std::memory_order_relaxed) &&
+        gtid.seqno().get() <= seqno_.load(std::memory_order_relaxed))
+    {
+        return false;
+    }
+
+    const unsigned long long seq(sequence_.load(std::memory_order_relaxed));
+    sequence_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    id_[0].store(id[0], std::memory_order_relaxed);
+    id_[1].store(id[1], std::memory_order_relaxed);
+    seqno_.store(gtid.seqno().get(), std::memory_order_relaxed);
+    sequence_.store(seq + 2, std::memory_order_release);
+
+    if (waiters_)
+    {
+        cond_.notify_all();
+    }
+    return true;
+}
+
+wsrep::gtid wsrep::published_gtid::load() const
+{
+    unsigned long long id[2];
+    long long seqno;
+    for (;;)
+    {
+        const unsigned long long seq(
+            sequence_.load(std::memory_order_acquire));
+        if (seq & 1)
+        {
+            continue;
+        }
+        id[0] = id_[0].load(std::memory_order_relaxed);
+        id[1] = id_[1].load(std::memory_order_relaxed);
+        seqno = seqno_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence_.load(std::memory_order_relaxed) == seq)
+        {
+            break;
+        }
+    }
+    return wsrep::gtid(wsrep::id(id, sizeof(id)), wsrep::seqno(seqno));
+}
+
+int wsrep::published_gtid::wait(wsrep::seqno seqno, int timeout) const
+{
+    struct timespec abstime;
+    if (timeout >= 0)
+    {
+        struct timeval now;
+        gettimeofday(&now, 0);
+        abstime.tv_sec = now.tv_sec + timeout;
+        abstime.tv_nsec = now.tv_usec * 1000;
+    }
+
+    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    ++waiters_;
+    while (seqno_.load(std::memory_order_relaxed) < seqno.get())
+    {
+        if (timeout < 0)
+        {
+            cond_.wait(lock);
+        }
+        else if (cond_.timedwait(lock, abstime))
+        {
+            break;
+        }
+    }
+    --waiters_;
+    return (seqno_.load(std::memory_order_relaxed) < seqno.get());
+}
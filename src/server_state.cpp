@@ -26,10 +26,14 @@
 #include "wsrep/logger.hpp"
 #include "wsrep/compiler.hpp"
 #include "wsrep/id.hpp"
+#include "wsrep/applier_scheduler.hpp"
+#include "wsrep/applier_pool.hpp"
 
 #include <cassert>
 #include <sstream>
 #include <algorithm>
+#include <vector>
+#include <chrono>
 
 //////////////////////////////////////////////////////////////////////////////
 //                               Helpers                                    //
@@ -68,6 +72,24 @@ static inline int resolve_return_error(bool const vote,
     return vote_err != 0 ? vote_err : apply_err;
 }
 
+// Pass the write set through commit order as a dummy write set and
+// publish its position once it has left commit order
+static int log_dummy_write_set(
+    wsrep::server_state& server_state,
+    wsrep::high_priority_service& high_priority_service,
+    const wsrep::ws_handle& ws_handle,
+    const wsrep::ws_meta& ws_meta,
+    wsrep::mutable_buffer& err)
+{
+    int const ret(high_priority_service.log_dummy_write_set(
+                      ws_handle, ws_meta, err));
+    if (ret == 0 && ws_meta.ordered())
+    {
+        server_state.last_committed_gtid(ws_meta.gtid());
+    }
+    return ret;
+}
+
 static void
 discard_streaming_applier(wsrep::server_state& server_state,
                           wsrep::high_priority_service& high_priority_service,
@@ -76,8 +98,7 @@ discard_streaming_applier(wsrep::server_state& server_state,
 {
     server_state.stop_streaming_applier(
         ws_meta.server_id(), ws_meta.transaction_id());
-    server_state.server_service().release_high_priority_service(
-        streaming_applier);
+    server_state.streaming_applier_pool().release(streaming_applier);
     high_priority_service.store_globals();
 }
 
@@ -118,8 +139,8 @@ static int apply_fragment(wsrep::server_state& server_state,
             }
             else
             {
-                ret = streaming_applier->log_dummy_write_set(ws_handle,
-                                                             ws_meta, err);
+                ret = log_dummy_write_set(server_state, *streaming_applier,
+                                          ws_handle, ws_meta, err);
             }
         }
     }
@@ -257,7 +278,8 @@ static int rollback_fragment(wsrep::server_state& server_state,
                 if (ws_meta.ordered())
                 {
                     wsrep::mutable_buffer no_error;
-                    ret = high_priority_service.log_dummy_write_set(
+                    ret = log_dummy_write_set(
+                        server_state, high_priority_service,
                         ws_handle, ws_meta, no_error);
                 }
             }
@@ -283,8 +305,8 @@ static int apply_write_set(wsrep::server_state& server_state,
             to be rolled back with proper monitor enter/exit to maintain
             seqno consistency. This is done through log_dummy_write_set. */
             // No transaction existed before, log a dummy write set
-            ret = high_priority_service.log_dummy_write_set(
-                ws_handle, ws_meta, no_error);
+            ret = log_dummy_write_set(server_state, high_priority_service,
+                                      ws_handle, ws_meta, no_error);
         }
         else
         {
@@ -306,8 +328,8 @@ static int apply_write_set(wsrep::server_state& server_state,
                                  "Could not find applier context for "
                                  << ws_meta.server_id()
                                  << ": " << ws_meta.transaction_id());
-                ret = high_priority_service.log_dummy_write_set(
-                    ws_handle, ws_meta, no_error);
+                ret = log_dummy_write_set(server_state, high_priority_service,
+                                          ws_handle, ws_meta, no_error);
             }
             else
             {
@@ -339,18 +361,27 @@ static int apply_write_set(wsrep::server_state& server_state,
             {
                 ret = high_priority_service.rollback(ws_handle, ws_meta);
                 ret = ret || (high_priority_service.after_apply(), 0);
-                ret = ret || high_priority_service.log_dummy_write_set(
+                ret = ret || log_dummy_write_set(
+                    server_state, high_priority_service,
                     ws_handle, ws_meta, err);
                 ret = resolve_return_error(err.size() > 0, ret, apply_err);
             }
         }
+        else
+        {
+            // Pass the write set through commit order, so that it
+            // does not block the write sets which follow it.
+            wsrep::mutable_buffer no_error;
+            log_dummy_write_set(server_state, high_priority_service,
+                                ws_handle, ws_meta, no_error);
+        }
     }
     else if (wsrep::starts_transaction(ws_meta.flags()))
     {
         assert(server_state.find_streaming_applier(
                    ws_meta.server_id(), ws_meta.transaction_id()) == 0);
         wsrep::high_priority_service* sa(
-            server_state.server_service().streaming_applier_service(
+            server_state.streaming_applier_pool().acquire(
                 high_priority_service));
         server_state.start_streaming_applier(
             ws_meta.server_id(), ws_meta.transaction_id(), sa);
@@ -378,8 +409,8 @@ static int apply_write_set(wsrep::server_state& server_state,
                                  << ws_meta.server_id()
                                  << ": " << ws_meta.transaction_id();
             wsrep::mutable_buffer no_error;
-            ret = high_priority_service.log_dummy_write_set(
-                ws_handle, ws_meta, no_error);
+            ret = log_dummy_write_set(server_state, high_priority_service,
+                                      ws_handle, ws_meta, no_error);
         }
         else
         {
@@ -418,8 +449,8 @@ static int apply_write_set(wsrep::server_state& server_state,
                     << ws_meta.server_id()
                     << ": " << ws_meta.transaction_id();
                 wsrep::mutable_buffer no_error;
-                ret = high_priority_service.log_dummy_write_set(
-                    ws_handle, ws_meta, no_error);
+                ret = log_dummy_write_set(server_state, high_priority_service,
+                                          ws_handle, ws_meta, no_error);
             }
             else
             {
@@ -444,12 +475,42 @@ static int apply_write_set(wsrep::server_state& server_state,
     return ret;
 }
 
-static int apply_toi(wsrep::provider& provider,
+// Commutative write set does not depend on any preceding write set
+// and neither the provider nor the applier scheduler waits for
+// ws_meta.depends_on() to be committed before it is applied. It is
+// still committed in commit order to keep the position consistent.
+static int apply_commutative_write_set(
+    wsrep::server_state& server_state,
+    wsrep::high_priority_service& high_priority_service,
+    const wsrep::ws_handle& ws_handle,
+    const wsrep::ws_meta& ws_meta,
+    const wsrep::const_buffer& data)
+{
+    if (wsrep::starts_transaction(ws_meta.flags()) == false ||
+        wsrep::commits_transaction(ws_meta.flags()) == false ||
+        wsrep::rolls_back_transaction(ws_meta.flags()))
+    {
+        wsrep::log_error() << "Commutative write set must start and "
+                           << "commit a transaction: " << ws_meta;
+        wsrep::mutable_buffer no_error;
+        log_dummy_write_set(server_state, high_priority_service,
+                            ws_handle, ws_meta, no_error);
+        return 1;
+    }
+    WSREP_LOG_DEBUG(wsrep::log::debug_log_level(),
+                    wsrep::log::debug_level_server_state,
+                    "Applying commutative write set " << ws_meta);
+    return apply_write_set(server_state, high_priority_service,
+                           ws_handle, ws_meta, data);
+}
+
+static int apply_toi(wsrep::server_state& server_state,
                      wsrep::high_priority_service& high_priority_service,
                      const wsrep::ws_handle& ws_handle,
                      const wsrep::ws_meta& ws_meta,
                      const wsrep::const_buffer& data)
 {
+    wsrep::provider& provider(server_state.provider());
     if (wsrep::starts_transaction(ws_meta.flags()) &&
         wsrep::commits_transaction(ws_meta.flags()))
     {
@@ -460,17 +521,69 @@ static int apply_toi(wsrep::provider& provider,
         wsrep::mutable_buffer err;
         int const apply_err(high_priority_service.apply_toi(ws_meta,data,err));
         int const vote_err(provider.commit_order_leave(ws_handle, ws_meta,err));
+        if (vote_err == 0)
+        {
+            server_state.last_committed_gtid(ws_meta.gtid());
+        }
         return resolve_return_error(err.size() > 0, vote_err, apply_err);
     }
     else if (wsrep::starts_transaction(ws_meta.flags()))
     {
-        // NBO begin
-        throw wsrep::not_implemented_error();
+        //
+        // NBO begin. The operation is continued outside of
+        // commit order by the process started in apply_nbo_begin().
+        // If commit order cannot be entered, the operation is not
+        // started and the event is passed through commit order as
+        // a dummy write set.
+        //
+        wsrep::mutable_buffer err;
+        int const enter_err(provider.commit_order_enter(ws_handle, ws_meta));
+        if (enter_err)
+        {
+            wsrep::log_warning() << "Failed to enter commit order for "
+                                 << "NBO begin: " << ws_meta;
+            int const log_err(log_dummy_write_set(
+                                  server_state, high_priority_service,
+                                  ws_handle, ws_meta, err));
+            return resolve_return_error(err.size() > 0, log_err, enter_err);
+        }
+        int const apply_err(
+            high_priority_service.apply_nbo_begin(ws_meta, data, err));
+        int const vote_err(provider.commit_order_leave(ws_handle, ws_meta,err));
+        if (vote_err == 0)
+        {
+            server_state.last_committed_gtid(ws_meta.gtid());
+        }
+        return resolve_return_error(err.size() > 0, vote_err, apply_err);
     }
     else if (wsrep::commits_transaction(ws_meta.flags()))
     {
-        // NBO end
-        throw wsrep::not_implemented_error();
+        //
+        // NBO end. Both local and applied NBO operations are ended
+        // by the process executing the operation via
+        // client_state::begin_nbo_phase_two(), so the event only
+        // needs to pass through commit order here. If commit order
+        // cannot be entered, the event is passed through commit order
+        // as a dummy write set like failed write sets are.
+        //
+        wsrep::mutable_buffer err;
+        int const enter_err(provider.commit_order_enter(ws_handle, ws_meta));
+        if (enter_err)
+        {
+            wsrep::log_warning() << "Failed to enter commit order for "
+                                 << "NBO end: " << ws_meta;
+            int const log_err(log_dummy_write_set(
+                                  server_state, high_priority_service,
+                                  ws_handle, ws_meta, err));
+            return resolve_return_error(err.size() > 0, log_err, enter_err);
+        }
+        int const leave_err(provider.commit_order_leave(ws_handle, ws_meta,
+                                                        err));
+        if (leave_err == 0)
+        {
+            server_state.last_committed_gtid(ws_meta.gtid());
+        }
+        return leave_err;
     }
     else
     {
@@ -479,6 +592,368 @@ static int apply_toi(wsrep::provider& provider,
     }
 }
 
+//
+// Parallel rollback of orphaned streaming transactions. The rollbacks
+// are independent of each other, so they are distributed to a bounded
+// number of worker threads. Each worker thread uses its own high
+// priority service for adopting the transaction and removing its
+// fragments. The services are created by the view handler thread
+// and released by the worker threads. The view handler thread
+// participates with the high priority service it was called with.
+//
+
+namespace
+{
+    typedef std::vector<wsrep::streaming_applier_registry::value_type>
+    streaming_appliers_vector;
+
+    struct orphaned_sr_rollback_batch
+    {
+        orphaned_sr_rollback_batch(wsrep::server_state& server_state,
+                                   const streaming_appliers_vector& appliers)
+            : server_state_(server_state)
+            , appliers_(appliers)
+            , mutex_()
+            , next_()
+        { }
+
+        // Return pointer to next applier to be rolled back or null
+        // if the batch is exhausted.
+        const streaming_appliers_vector::value_type* next()
+        {
+            wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+            return (next_ < appliers_.size() ? &appliers_[next_++] : 0);
+        }
+
+        wsrep::server_state& server_state_;
+        const streaming_appliers_vector& appliers_;
+        wsrep::default_mutex mutex_;
+        size_t next_;
+    private:
+        orphaned_sr_rollback_batch(const orphaned_sr_rollback_batch&);
+        orphaned_sr_rollback_batch& operator=(
+            const orphaned_sr_rollback_batch&);
+    };
+
+    // If lock is given, it is held while the streaming applier is
+    // rolled back and released, and unlocked while the fragments are
+    // removed.
+    void rollback_orphaned_sr_transaction(
+        wsrep::server_state& server_state,
+        wsrep::high_priority_service& high_priority_service,
+        const streaming_appliers_vector::value_type& orphaned,
+        wsrep::unique_lock<wsrep::mutex>* lock)
+    {
+        assert(lock == 0 || lock->owns_lock());
+        const wsrep::id& server_id(orphaned.first.first);
+        const wsrep::transaction_id& transaction_id(orphaned.first.second);
+        wsrep::high_priority_service* streaming_applier(orphaned.second);
+        WSREP_LOG_DEBUG(wsrep::log::debug_log_level(),
+                        wsrep::log::debug_level_server_state,
+                        "Removing SR fragments for "
+                        << server_id << ", " << transaction_id);
+        int adopt_error;
+        if ((adopt_error = high_priority_service.adopt_transaction(
+                 streaming_applier->transaction())))
+        {
+            log_adopt_error(streaming_applier->transaction());
+        }
+        // Even if the transaction adopt above fails, we roll back
+        // the transaction. Adopt error will leave stale entries
+        // in the streaming log which can be removed manually.
+        {
+            wsrep::high_priority_switch sw(high_priority_service,
+                                           *streaming_applier);
+            streaming_applier->rollback(
+                wsrep::ws_handle(), wsrep::ws_meta());
+            streaming_applier->after_apply();
+        }
+        server_state.stop_streaming_applier(server_id, transaction_id);
+        server_state.streaming_applier_pool().release(streaming_applier);
+        high_priority_service.store_globals();
+        wsrep::ws_meta ws_meta(
+            wsrep::gtid(),
+            wsrep::stid(server_id, transaction_id, wsrep::client_id()),
+            wsrep::seqno::undefined(), 0);
+        if (lock)
+        {
+            lock->unlock();
+        }
+        if (adopt_error == 0)
+        {
+            high_priority_service.remove_fragments(ws_meta);
+            high_priority_service.commit(wsrep::ws_handle(transaction_id, 0),
+                                         ws_meta);
+        }
+        high_priority_service.after_apply();
+        if (lock)
+        {
+            lock->lock();
+        }
+    }
+
+    void rollback_orphaned_sr_transactions(
+        orphaned_sr_rollback_batch& batch,
+        wsrep::high_priority_service& high_priority_service)
+    {
+        const streaming_appliers_vector::value_type* orphaned;
+        while ((orphaned = batch.next()))
+        {
+            rollback_orphaned_sr_transaction(batch.server_state_,
+                                             high_priority_service,
+                                             *orphaned, 0);
+        }
+    }
+
+    struct orphaned_sr_rollback_worker
+    {
+        orphaned_sr_rollback_batch* batch;
+        wsrep::high_priority_service* high_priority_service;
+        pthread_t thread;
+    };
+
+    void* orphaned_sr_rollback_thread(void* arg)
+    {
+        orphaned_sr_rollback_worker* worker(
+            static_cast<orphaned_sr_rollback_worker*>(arg));
+        worker->high_priority_service->store_globals();
+        rollback_orphaned_sr_transactions(*worker->batch,
+                                          *worker->high_priority_service);
+        worker->batch->server_state_.streaming_applier_pool().release(
+            worker->high_priority_service);
+        return 0;
+    }
+}
+
+static void rollback_orphaned_sr_transactions(
+    wsrep::server_state& server_state,
+    wsrep::high_priority_service& high_priority_service,
+    const streaming_appliers_vector& orphaned,
+    size_t max_threads)
+{
+    wsrep::streaming_applier_pool& pool(server_state.streaming_applier_pool());
+    orphaned_sr_rollback_batch batch(server_state, orphaned);
+    // The calling thread is one of the workers.
+    const size_t n_workers(
+        std::min(std::max(max_threads, size_t(1)), orphaned.size()) - 1);
+    std::vector<orphaned_sr_rollback_worker> workers;
+    workers.reserve(n_workers);
+    for (size_t i(0); i < n_workers; ++i)
+    {
+        orphaned_sr_rollback_worker worker;
+        worker.batch = &batch;
+        worker.high_priority_service = pool.acquire(high_priority_service);
+        workers.push_back(worker);
+    }
+    if (n_workers)
+    {
+        high_priority_service.store_globals();
+    }
+
+    size_t started(0);
+    for (; started < workers.size(); ++started)
+    {
+        if (pthread_create(&workers[started].thread, 0,
+                           orphaned_sr_rollback_thread, &workers[started]))
+        {
+            wsrep::log_warning() << "Failed to start orphaned SR rollback "
+                                 << "thread, continuing with "
+                                 << started + 1 << " threads";
+            break;
+        }
+    }
+    WSREP_LOG_DEBUG(wsrep::log::debug_log_level(),
+                    wsrep::log::debug_level_server_state,
+                    "Rolling back " << orphaned.size()
+                    << " orphaned SR transactions using "
+                    << started + 1 << " threads");
+    rollback_orphaned_sr_transactions(batch, high_priority_service);
+    for (size_t i(0); i < started; ++i)
+    {
+        pthread_join(workers[i].thread, 0);
+    }
+    // Release services of the workers which failed to start.
+    for (size_t i(started); i < workers.size(); ++i)
+    {
+        pool.release(workers[i].high_priority_service);
+    }
+    high_priority_service.store_globals();
+}
+
+//
+// Parallel recovery of streaming appliers. The streaming appliers are
+// created and registered by the calling thread, after which the
+// fragments of each transaction are applied by a bounded number of
+// threads. Transactions are independent of each other, so the
+// recovery of different transactions may proceed concurrently.
+//
+
+namespace
+{
+    class streaming_applier_recovery
+    {
+    public:
+        streaming_applier_recovery(wsrep::server_state& server_state,
+                                   const streaming_appliers_vector& appliers)
+            : server_state_(server_state)
+            , appliers_(appliers)
+            , mutex_()
+            , next_()
+            , recovered_()
+            , failed_()
+            , progress_interval_(std::max(appliers.size() / 10,
+                                          size_t(1)))
+        { }
+
+        wsrep::server_state& server_state() { return server_state_; }
+
+        const streaming_appliers_vector::value_type* next()
+        {
+            wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+            return (next_ < appliers_.size() ? &appliers_[next_++] : 0);
+        }
+
+        void done(bool success)
+        {
+            wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+            success ? ++recovered_ : ++failed_;
+            const size_t processed(recovered_ + failed_);
+            if (processed % progress_interval_ == 0 &&
+                processed != appliers_.size())
+            {
+                wsrep::log_info() << "Streaming applier recovery progress: "
+                                  << processed << "/" << appliers_.size();
+            }
+        }
+
+        size_t recovered() const { return recovered_; }
+        size_t failed() const { return failed_; }
+    private:
+        streaming_applier_recovery(const streaming_applier_recovery&);
+        streaming_applier_recovery& operator=(
+            const streaming_applier_recovery&);
+
+        wsrep::server_state& server_state_;
+        const streaming_appliers_vector& appliers_;
+        wsrep::default_mutex mutex_;
+        size_t next_;
+        size_t recovered_;
+        size_t failed_;
+        size_t progress_interval_;
+    };
+
+    void recover_streaming_appliers(streaming_applier_recovery& recovery)
+    {
+        wsrep::server_state& server_state(recovery.server_state());
+        wsrep::server_service& server_service(server_state.server_service());
+        const streaming_appliers_vector::value_type* entry;
+        while ((entry = recovery.next()))
+        {
+            const wsrep::id& server_id(entry->first.first);
+            const wsrep::transaction_id& transaction_id(entry->first.second);
+            wsrep::high_priority_service* streaming_applier(entry->second);
+            streaming_applier->store_globals();
+            if (server_service.recover_streaming_applier(
+                    *streaming_applier, server_id, transaction_id))
+            {
+                wsrep::log_error() << "Failed to recover streaming applier "
+                                   << server_id << ": " << transaction_id;
+                server_state.stop_streaming_applier(server_id,
+                                                    transaction_id);
+                server_state.streaming_applier_pool().release(
+                    streaming_applier);
+                recovery.done(false);
+            }
+            else
+            {
+                streaming_applier->reset_globals();
+                recovery.done(true);
+            }
+        }
+    }
+
+    void* streaming_applier_recovery_thread(void* arg)
+    {
+        recover_streaming_appliers(
+            *static_cast<streaming_applier_recovery*>(arg));
+        return 0;
+    }
+}
+
+// Returns non-zero if the streaming log could not be scanned.
+template <class C>
+static int recover_streaming_appliers(wsrep::server_state& server_state,
+                                      C& c, size_t max_threads)
+{
+    wsrep::server_service& server_service(server_state.server_service());
+    wsrep::server_service::streaming_transactions transactions;
+    if (server_service.scan_streaming_log(c, transactions))
+    {
+        return 1;
+    }
+    if (transactions.empty())
+    {
+        return 0;
+    }
+
+    const std::chrono::steady_clock::time_point start(
+        std::chrono::steady_clock::now());
+    streaming_appliers_vector appliers;
+    appliers.reserve(transactions.size());
+    for (wsrep::server_service::streaming_transactions::const_iterator
+             i(transactions.begin()); i != transactions.end(); ++i)
+    {
+        if (server_state.find_streaming_applier(i->first, i->second))
+        {
+            wsrep::log_warning() << "Streaming applier "
+                                 << i->first << ": " << i->second
+                                 << " already exists, skipping recovery";
+            continue;
+        }
+        wsrep::high_priority_service* streaming_applier(
+            server_state.streaming_applier_pool().acquire(c));
+        server_state.start_streaming_applier(i->first, i->second,
+                                             streaming_applier);
+        appliers.push_back(std::make_pair(*i, streaming_applier));
+    }
+    c.store_globals();
+
+    streaming_applier_recovery recovery(server_state, appliers);
+    const size_t n_threads(
+        std::max(std::min(max_threads, appliers.size()), size_t(1)) - 1);
+    std::vector<pthread_t> threads(n_threads);
+    size_t started(0);
+    for (; started < n_threads; ++started)
+    {
+        if (pthread_create(&threads[started], 0,
+                           streaming_applier_recovery_thread, &recovery))
+        {
+            wsrep::log_warning() << "Failed to start streaming applier "
+                                 << "recovery thread, continuing with "
+                                 << started + 1 << " threads";
+            break;
+        }
+    }
+    wsrep::log_info() << "Recovering " << appliers.size()
+                      << " streaming transactions using "
+                      << started + 1 << " threads";
+    recover_streaming_appliers(recovery);
+    for (size_t i(0); i < started; ++i)
+    {
+        pthread_join(threads[i], 0);
+    }
+    c.store_globals();
+
+    const long long elapsed_ms(
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    wsrep::log_info() << "Streaming applier recovery completed in "
+                      << elapsed_ms << " ms: "
+                      << recovery.recovered() << " recovered, "
+                      << recovery.failed() << " failed";
+    return 0;
+}
+
 //////////////////////////////////////////////////////////////////////////////
 //                            Server State                                  //
 //////////////////////////////////////////////////////////////////////////////
@@ -519,6 +994,10 @@ int wsrep::server_state::disconnect()
         state(lock, s_disconnecting);
         interrupt_state_waiters(lock);
     }
+    // Release pooled streaming applier services while the server
+    // service is still usable. Services released into the pool
+    // after this are released in close_transactions_at_disconnect().
+    streaming_applier_pool_.clear();
     return provider().disconnect();
 }
 
@@ -796,17 +1275,25 @@ void wsrep::server_state::initialized()
 
 void wsrep::server_state::last_committed_gtid(const wsrep::gtid& gtid)
 {
-    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
-    assert(last_committed_gtid_.is_undefined() ||
-           last_committed_gtid_.seqno() + 1 == gtid.seqno());
-    last_committed_gtid_ = gtid;
-    cond_.notify_all();
+    // Commits of different transactions may publish their positions
+    // out of order after leaving commit order, published_gtid ignores
+    // the positions which would move the seqno backwards.
+    if (last_committed_gtid_.store(gtid))
+    {
+        wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+        cond_.notify_all();
+    }
 }
 
 wsrep::gtid wsrep::server_state::last_committed_gtid() const
 {
-    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
-    return last_committed_gtid_;
+    return last_committed_gtid_.load();
+}
+
+int wsrep::server_state::wait_for_last_committed_seqno(wsrep::seqno seqno,
+                                                       int timeout) const
+{
+    return last_committed_gtid_.wait(seqno, timeout);
 }
 
 enum wsrep::provider::status
@@ -1024,6 +1511,16 @@ void wsrep::server_state::go_final(wsrep::unique_lock<wsrep::mutex>& lock,
 void wsrep::server_state::on_view(const wsrep::view& view,
                                   wsrep::high_priority_service* high_priority_service)
 {
+    if (applier_scheduler_)
+    {
+        // All write sets ordered before the view must be committed
+        // before the view is processed. Write sets ordered after the
+        // view may have been queued by other receiving threads and
+        // wait for the view in commit order, so they are not waited
+        // for.
+        const wsrep::seqno seqno(view.state_id().seqno());
+        applier_scheduler_->drain(seqno.is_undefined() ? seqno : seqno + 1);
+    }
     wsrep::log_info()
         << "================================================\nView:\n"
         << view
@@ -1104,16 +1601,50 @@ int wsrep::server_state::on_apply(
     const wsrep::ws_meta& ws_meta,
     const wsrep::const_buffer& data)
 {
+    if (applier_pool_)
+    {
+        const std::chrono::steady_clock::time_point start(
+            std::chrono::steady_clock::now());
+        int const ret(apply(high_priority_service, ws_handle, ws_meta, data));
+        applier_pool_->applied(
+            high_priority_service,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count());
+        return ret;
+    }
+    return apply(high_priority_service, ws_handle, ws_meta, data);
+}
+
+int wsrep::server_state::apply(
+    wsrep::high_priority_service& high_priority_service,
+    const wsrep::ws_handle& ws_handle,
+    const wsrep::ws_meta& ws_meta,
+    const wsrep::const_buffer& data)
+{
+    if (applier_scheduler_ &&
+        applier_scheduler_->is_worker(&high_priority_service) == false)
+    {
+        if (applier_scheduler_->schedulable(ws_meta))
+        {
+            return applier_scheduler_->enqueue(ws_handle, ws_meta, data);
+        }
+        // Write sets which cannot be applied in parallel are applied
+        // in this thread after the scheduled write sets ordered
+        // before them have been committed. Unordered write sets do
+        // not pass commit order, all the scheduled write sets can
+        // be waited for.
+        applier_scheduler_->drain(ws_meta.seqno());
+    }
+
     if (is_toi(ws_meta.flags()))
     {
-        return apply_toi(provider(), high_priority_service,
+        return apply_toi(*this, high_priority_service,
                          ws_handle, ws_meta, data);
     }
-    else if (is_commutative(ws_meta.flags()) || is_native(ws_meta.flags()))
+    else if (is_commutative(ws_meta.flags()))
     {
-        // Not implemented yet.
-        assert(0);
-        return 0;
+        return apply_commutative_write_set(*this, high_priority_service,
+                                           ws_handle, ws_meta, data);
     }
     else
     {
@@ -1144,8 +1675,7 @@ void wsrep::server_state::convert_streaming_client_to_applier(
     // create streaming_applier beforehand as server_state lock should
     // not be held when calling server_service methods
     wsrep::high_priority_service* streaming_applier(
-        server_service_.streaming_applier_service(
-            client_state->client_service()));
+        streaming_applier_pool_.acquire(client_state->client_service()));
 
     wsrep::unique_lock<wsrep::mutex> lock(mutex_);
     WSREP_LOG_DEBUG(wsrep::log::debug_log_level(),
@@ -1176,14 +1706,13 @@ void wsrep::server_state::convert_streaming_client_to_applier(
         {
             log_adopt_error(client_state->transaction());
             streaming_applier->after_apply();
-            server_service_.release_high_priority_service(streaming_applier);
+            streaming_applier_pool_.release(streaming_applier);
             return;
         }
         if (streaming_appliers_.insert(
-                std::make_pair(
-                    std::make_pair(client_state->transaction().server_id(),
-                                   client_state->transaction().id()),
-                    streaming_applier)).second == false)
+                client_state->transaction().server_id(),
+                client_state->transaction().id(),
+                streaming_applier) == false)
         {
             wsrep::log_warning() << "Could not insert streaming applier "
                                  << id_
@@ -1194,7 +1723,7 @@ void wsrep::server_state::convert_streaming_client_to_applier(
     }
     else
     {
-        server_service_.release_high_priority_service(streaming_applier);
+        streaming_applier_pool_.release(streaming_applier);
         client_state->client_service().store_globals();
     }
 }
@@ -1229,10 +1758,7 @@ void wsrep::server_state::start_streaming_applier(
     const wsrep::transaction_id& transaction_id,
     wsrep::high_priority_service* sa)
 {
-    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
-    if (streaming_appliers_.insert(
-            std::make_pair(std::make_pair(server_id, transaction_id),
-                           sa)).second == false)
+    if (streaming_appliers_.insert(server_id, transaction_id, sa) == false)
     {
         wsrep::log_error() << "Could not insert streaming applier";
         throw wsrep::fatal_error();
@@ -1243,19 +1769,11 @@ void wsrep::server_state::stop_streaming_applier(
     const wsrep::id& server_id,
     const wsrep::transaction_id& transaction_id)
 {
-    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
-    streaming_appliers_map::iterator i(
-        streaming_appliers_.find(std::make_pair(server_id, transaction_id)));
-    assert(i != streaming_appliers_.end());
-    if (i == streaming_appliers_.end())
+    if (streaming_appliers_.erase(server_id, transaction_id) == 0)
     {
         wsrep::log_warning() << "Could not find streaming applier for "
                              << server_id << ":" << transaction_id;
-    }
-    else
-    {
-        streaming_appliers_.erase(i);
-        cond_.notify_all();
+        assert(0);
     }
 }
 
@@ -1263,10 +1781,7 @@ wsrep::high_priority_service* wsrep::server_state::find_streaming_applier(
     const wsrep::id& server_id,
     const wsrep::transaction_id& transaction_id) const
 {
-    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
-    streaming_appliers_map::const_iterator i(
-        streaming_appliers_.find(std::make_pair(server_id, transaction_id)));
-    return (i == streaming_appliers_.end() ? 0 : i->second);
+    return streaming_appliers_.find(server_id, transaction_id);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -1387,7 +1902,12 @@ void wsrep::server_state::recover_streaming_appliers_if_not_recovered(
     if (streaming_appliers_recovered_ == false)
     {
         lock.unlock();
-        server_service_.recover_streaming_appliers(c);
+        if (streaming_applier_recovery_threads_ < 2 ||
+            recover_streaming_appliers(*this, c,
+                                       streaming_applier_recovery_threads_))
+        {
+            server_service_.recover_streaming_appliers(c);
+        }
         lock.lock();
     }
     streaming_appliers_recovered_ = true;
@@ -1440,8 +1960,15 @@ void wsrep::server_state::close_orphaned_sr_transactions(
         }
     }
 
-    streaming_appliers_map::iterator i(streaming_appliers_.begin());
-    while (i != streaming_appliers_.end())
+    // Appliers are not started or stopped concurrently as the view
+    // handler is executed inside provider commit ordering critical
+    // section, so it is safe to operate on a snapshot.
+    typedef std::vector<wsrep::streaming_applier_registry::value_type>
+        appliers_vector;
+    const appliers_vector appliers(streaming_appliers_.entries());
+    appliers_vector orphaned;
+    for (appliers_vector::const_iterator i(appliers.begin());
+         i != appliers.end(); ++i)
     {
         // rollback SR on equal consecutive primary views or if its
         // originator is not in the current view
@@ -1451,53 +1978,33 @@ void wsrep::server_state::close_orphaned_sr_transactions(
                           server_id_cmp(i->first.first)) ==
              current_view_.members().end()))
         {
-            WSREP_LOG_DEBUG(wsrep::log::debug_log_level(),
-                            wsrep::log::debug_level_server_state,
-                            "Removing SR fragments for "
-                            << i->first.first
-                            << ", " << i->first.second);
-            wsrep::id server_id(i->first.first);
-            wsrep::transaction_id transaction_id(i->first.second);
-            wsrep::high_priority_service* streaming_applier(i->second);
-            int adopt_error;
-            if ((adopt_error = high_priority_service.adopt_transaction(
-                     streaming_applier->transaction())))
-            {
-                log_adopt_error(streaming_applier->transaction());
-            }
-            // Even if the transaction adopt above fails, we roll back
-            // the transaction. Adopt error will leave stale entries
-            // in the streaming log which can be removed manually.
-            {
-                wsrep::high_priority_switch sw(high_priority_service,
-                                               *streaming_applier);
-                streaming_applier->rollback(
-                    wsrep::ws_handle(), wsrep::ws_meta());
-                streaming_applier->after_apply();
-            }
-
-            streaming_appliers_.erase(i++);
-            server_service_.release_high_priority_service(streaming_applier);
-            high_priority_service.store_globals();
-            wsrep::ws_meta ws_meta(
-                wsrep::gtid(),
-                wsrep::stid(server_id, transaction_id, wsrep::client_id()),
-                wsrep::seqno::undefined(), 0);
-            lock.unlock();
-            if (adopt_error == 0)
-            {
-                high_priority_service.remove_fragments(ws_meta);
-                high_priority_service.commit(wsrep::ws_handle(transaction_id, 0),
-                                             ws_meta);
-            }
-            high_priority_service.after_apply();
-            lock.lock();
+            orphaned.push_back(*i);
         }
-        else
+    }
+
+    if (orphaned.empty())
+    {
+        return;
+    }
+    if (orphaned_sr_rollback_threads_ < 2)
+    {
+        for (appliers_vector::const_iterator i(orphaned.begin());
+             i != orphaned.end(); ++i)
         {
-            ++i;
+            rollback_orphaned_sr_transaction(*this, high_priority_service,
+                                             *i, &lock);
         }
+        return;
     }
+    // The lock can be released for the worker threads because the
+    // view handler is executed inside provider commit ordering
+    // critical section and the workers operate on a snapshot of
+    // the streaming applier registry.
+    lock.unlock();
+    rollback_orphaned_sr_transactions(*this, high_priority_service,
+                                      orphaned,
+                                      orphaned_sr_rollback_threads_);
+    lock.lock();
 }
 
 void wsrep::server_state::close_transactions_at_disconnect(
@@ -1506,8 +2013,10 @@ void wsrep::server_state::close_transactions_at_disconnect(
     // Close streaming applier without removing fragments
     // from fragment storage. When the server is started again,
     // it must be able to recover ongoing streaming transactions.
-    streaming_appliers_map::iterator i(streaming_appliers_.begin());
-    while (i != streaming_appliers_.end())
+    const std::vector<wsrep::streaming_applier_registry::value_type>
+        appliers(streaming_appliers_.entries());
+    for (std::vector<wsrep::streaming_applier_registry::value_type>::
+             const_iterator i(appliers.begin()); i != appliers.end(); ++i)
     {
         wsrep::high_priority_service* streaming_applier(i->second);
         {
@@ -1517,9 +2026,12 @@ void wsrep::server_state::close_transactions_at_disconnect(
                 wsrep::ws_handle(), wsrep::ws_meta());
             streaming_applier->after_apply();
         }
-        streaming_appliers_.erase(i++);
-        server_service_.release_high_priority_service(streaming_applier);
+        streaming_appliers_.erase(i->first.first, i->first.second);
+        streaming_applier_pool_.release(streaming_applier);
         high_priority_service.store_globals();
     }
+    // Pooled services are not needed until the server connects again.
+    streaming_applier_pool_.clear();
+    high_priority_service.store_globals();
     streaming_appliers_recovered_ = false;
 }
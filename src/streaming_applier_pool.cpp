@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "wsrep/streaming_applier_pool.hpp"
+#include "wsrep/high_priority_service.hpp"
+#include "wsrep/server_service.hpp"
+#include "wsrep/lock.hpp"
+
+#include <cassert>
+
+wsrep::streaming_applier_pool::streaming_applier_pool(
+    wsrep::server_service& server_service)
+    : server_service_(server_service)
+    , mutex_()
+    , services_()
+    , max_size_()
+    , hits_()
+    , misses_()
+{ }
+
+wsrep::streaming_applier_pool::~streaming_applier_pool()
+{
+    assert(services_.empty());
+}
+
+void wsrep::streaming_applier_pool::max_size(size_t max_size)
+{
+    std::vector<wsrep::high_priority_service*> excess;
+    {
+        wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+        max_size_ = max_size;
+        while (services_.size() > max_size_)
+        {
+            excess.push_back(services_.back());
+            services_.pop_back();
+        }
+    }
+    // Server service methods are called without holding the mutex.
+    for (size_t i(0); i < excess.size(); ++i)
+    {
+        server_service_.release_high_priority_service(excess[i]);
+    }
+}
+
+size_t wsrep::streaming_applier_pool::max_size() const
+{
+    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    return max_size_;
+}
+
+wsrep::high_priority_service* wsrep::streaming_applier_pool::pop()
+{
+    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    if (services_.empty())
+    {
+        ++misses_;
+        return 0;
+    }
+    ++hits_;
+    wsrep::high_priority_service* ret(services_.back());
+    services_.pop_back();
+    ret->reset_switched_context();
+    return ret;
+}
+
+wsrep::high_priority_service* wsrep::streaming_applier_pool::acquire(
+    wsrep::high_priority_service& orig_hps)
+{
+    wsrep::high_priority_service* ret(pop());
+    return (ret ? ret : server_service_.streaming_applier_service(orig_hps));
+}
+
+wsrep::high_priority_service* wsrep::streaming_applier_pool::acquire(
+    wsrep::client_service& orig_cs)
+{
+    wsrep::high_priority_service* ret(pop());
+    return (ret ? ret : server_service_.streaming_applier_service(orig_cs));
+}
+
+void wsrep::streaming_applier_pool::release(
+    wsrep::high_priority_service* streaming_applier)
+{
+    // Check for free space first to avoid resetting the service
+    // if it will be released anyway. The size is checked again
+    // after the reset since other threads may return services
+    // concurrently.
+    bool pooled(false);
+    if (size() < max_size() &&
+        server_service_.reset_streaming_applier_service(
+            *streaming_applier) == 0)
+    {
+        wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+        if (services_.size() < max_size_)
+        {
+            // The reset may have changed the execution context.
+            streaming_applier->reset_switched_context();
+            services_.push_back(streaming_applier);
+            pooled = true;
+        }
+    }
+    if (pooled == false)
+    {
+        server_service_.release_high_priority_service(streaming_applier);
+    }
+}
+
+void wsrep::streaming_applier_pool::clear()
+{
+    std::vector<wsrep::high_priority_service*> services;
+    {
+        wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+        services.swap(services_);
+    }
+    for (size_t i(0); i < services.size(); ++i)
+    {
+        server_service_.release_high_priority_service(services[i]);
+    }
+}
+
+size_t wsrep::streaming_applier_pool::size() const
+{
+    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    return services_.size();
+}
+
+size_t wsrep::streaming_applier_pool::hits() const
+{
+    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    return hits_;
+}
+
+size_t wsrep::streaming_applier_pool::misses() const
+{
+    wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+    return misses_;
+}
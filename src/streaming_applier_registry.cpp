@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "wsrep/streaming_applier_registry.hpp"
+#include "wsrep/lock.hpp"
+
+#include <cstring>
+#include <stdint.h>
+
+namespace
+{
+    inline uint64_t mix(uint64_t h)
+    {
+        // Finalizer from MurmurHash3
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    inline size_t digest(const wsrep::id& server_id,
+                         const wsrep::transaction_id& transaction_id)
+    {
+        uint64_t parts[2];
+        std::memcpy(parts, server_id.data(), sizeof(parts));
+        return static_cast<size_t>(
+            mix(parts[0] ^ mix(parts[1] ^ mix(transaction_id.get()))));
+    }
+}
+
+const size_t wsrep::streaming_applier_registry::default_shards;
+
+wsrep::streaming_applier_registry::streaming_applier_registry(size_t shards)
+    : n_shards_(1)
+    , shards_()
+{
+    while (n_shards_ < shards)
+    {
+        n_shards_ <<= 1;
+    }
+    shards_ = new shard[n_shards_];
+}
+
+wsrep::streaming_applier_registry::~streaming_applier_registry()
+{
+    delete[] shards_;
+}
+
+wsrep::streaming_applier_registry::shard&
+wsrep::streaming_applier_registry::get_shard(
+    const wsrep::id& server_id,
+    const wsrep::transaction_id& transaction_id) const
+{
+    return shards_[digest(server_id, transaction_id) & (n_shards_ - 1)];
+}
+
+bool wsrep::streaming_applier_registry::insert(
+    const wsrep::id& server_id,
+    const wsrep::transaction_id& transaction_id,
+    wsrep::high_priority_service* streaming_applier)
+{
+    shard& s(get_shard(server_id, transaction_id));
+    wsrep::unique_lock<wsrep::mutex> lock(s.mutex);
+    return s.map.insert(
+        std::make_pair(std::make_pair(server_id, transaction_id),
+                       streaming_applier)).second;
+}
+
+wsrep::high_priority_service* wsrep::streaming_applier_registry::erase(
+    const wsrep::id& server_id,
+    const wsrep::transaction_id& transaction_id)
+{
+    shard& s(get_shard(server_id, transaction_id));
+    wsrep::unique_lock<wsrep::mutex> lock(s.mutex);
+    map_type::iterator i(s.map.find(std::make_pair(server_id,
+                                                   transaction_id)));
+    if (i == s.map.end())
+    {
+        return 0;
+    }
+    wsrep::high_priority_service* ret(i->second);
+    s.map.erase(i);
+    return ret;
+}
+
+wsrep::high_priority_service* wsrep::streaming_applier_registry::find(
+    const wsrep::id& server_id,
+    const wsrep::transaction_id& transaction_id) const
+{
+    shard& s(get_shard(server_id, transaction_id));
+    wsrep::unique_lock<wsrep::mutex> lock(s.mutex);
+    map_type::const_iterator i(s.map.find(std::make_pair(server_id,
+                                                         transaction_id)));
+    return (i == s.map.end() ? 0 : i->second);
+}
+
+std::vector<wsrep::streaming_applier_registry::value_type>
+wsrep::streaming_applier_registry::entries() const
+{
+    std::vector<value_type> ret;
+    for (size_t i(0); i < n_shards_; ++i)
+    {
+        wsrep::unique_lock<wsrep::mutex> lock(shards_[i].mutex);
+        ret.insert(ret.end(), shards_[i].map.begin(), shards_[i].map.end());
+    }
+    return ret;
+}
+
+size_t wsrep::streaming_applier_registry::size() const
+{
+    size_t ret(0);
+    for (size_t i(0); i < n_shards_; ++i)
+    {
+        wsrep::unique_lock<wsrep::mutex> lock(shards_[i].mutex);
+        ret += shards_[i].map.size();
+    }
+    return ret;
+}
@@ -22,12 +22,14 @@
 #include "wsrep/server_state.hpp"
 #include "wsrep/storage_service.hpp"
 #include "wsrep/high_priority_service.hpp"
+#include "wsrep/applier_pool.hpp"
 #include "wsrep/key.hpp"
 #include "wsrep/logger.hpp"
 #include "wsrep/compiler.hpp"
 
 #include <sstream>
 #include <memory>
+#include <chrono>
 
 namespace
 {
@@ -81,6 +83,31 @@ namespace
         wsrep::storage_service* storage_service_;
         D deleter_;
     };
+
+    // Enter commit order. If an applier pool is attached, the time
+    // waited is recorded for appliers only: the pool relates it to
+    // the time spent applying write sets, which local transactions
+    // do not contribute to.
+    int commit_order_enter(wsrep::client_state& client_state,
+                           wsrep::provider& provider,
+                           const wsrep::ws_handle& ws_handle,
+                           const wsrep::ws_meta& ws_meta)
+    {
+        wsrep::applier_pool* pool(
+            client_state.server_state().applier_pool());
+        if (pool == 0 ||
+            client_state.mode() != wsrep::client_state::m_high_priority)
+        {
+            return provider.commit_order_enter(ws_handle, ws_meta);
+        }
+        const std::chrono::steady_clock::time_point start(
+            std::chrono::steady_clock::now());
+        int const ret(provider.commit_order_enter(ws_handle, ws_meta));
+        pool->commit_order_waited(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count());
+        return ret;
+    }
 }
 
 // Public
@@ -103,6 +130,7 @@ wsrep::transaction::transaction(
     , flags_()
     , pa_unsafe_(false)
     , implicit_deps_(false)
+    , commutative_(false)
     , certified_(false)
     , force_bf_rollback_(false)
     , fragments_certified_for_statement_()
@@ -246,7 +274,7 @@ int wsrep::transaction::append_data(const wsrep::const_buffer& data)
 
 int wsrep::transaction::after_row()
 {
-    wsrep::unique_lock<wsrep::mutex> lock(client_state_.mutex());
+    wsrep::unique_lock<wsrep::client_mutex> lock(client_state_.mutex());
     debug_log_state("after_row_enter");
     int ret(0);
     if (streaming_context_.fragment_size() &&
@@ -259,7 +287,7 @@ int wsrep::transaction::after_row()
 }
 
 int wsrep::transaction::before_prepare(
-    wsrep::unique_lock<wsrep::mutex>& lock)
+    wsrep::unique_lock<wsrep::client_mutex>& lock)
 {
     assert(lock.owns_lock());
     int ret(0);
@@ -343,7 +371,7 @@ int wsrep::transaction::before_prepare(
 }
 
 int wsrep::transaction::after_prepare(
-    wsrep::unique_lock<wsrep::mutex>& lock)
+    wsrep::unique_lock<wsrep::client_mutex>& lock)
 {
     assert(lock.owns_lock());
 
@@ -368,7 +396,7 @@ int wsrep::transaction::before_commit()
 {
     int ret(1);
 
-    wsrep::unique_lock<wsrep::mutex> lock(client_state_.mutex());
+    wsrep::unique_lock<wsrep::client_mutex> lock(client_state_.mutex());
     debug_log_state("before_commit_enter");
     assert(client_state_.mode() != wsrep::client_state::m_toi);
     assert(state() == s_executing ||
@@ -448,7 +476,11 @@ int wsrep::transaction::before_commit()
             ret = 0;
         }
         lock.unlock();
-        ret = ret || provider().commit_order_enter(ws_handle_, ws_meta_);
+        if (ret == 0)
+        {
+            ret = commit_order_enter(client_state_, provider(),
+                                     ws_handle_, ws_meta_);
+        }
         lock.lock();
         if (ret)
         {
@@ -466,7 +498,7 @@ int wsrep::transaction::before_commit()
 
 int wsrep::transaction::ordered_commit()
 {
-    wsrep::unique_lock<wsrep::mutex> lock(client_state_.mutex());
+    wsrep::unique_lock<wsrep::client_mutex> lock(client_state_.mutex());
     debug_log_state("ordered_commit_enter");
     assert(state() == s_committing);
     assert(ordered());
@@ -499,6 +531,14 @@ int wsrep::transaction::ordered_commit()
         state(lock, s_ordered_commit);
     }
     debug_log_state("ordered_commit_leave");
+    if (ret == 0)
+    {
+        // Publish the position outside of client mutex, server state
+        // mutex is taken to wake up waiters.
+        const wsrep::gtid gtid(ws_meta_.gtid());
+        lock.unlock();
+        client_state_.server_state().last_committed_gtid(gtid);
+    }
     return ret;
 }
 
@@ -506,7 +546,7 @@ int wsrep::transaction::after_commit()
 {
     int ret(0);
 
-    wsrep::unique_lock<wsrep::mutex> lock(client_state_.mutex());
+    wsrep::unique_lock<wsrep::client_mutex> lock(client_state_.mutex());
     debug_log_state("after_commit_enter");
     assert(state() == s_ordered_commit);
 
@@ -537,14 +577,13 @@ int wsrep::transaction::after_commit()
     assert(ret == 0);
     state(lock, s_committed);
 
-    // client_state_.server_state().last_committed_gtid(ws_meta.gitd());
     debug_log_state("after_commit_leave");
     return ret;
 }
 
 int wsrep::transaction::before_rollback()
 {
-    wsrep::unique_lock<wsrep::mutex> lock(client_state_.mutex());
+    wsrep::unique_lock<wsrep::client_mutex> lock(client_state_.mutex());
     debug_log_state("before_rollback_enter");
     assert(state() == s_executing ||
            state() == s_preparing ||
@@ -628,7 +667,7 @@ int wsrep::transaction::before_rollback()
 
 int wsrep::transaction::after_rollback()
 {
-    wsrep::unique_lock<wsrep::mutex> lock(client_state_.mutex());
+    wsrep::unique_lock<wsrep::client_mutex> lock(client_state_.mutex());
     debug_log_state("after_rollback_enter");
     assert(state() == s_aborting ||
            state() == s_must_replay);
@@ -674,19 +713,29 @@ int wsrep::transaction::after_rollback()
 }
 
 int wsrep::transaction::release_commit_order(
-    wsrep::unique_lock<wsrep::mutex>& lock)
+    wsrep::unique_lock<wsrep::client_mutex>& lock)
 {
     lock.unlock();
     int ret(provider().commit_order_enter(ws_handle_, ws_meta_));
     lock.lock();
-    return ret || provider().commit_order_leave(ws_handle_, ws_meta_,
-                                                apply_error_buf_);
+    ret = ret || provider().commit_order_leave(ws_handle_, ws_meta_,
+                                               apply_error_buf_);
+    if (ret == 0)
+    {
+        // Publish the position outside of client mutex, server state
+        // mutex is taken to wake up waiters.
+        const wsrep::gtid gtid(ws_meta_.gtid());
+        lock.unlock();
+        client_state_.server_state().last_committed_gtid(gtid);
+        lock.lock();
+    }
+    return ret;
 }
 
 int wsrep::transaction::after_statement()
 {
     int ret(0);
-    wsrep::unique_lock<wsrep::mutex> lock(client_state_.mutex());
+    wsrep::unique_lock<wsrep::client_mutex> lock(client_state_.mutex());
     debug_log_state("after_statement_enter");
     assert(client_state_.mode() == wsrep::client_state::m_local);
     assert(state() == s_executing ||
@@ -797,7 +846,7 @@ int wsrep::transaction::after_statement()
 
 void wsrep::transaction::after_applying()
 {
-    wsrep::unique_lock<wsrep::mutex> lock(client_state_.mutex_);
+    wsrep::unique_lock<wsrep::client_mutex> lock(client_state_.mutex_);
     debug_log_state("after_applying enter");
     assert(state_ == s_executing ||
            state_ == s_committed ||
@@ -820,7 +869,7 @@ void wsrep::transaction::after_applying()
 }
 
 bool wsrep::transaction::bf_abort(
-    wsrep::unique_lock<wsrep::mutex>& lock,
+    wsrep::unique_lock<wsrep::client_mutex>& lock,
     wsrep::seqno bf_seqno)
 {
     bool ret(false);
@@ -928,7 +977,7 @@ bool wsrep::transaction::bf_abort(
 }
 
 bool wsrep::transaction::total_order_bf_abort(
-    wsrep::unique_lock<wsrep::mutex>& lock WSREP_UNUSED,
+    wsrep::unique_lock<wsrep::client_mutex>& lock WSREP_UNUSED,
     wsrep::seqno bf_seqno)
 {
     bool ret(bf_abort(lock, bf_seqno));
@@ -955,7 +1004,7 @@ void wsrep::transaction::deattach_after_replay()
     // local certification failure then de-attach such transaction
     // before copying the state of it to the main transaction.
     assert(state_ == s_replaying);
-    wsrep::unique_lock<wsrep::mutex> lock(client_state_.mutex_);
+    wsrep::unique_lock<wsrep::client_mutex> lock(client_state_.mutex_);
     state(lock, s_aborted);
     id_ = wsrep::transaction_id::undefined();
     ws_meta_ = wsrep::ws_meta();
@@ -979,7 +1028,7 @@ inline wsrep::provider& wsrep::transaction::provider()
 }
 
 void wsrep::transaction::state(
-    wsrep::unique_lock<wsrep::mutex>& lock __attribute__((unused)),
+    wsrep::unique_lock<wsrep::client_mutex>& lock __attribute__((unused)),
     enum wsrep::transaction::state next_state)
 {
     WSREP_LOG_DEBUG(client_state_.debug_log_level(),
@@ -1029,7 +1078,7 @@ void wsrep::transaction::state(
 }
 
 bool wsrep::transaction::abort_or_interrupt(
-    wsrep::unique_lock<wsrep::mutex>& lock)
+    wsrep::unique_lock<wsrep::client_mutex>& lock)
 {
     assert(lock.owns_lock());
     if (state() == s_must_abort)
@@ -1063,7 +1112,8 @@ bool wsrep::transaction::abort_or_interrupt(
     return false;
 }
 
-int wsrep::transaction::streaming_step(wsrep::unique_lock<wsrep::mutex>& lock)
+int wsrep::transaction::streaming_step(
+    wsrep::unique_lock<wsrep::client_mutex>& lock)
 {
     assert(lock.owns_lock());
     assert(streaming_context_.fragment_size());
@@ -1103,7 +1153,7 @@ int wsrep::transaction::streaming_step(wsrep::unique_lock<wsrep::mutex>& lock)
 }
 
 int wsrep::transaction::certify_fragment(
-    wsrep::unique_lock<wsrep::mutex>& lock)
+    wsrep::unique_lock<wsrep::client_mutex>& lock)
 {
     assert(lock.owns_lock());
 
@@ -1327,7 +1377,7 @@ int wsrep::transaction::certify_fragment(
 }
 
 int wsrep::transaction::certify_commit(
-    wsrep::unique_lock<wsrep::mutex>& lock)
+    wsrep::unique_lock<wsrep::client_mutex>& lock)
 {
     assert(lock.owns_lock());
     assert(active());
@@ -1348,6 +1398,13 @@ int wsrep::transaction::certify_commit(
         append_sr_keys_for_commit();
         flags(flags() | wsrep::provider::flag::pa_unsafe);
     }
+    else if (commutative())
+    {
+        // Fragments of streaming transaction have already been
+        // ordered, so only single write set transactions can be
+        // replicated as commutative.
+        flags(flags() | wsrep::provider::flag::commutative);
+    }
 
     if (implicit_deps())
     {
@@ -1508,7 +1565,8 @@ int wsrep::transaction::append_sr_keys_for_commit()
     return ret;
 }
 
-void wsrep::transaction::streaming_rollback(wsrep::unique_lock<wsrep::mutex>& lock)
+void wsrep::transaction::streaming_rollback(
+    wsrep::unique_lock<wsrep::client_mutex>& lock)
 {
     debug_log_state("streaming_rollback enter");
     assert(state_ != s_must_replay);
@@ -1584,6 +1642,7 @@ void wsrep::transaction::cleanup()
     force_bf_rollback_ = false;
     pa_unsafe_ = false;
     implicit_deps_ = false;
+    commutative_ = false;
     sr_keys_.clear();
     streaming_context_.cleanup();
     client_service_.cleanup_transaction();
@@ -128,8 +128,12 @@ namespace
                 map_one(flags,
                         provider::flag::pa_unsafe,
                         WSREP_FLAG_PA_UNSAFE) |
-                // map_one(flags, provider::flag::commutative, WSREP_FLAG_COMMUTATIVE) |
-                // map_one(flags, provider::flag::native, WSREP_FLAG_NATIVE) |
+                map_one(flags,
+                        provider::flag::commutative,
+                        WSREP_FLAG_COMMUTATIVE) |
+                map_one(flags,
+                        provider::flag::native,
+                        WSREP_FLAG_NATIVE) |
                 map_one(flags,
                         provider::flag::prepare,
                         WSREP_FLAG_TRX_PREPARE) |
@@ -159,8 +163,12 @@ namespace
                 map_one(flags,
                         WSREP_FLAG_PA_UNSAFE,
                         provider::flag::pa_unsafe) |
-                // map_one(flags, provider::flag::commutative, WSREP_FLAG_COMMUTATIVE) |
-                // map_one(flags, provider::flag::native, WSREP_FLAG_NATIVE) |
+                map_one(flags,
+                        WSREP_FLAG_COMMUTATIVE,
+                        provider::flag::commutative) |
+                map_one(flags,
+                        WSREP_FLAG_NATIVE,
+                        provider::flag::native) |
                 map_one(flags,
                         WSREP_FLAG_TRX_PREPARE,
                         provider::flag::prepare) |
@@ -235,6 +243,27 @@ namespace
             , flags_(flags)
         { }
 
+        // Construct with the meta data passed to the provider as
+        // input too. This is required for NBO end where the provider
+        // matches the end event with the corresponding NBO begin.
+        mutable_ws_meta(wsrep::ws_meta& ws_meta, int flags,
+                        const wsrep::ws_meta& input_meta)
+            : ws_meta_(ws_meta)
+            , trx_meta_()
+            , flags_(flags)
+        {
+            std::memcpy(trx_meta_.gtid.uuid.data,
+                        input_meta.group_id().data(),
+                        sizeof(trx_meta_.gtid.uuid.data));
+            trx_meta_.gtid.seqno = seqno_to_native(input_meta.seqno());
+            std::memcpy(trx_meta_.stid.node.data,
+                        input_meta.server_id().data(),
+                        sizeof(trx_meta_.stid.node.data));
+            trx_meta_.stid.conn = input_meta.client_id().get();
+            trx_meta_.stid.trx = input_meta.transaction_id().get();
+            trx_meta_.depends_on = seqno_to_native(input_meta.depends_on());
+        }
+
         ~mutable_ws_meta()
         {
             ws_meta_ = wsrep::ws_meta(
@@ -257,6 +286,42 @@ namespace
         int flags_;
     };
 
+    enum wsrep::provider::status
+    to_execute_start(struct wsrep_st* wsrep,
+                     wsrep::client_id client_id,
+                     const wsrep::key_array& keys,
+                     const wsrep::const_buffer& buffer,
+                     mutable_ws_meta& mmeta)
+    {
+        std::vector<std::vector<wsrep_buf_t> > key_parts;
+        std::vector<wsrep_key_t> wsrep_keys;
+        wsrep_buf_t wsrep_buf = {buffer.data(), buffer.size()};
+        for (size_t i(0); i < keys.size(); ++i)
+        {
+            key_parts.push_back(std::vector<wsrep_buf_t>());
+            for (size_t kp(0); kp < keys[i].size(); ++kp)
+            {
+                wsrep_buf_t buf = {keys[i].key_parts()[kp].data(),
+                                   keys[i].key_parts()[kp].size()};
+                key_parts[i].push_back(buf);
+            }
+        }
+        for (size_t i(0); i < key_parts.size(); ++i)
+        {
+            wsrep_key_t key = {key_parts[i].data(), key_parts[i].size()};
+            wsrep_keys.push_back(key);
+        }
+        return map_return_value(wsrep->to_execute_start(
+                                    wsrep,
+                                    client_id.get(),
+                                    &wsrep_keys[0],
+                                    wsrep_keys.size(),
+                                    &wsrep_buf,
+                                    1,
+                                    mmeta.native_flags(),
+                                    mmeta.native()));
+    }
+
     class const_ws_meta
     {
     public:
@@ -850,34 +915,17 @@ wsrep::wsrep_provider_v26::enter_toi(
     wsrep::ws_meta& ws_meta,
     int flags)
 {
-    mutable_ws_meta mmeta(ws_meta, flags);
-    std::vector<std::vector<wsrep_buf_t> > key_parts;
-    std::vector<wsrep_key_t> wsrep_keys;
-    wsrep_buf_t wsrep_buf = {buffer.data(), buffer.size()};
-    for (size_t i(0); i < keys.size(); ++i)
-    {
-        key_parts.push_back(std::vector<wsrep_buf_t>());
-        for (size_t kp(0); kp < keys[i].size(); ++kp)
-        {
-            wsrep_buf_t buf = {keys[i].key_parts()[kp].data(),
-                               keys[i].key_parts()[kp].size()};
-            key_parts[i].push_back(buf);
-        }
-    }
-    for (size_t i(0); i < key_parts.size(); ++i)
+    if (wsrep::commits_transaction(flags) &&
+        wsrep::starts_transaction(flags) == false)
     {
-        wsrep_key_t key = {key_parts[i].data(), key_parts[i].size()};
-        wsrep_keys.push_back(key);
+        // NBO end refers to the NBO begin event, whose meta data
+        // is passed in ws_meta. The input is read on construction
+        // and ws_meta is assigned only on destruction.
+        mutable_ws_meta mmeta(ws_meta, flags, ws_meta);
+        return to_execute_start(wsrep_, client_id, keys, buffer, mmeta);
     }
-    return map_return_value(wsrep_->to_execute_start(
-                                wsrep_,
-                                client_id.get(),
-                                &wsrep_keys[0],
-                                wsrep_keys.size(),
-                                &wsrep_buf,
-                                1,
-                                mmeta.native_flags(),
-                                mmeta.native()));
+    mutable_ws_meta mmeta(ws_meta, flags);
+    return to_execute_start(wsrep_, client_id, keys, buffer, mmeta);
 }
 
 enum wsrep::provider::status
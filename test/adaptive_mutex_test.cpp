@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "wsrep/adaptive_mutex.hpp"
+#include <boost/test/unit_test.hpp>
+
+#include <cerrno>
+#include <pthread.h>
+#include <sys/time.h>
+
+namespace
+{
+    struct counter
+    {
+        counter(size_t max_spins)
+            : mutex(max_spins)
+            , cond()
+            , value(0)
+        { }
+        wsrep::adaptive_mutex mutex;
+        wsrep::adaptive_condition_variable cond;
+        size_t value;
+    };
+
+    const size_t increments(100000);
+
+    void* increment_fn(void* arg)
+    {
+        counter* c(static_cast<counter*>(arg));
+        for (size_t i(0); i < increments; ++i)
+        {
+            wsrep::unique_lock<wsrep::adaptive_mutex> lock(c->mutex);
+            ++c->value;
+        }
+        return 0;
+    }
+
+    void* wait_fn(void* arg)
+    {
+        counter* c(static_cast<counter*>(arg));
+        wsrep::unique_lock<wsrep::mutex> lock(c->mutex);
+        while (c->value == 0)
+        {
+            c->cond.wait(lock);
+        }
+        c->value = 2;
+        c->cond.notify_all();
+        return 0;
+    }
+
+    void run_increments(size_t max_spins)
+    {
+        counter c(max_spins);
+        const size_t threads(4);
+        pthread_t th[threads];
+        for (size_t i(0); i < threads; ++i)
+        {
+            BOOST_REQUIRE(pthread_create(&th[i], 0, increment_fn, &c) == 0);
+        }
+        for (size_t i(0); i < threads; ++i)
+        {
+            pthread_join(th[i], 0);
+        }
+        BOOST_REQUIRE(c.value == threads * increments);
+        BOOST_REQUIRE(c.mutex.acquisitions() == threads * increments);
+        BOOST_REQUIRE(c.mutex.spins() <= c.mutex.acquisitions() * max_spins);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(adaptive_mutex_uncontended)
+{
+    wsrep::adaptive_mutex mutex;
+    {
+        wsrep::unique_lock<wsrep::adaptive_mutex> lock(mutex);
+    }
+    {
+        wsrep::unique_lock<wsrep::mutex> lock(mutex);
+    }
+    BOOST_REQUIRE(mutex.acquisitions() == 2);
+    BOOST_REQUIRE(mutex.spins() == 0);
+    BOOST_REQUIRE(mutex.parks() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(adaptive_mutex_contended)
+{
+    run_increments(wsrep::adaptive_mutex::default_max_spins);
+    // Park immediately without spinning.
+    run_increments(0);
+}
+
+BOOST_AUTO_TEST_CASE(adaptive_condition_variable_wait_notify)
+{
+    counter c(wsrep::adaptive_mutex::default_max_spins);
+    pthread_t th;
+    BOOST_REQUIRE(pthread_create(&th, 0, wait_fn, &c) == 0);
+    {
+        wsrep::unique_lock<wsrep::adaptive_mutex> lock(c.mutex);
+        c.value = 1;
+        c.cond.notify_one();
+        while (c.value != 2)
+        {
+            c.cond.wait(lock);
+        }
+    }
+    pthread_join(th, 0);
+    BOOST_REQUIRE(c.cond.waits() > 0);
+}
+
+BOOST_AUTO_TEST_CASE(adaptive_condition_variable_timedwait)
+{
+    wsrep::adaptive_mutex mutex;
+    wsrep::adaptive_condition_variable cond;
+    wsrep::unique_lock<wsrep::adaptive_mutex> lock(mutex);
+    struct timeval now;
+    gettimeofday(&now, 0);
+    struct timespec abstime;
+    abstime.tv_sec = now.tv_sec;
+    abstime.tv_nsec = now.tv_usec * 1000;
+    BOOST_REQUIRE(cond.timedwait(lock, abstime) == ETIMEDOUT);
+    BOOST_REQUIRE(lock.owns_lock());
+}
@@ -0,0 +1,300 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "wsrep/applier_pool.hpp"
+
+#include "mock_server_state.hpp"
+#include "mock_high_priority_service.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <unistd.h>
+
+namespace
+{
+    wsrep::applier_pool::params pool_params()
+    {
+        wsrep::applier_pool::params params;
+        params.min_appliers = 2;
+        params.max_appliers = 8;
+        params.interval_ms = 10;
+        params.scale_out_queue_length = 16;
+        params.idle_ratio = 0.1;
+        params.idle_intervals = 3;
+        params.commit_order_wait_ratio = 0.5;
+        return params;
+    }
+
+    wsrep::applier_pool::sample make_sample(long long recv_queue_length,
+                                            double busy,
+                                            double commit_order_wait,
+                                            size_t appliers)
+    {
+        wsrep::applier_pool::sample sample;
+        sample.interval_ns = 1000000000LL;
+        sample.apply_ns = (long long)(busy * sample.interval_ns * appliers);
+        sample.applied = sample.apply_ns / 1000;
+        sample.commit_order_wait_ns =
+            (long long)(commit_order_wait * sample.apply_ns);
+        sample.recv_queue_length = recv_queue_length;
+        return sample;
+    }
+
+    class mock_applier_pool_service : public wsrep::applier_pool::service
+    {
+    public:
+        mock_applier_pool_service(wsrep::server_state& server_state)
+            : server_state_(server_state)
+            , mutex_()
+            , created_()
+            , released_()
+            , woken_()
+        { }
+
+        wsrep::high_priority_service* applier_service() WSREP_OVERRIDE
+        {
+            wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+            ++created_;
+            return new wsrep::mock_high_priority_service(server_state_,
+                                                         0, false);
+        }
+
+        void release_applier_service(
+            wsrep::high_priority_service* high_priority_service)
+            WSREP_OVERRIDE
+        {
+            wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+            ++released_;
+            delete high_priority_service;
+        }
+
+        void wake_applier(wsrep::high_priority_service&) WSREP_OVERRIDE
+        {
+            ++woken_;
+            static_cast<wsrep::mock_provider&>(
+                server_state_.provider()).wake_appliers();
+        }
+
+        size_t created() const
+        {
+            wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+            return created_;
+        }
+
+        size_t released() const
+        {
+            wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+            return released_;
+        }
+
+        size_t woken() const { return woken_.load(); }
+    private:
+        wsrep::server_state& server_state_;
+        mutable wsrep::default_mutex mutex_;
+        size_t created_;
+        size_t released_;
+        std::atomic<size_t> woken_;
+    };
+}
+
+BOOST_AUTO_TEST_CASE(applier_pool_bounds)
+{
+    const wsrep::applier_pool::params params(pool_params());
+    size_t idle(0);
+    BOOST_REQUIRE(wsrep::applier_pool::target_appliers(
+                      params, 0, make_sample(0, 0, 0, 1), idle) == 2);
+    BOOST_REQUIRE(wsrep::applier_pool::target_appliers(
+                      params, 10, make_sample(100, 1, 0, 10), idle) == 8);
+}
+
+BOOST_AUTO_TEST_CASE(applier_pool_scale_out)
+{
+    const wsrep::applier_pool::params params(pool_params());
+    size_t idle(0);
+    // Long receive queue doubles the number of appliers.
+    BOOST_REQUIRE(wsrep::applier_pool::target_appliers(
+                      params, 2, make_sample(100, 0.5, 0, 2), idle) == 4);
+    BOOST_REQUIRE(wsrep::applier_pool::target_appliers(
+                      params, 6, make_sample(100, 0.5, 0, 6), idle) == 8);
+    // Short queue with saturated appliers.
+    BOOST_REQUIRE(wsrep::applier_pool::target_appliers(
+                      params, 3, make_sample(1, 0.95, 0, 3), idle) == 6);
+    // Short queue with appliers keeping up.
+    BOOST_REQUIRE(wsrep::applier_pool::target_appliers(
+                      params, 3, make_sample(1, 0.5, 0, 3), idle) == 3);
+}
+
+BOOST_AUTO_TEST_CASE(applier_pool_commit_order_contention)
+{
+    const wsrep::applier_pool::params params(pool_params());
+    size_t idle(0);
+    // Appliers are mostly waiting for commit order, adding more
+    // would not help even if the queue is long.
+    BOOST_REQUIRE(wsrep::applier_pool::target_appliers(
+                      params, 6, make_sample(100, 1, 0.8, 6), idle) == 5);
+    BOOST_REQUIRE(wsrep::applier_pool::target_appliers(
+                      params, 2, make_sample(100, 1, 0.8, 2), idle) == 2);
+}
+
+BOOST_AUTO_TEST_CASE(applier_pool_scale_in)
+{
+    const wsrep::applier_pool::params params(pool_params());
+    size_t idle(0);
+    // Appliers are retired one at a time after idle_intervals.
+    BOOST_REQUIRE(wsrep::applier_pool::target_appliers(
+                      params, 4, make_sample(0, 0.01, 0, 4), idle) == 4);
+    BOOST_REQUIRE(wsrep::applier_pool::target_appliers(
+                      params, 4, make_sample(0, 0.01, 0, 4), idle) == 4);
+    BOOST_REQUIRE(wsrep::applier_pool::target_appliers(
+                      params, 4, make_sample(0, 0.01, 0, 4), idle) == 3);
+    BOOST_REQUIRE(idle == 0);
+    // Activity resets the idle counter.
+    BOOST_REQUIRE(wsrep::applier_pool::target_appliers(
+                      params, 3, make_sample(0, 0.01, 0, 3), idle) == 3);
+    BOOST_REQUIRE(wsrep::applier_pool::target_appliers(
+                      params, 3, make_sample(0, 0.5, 0, 3), idle) == 3);
+    BOOST_REQUIRE(idle == 0);
+    // Never below minimum.
+    idle = params.idle_intervals;
+    BOOST_REQUIRE(wsrep::applier_pool::target_appliers(
+                      params, 2, make_sample(0, 0, 0, 2), idle) == 2);
+}
+
+namespace
+{
+    struct applier_pool_fixture
+    {
+        applier_pool_fixture()
+            : server_service(ss)
+            , ss("s1", wsrep::server_state::rm_sync, server_service)
+            , service(ss)
+        { }
+        wsrep::mock_server_service server_service;
+        wsrep::mock_server_state ss;
+        mock_applier_pool_service service;
+    };
+}
+
+BOOST_FIXTURE_TEST_CASE(applier_pool_start_stop, applier_pool_fixture)
+{
+    wsrep::applier_pool pool(ss, service, pool_params());
+    ss.applier_pool(&pool);
+    BOOST_REQUIRE(pool.start() == 0);
+    BOOST_REQUIRE(pool.target() == 2);
+    pool.stop();
+    ss.applier_pool(0);
+    // Mock provider applier loop returns immediately, all appliers
+    // have exited and released their services.
+    BOOST_REQUIRE(pool.appliers() == 0);
+    BOOST_REQUIRE(service.created() >= 2);
+    BOOST_REQUIRE(service.created() == service.released());
+}
+
+//
+// Appliers of idle node are blocked in the provider applier loop and
+// do not apply write sets. The pool manager must retire them itself
+// and wake them up so that the pool shrinks back to the minimum.
+//
+BOOST_FIXTURE_TEST_CASE(applier_pool_retire_idle, applier_pool_fixture)
+{
+    wsrep::applier_pool::params params(pool_params());
+    params.min_appliers = 1;
+    params.max_appliers = 4;
+    params.idle_intervals = 1;
+    wsrep::applier_pool pool(ss, service, params);
+    ss.applier_pool(&pool);
+    ss.provider().block_appliers(true);
+    ss.provider().recv_queue_length(100);
+    BOOST_REQUIRE(pool.start() == 0);
+    for (size_t i(0); i < 1000 && pool.appliers() < 4; ++i)
+    {
+        ::usleep(1000);
+    }
+    BOOST_REQUIRE(pool.appliers() == 4);
+
+    ss.provider().recv_queue_length(0);
+    for (size_t i(0); i < 1000 && service.released() < 3; ++i)
+    {
+        ::usleep(1000);
+    }
+    BOOST_REQUIRE(pool.appliers() == 1);
+    BOOST_REQUIRE(service.released() == 3);
+    BOOST_REQUIRE(service.woken() == 3);
+
+    ss.provider().block_appliers(false);
+    pool.stop();
+    ss.applier_pool(0);
+    BOOST_REQUIRE(pool.appliers() == 0);
+    BOOST_REQUIRE(service.created() == service.released());
+}
+
+//
+// Commit order wait is related to the time spent applying, so only
+// the waits of appliers may be recorded. Local commits must not
+// change the commit order wait ratio.
+//
+BOOST_FIXTURE_TEST_CASE(applier_pool_local_commit_order_wait,
+                        applier_pool_fixture)
+{
+    wsrep::applier_pool pool(ss, service, pool_params());
+    ss.applier_pool(&pool);
+    ss.mock_connect();
+    wsrep::mock_client cc(ss, wsrep::client_id(1),
+                          wsrep::client_state::m_local);
+    cc.open(cc.id());
+    BOOST_REQUIRE(cc.before_command() == 0);
+    for (int i(0); i < 10; ++i)
+    {
+        BOOST_REQUIRE(cc.before_statement() == 0);
+        BOOST_REQUIRE(cc.start_transaction(
+                          wsrep::transaction_id(i + 1)) == 0);
+        BOOST_REQUIRE(cc.before_commit() == 0);
+        BOOST_REQUIRE(cc.ordered_commit() == 0);
+        BOOST_REQUIRE(cc.after_commit() == 0);
+        BOOST_REQUIRE(cc.after_statement() == 0);
+    }
+    cc.after_command_before_result();
+    cc.after_command_after_result();
+    cc.close();
+    cc.cleanup();
+    BOOST_REQUIRE(pool.commit_order_wait_ns() == 0);
+
+    // Commit of applied write set is recorded.
+    wsrep::mock_client applier(ss, wsrep::client_id(2),
+                               wsrep::client_state::m_high_priority);
+    applier.open(applier.id());
+    BOOST_REQUIRE(applier.before_command() == 0);
+    wsrep::mock_high_priority_service hps(ss, &applier, false);
+    wsrep::ws_meta ws_meta(
+        wsrep::gtid(wsrep::id("1"), wsrep::seqno(11)),
+        wsrep::stid(wsrep::id("1"), wsrep::transaction_id(11),
+                    wsrep::client_id(1)),
+        wsrep::seqno(10),
+        wsrep::provider::flag::start_transaction |
+        wsrep::provider::flag::commit);
+    BOOST_REQUIRE(hps.apply(wsrep::ws_handle(wsrep::transaction_id(11),
+                                             (void*)1),
+                            ws_meta, wsrep::const_buffer("1", 1)) == 0);
+    BOOST_REQUIRE(pool.commit_order_wait_ns() > 0);
+    applier.after_command_before_result();
+    applier.after_command_after_result();
+    applier.close();
+    applier.cleanup();
+    ss.applier_pool(0);
+}
@@ -0,0 +1,487 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "wsrep/applier_scheduler.hpp"
+
+#include "mock_server_state.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include <pthread.h>
+
+namespace
+{
+    // Records committed seqnos and checks that no write set is
+    // applied before the write sets it depends on have committed.
+    // Also records seqnos passed through commit order as dummy
+    // write sets after a failure.
+    class apply_recorder
+    {
+    public:
+        apply_recorder()
+            : mutex_()
+            , cond_()
+            , applying_()
+            , committed_()
+            , violations_()
+            , dummies_()
+            , fragment_appliers_()
+        { }
+
+        void applying(const wsrep::ws_meta& ws_meta)
+        {
+            wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+            applying_.insert(ws_meta.seqno().get());
+            cond_.notify_all();
+            for (long long i(1); i <= ws_meta.depends_on().get(); ++i)
+            {
+                if (committed_.count(i) == 0)
+                {
+                    ++violations_;
+                }
+            }
+        }
+
+        // Record the service which applied a fragment of streaming
+        // transaction.
+        void fragment_applied(const wsrep::ws_meta& ws_meta,
+                              const wsrep::high_priority_service* service)
+        {
+            wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+            fragment_appliers_[ws_meta.transaction_id().get()].insert(
+                service);
+        }
+
+        size_t fragment_appliers(long long transaction_id) const
+        {
+            wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+            std::map<long long,
+                     std::set<const wsrep::high_priority_service*> >::
+                const_iterator i(fragment_appliers_.find(transaction_id));
+            return (i == fragment_appliers_.end() ? 0 : i->second.size());
+        }
+
+        void committed(const wsrep::ws_meta& ws_meta)
+        {
+            wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+            committed_.insert(ws_meta.seqno().get());
+            cond_.notify_all();
+        }
+
+        void wait_applying(long long seqno) const
+        {
+            wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+            while (applying_.count(seqno) == 0)
+            {
+                cond_.wait(lock);
+            }
+        }
+
+        void wait_committed(long long seqno) const
+        {
+            wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+            while (committed_.count(seqno) == 0)
+            {
+                cond_.wait(lock);
+            }
+        }
+
+        size_t committed() const
+        {
+            wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+            return committed_.size();
+        }
+
+        size_t violations() const
+        {
+            wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+            return violations_;
+        }
+
+        void dummy(const wsrep::ws_meta& ws_meta)
+        {
+            wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+            dummies_.insert(ws_meta.seqno().get());
+        }
+
+        size_t dummies() const
+        {
+            wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+            return dummies_.size();
+        }
+    private:
+        mutable wsrep::default_mutex mutex_;
+        mutable wsrep::default_condition_variable cond_;
+        std::set<long long> applying_;
+        std::set<long long> committed_;
+        size_t violations_;
+        std::set<long long> dummies_;
+        std::map<long long, std::set<const wsrep::high_priority_service*> >
+        fragment_appliers_;
+    };
+
+    class recording_high_priority_service
+        : public wsrep::mock_high_priority_service
+    {
+    public:
+        recording_high_priority_service(wsrep::server_state& server_state,
+                                        wsrep::mock_client_state* client_state,
+                                        apply_recorder& recorder)
+            : wsrep::mock_high_priority_service(server_state,
+                                                client_state, false)
+            , commit_after_()
+            , recorder_(recorder)
+        { }
+
+        int apply_write_set(const wsrep::ws_meta& ws_meta,
+                            const wsrep::const_buffer& data,
+                            wsrep::mutable_buffer& err) WSREP_OVERRIDE
+        {
+            recorder_.applying(ws_meta);
+            return mock_high_priority_service::apply_write_set(
+                ws_meta, data, err);
+        }
+
+        int append_fragment_and_commit(
+            const wsrep::ws_handle& ws_handle,
+            const wsrep::ws_meta& ws_meta,
+            const wsrep::const_buffer& data) WSREP_OVERRIDE
+        {
+            recorder_.fragment_applied(ws_meta, this);
+            recorder_.committed(ws_meta);
+            return mock_high_priority_service::append_fragment_and_commit(
+                ws_handle, ws_meta, data);
+        }
+
+        int commit(const wsrep::ws_handle& ws_handle,
+                   const wsrep::ws_meta& ws_meta) WSREP_OVERRIDE
+        {
+            // Emulate commit order of the provider.
+            if (commit_after_ && ws_meta.seqno().get() > commit_after_)
+            {
+                recorder_.wait_committed(commit_after_);
+            }
+            int const ret(mock_high_priority_service::commit(ws_handle,
+                                                             ws_meta));
+            recorder_.committed(ws_meta);
+            return ret;
+        }
+
+        int log_dummy_write_set(const wsrep::ws_handle& ws_handle,
+                                const wsrep::ws_meta& ws_meta,
+                                wsrep::mutable_buffer& err) WSREP_OVERRIDE
+        {
+            recorder_.dummy(ws_meta);
+            return mock_high_priority_service::log_dummy_write_set(
+                ws_handle, ws_meta, err);
+        }
+
+        // Seqno which must be committed before write sets with
+        // greater seqno commit, zero for none.
+        long long commit_after_;
+    private:
+        apply_recorder& recorder_;
+    };
+
+    struct applier_scheduler_fixture
+    {
+        applier_scheduler_fixture()
+            : server_service(ss)
+            , ss("s1", wsrep::server_state::rm_sync, server_service)
+            , recorder()
+            , cc(ss, wsrep::client_id(1),
+                 wsrep::client_state::m_high_priority)
+            , hps(ss, &cc, recorder)
+            , scheduler(ss)
+            , worker_clients()
+            , worker_services()
+        {
+            ss.mock_connect();
+            cc.open(cc.id());
+            cc.before_command();
+            for (size_t i(0); i < 4; ++i)
+            {
+                wsrep::mock_client* client(
+                    new wsrep::mock_client(
+                        ss, wsrep::client_id(i + 2),
+                        wsrep::client_state::m_high_priority));
+                client->open(client->id());
+                client->before_command();
+                worker_clients.push_back(client);
+                worker_services.push_back(
+                    new recording_high_priority_service(ss, client,
+                                                        recorder));
+            }
+            ss.applier_scheduler(&scheduler);
+        }
+
+        ~applier_scheduler_fixture()
+        {
+            scheduler.stop();
+            ss.applier_scheduler(0);
+            for (size_t i(0); i < worker_services.size(); ++i)
+            {
+                worker_services[i]->store_globals();
+                worker_clients[i]->after_command_before_result();
+                worker_clients[i]->after_command_after_result();
+                worker_clients[i]->close();
+                worker_clients[i]->cleanup();
+                delete worker_services[i];
+                delete worker_clients[i];
+            }
+        }
+
+        int start()
+        {
+            std::vector<wsrep::high_priority_service*> services(
+                worker_services.begin(), worker_services.end());
+            return scheduler.start(services);
+        }
+
+        int apply(long long seqno, long long depends_on, int extra_flags = 0)
+        {
+            return apply_fragment(seqno, depends_on, seqno,
+                                  wsrep::provider::flag::start_transaction |
+                                  wsrep::provider::flag::commit |
+                                  extra_flags);
+        }
+
+        int apply_fragment(long long seqno, long long depends_on,
+                           long long transaction_id, int flags)
+        {
+            return apply_fragment(hps, seqno, depends_on, transaction_id,
+                                  flags);
+        }
+
+        int apply_fragment(wsrep::high_priority_service& receiver,
+                           long long seqno, long long depends_on,
+                           long long transaction_id, int flags)
+        {
+            wsrep::ws_meta ws_meta(
+                wsrep::gtid(wsrep::id("1"), wsrep::seqno(seqno)),
+                wsrep::stid(wsrep::id("1"),
+                            wsrep::transaction_id(transaction_id),
+                            wsrep::client_id(1)),
+                wsrep::seqno(depends_on), flags);
+            return ss.on_apply(
+                receiver,
+                wsrep::ws_handle(wsrep::transaction_id(transaction_id),
+                                 (void*)1),
+                ws_meta,
+                wsrep::const_buffer("1", 1));
+        }
+
+        wsrep::mock_server_service server_service;
+        wsrep::mock_server_state ss;
+        apply_recorder recorder;
+        wsrep::mock_client cc;
+        recording_high_priority_service hps;
+        wsrep::applier_scheduler scheduler;
+        std::vector<wsrep::mock_client*> worker_clients;
+        std::vector<recording_high_priority_service*> worker_services;
+    };
+
+    // Second receiving thread which applies one write set.
+    struct receiver_thread_args
+    {
+        applier_scheduler_fixture* fixture;
+        wsrep::high_priority_service* service;
+        long long seqno;
+        int result;
+    };
+
+    void* receiver_thread(void* arg)
+    {
+        receiver_thread_args* args(static_cast<receiver_thread_args*>(arg));
+        args->result = args->fixture->apply_fragment(
+            *args->service, args->seqno, 0, args->seqno,
+            wsrep::provider::flag::start_transaction |
+            wsrep::provider::flag::commit);
+        return 0;
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(applier_scheduler_not_started,
+                        applier_scheduler_fixture)
+{
+    // Write sets are applied in the calling thread if no workers
+    // have been started.
+    BOOST_REQUIRE(apply(1, 0) == 0);
+    BOOST_REQUIRE(recorder.committed() == 1);
+    BOOST_REQUIRE(scheduler.applied() == 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(applier_scheduler_dependencies,
+                        applier_scheduler_fixture)
+{
+    BOOST_REQUIRE(start() == 0);
+    BOOST_REQUIRE(scheduler.workers() == 4);
+    const long long count(1000);
+    size_t barriers(0);
+    for (long long i(1); i <= count; ++i)
+    {
+        if (i % 100 == 0)
+        {
+            // Write set which is not safe for parallel applying
+            // is applied by the receiving thread.
+            BOOST_REQUIRE(apply(i, i - 1,
+                                wsrep::provider::flag::pa_unsafe) == 0);
+            ++barriers;
+        }
+        else
+        {
+            // Mix of write sets depending on the previous one and
+            // write sets depending on older ones.
+            BOOST_REQUIRE(apply(i, i % 3 == 0 ? i - 1 :
+                                std::max(0LL, i - 10)) == 0);
+        }
+    }
+    scheduler.drain();
+    BOOST_REQUIRE(recorder.committed() == size_t(count));
+    BOOST_REQUIRE(recorder.violations() == 0);
+    BOOST_REQUIRE(scheduler.applied() == size_t(count) - barriers);
+}
+
+BOOST_FIXTURE_TEST_CASE(applier_scheduler_commutative,
+                        applier_scheduler_fixture)
+{
+    BOOST_REQUIRE(start() == 0);
+    const long long count(100);
+    for (long long i(1); i <= count; ++i)
+    {
+        // Commutative write sets are scheduled even though each
+        // of them depends on the previous one.
+        BOOST_REQUIRE(apply(i, i - 1,
+                            wsrep::provider::flag::commutative) == 0);
+    }
+    scheduler.drain();
+    BOOST_REQUIRE(recorder.committed() == size_t(count));
+    BOOST_REQUIRE(scheduler.applied() == size_t(count));
+}
+
+BOOST_FIXTURE_TEST_CASE(applier_scheduler_synchronous,
+                        applier_scheduler_fixture)
+{
+    BOOST_REQUIRE(start() == 0);
+    // Write set has been committed by a worker when the apply
+    // call returns.
+    for (long long i(1); i <= 10; ++i)
+    {
+        BOOST_REQUIRE(apply(i, 0) == 0);
+        BOOST_REQUIRE(recorder.committed() == size_t(i));
+    }
+    BOOST_REQUIRE(scheduler.applied() == 10);
+}
+
+BOOST_FIXTURE_TEST_CASE(applier_scheduler_apply_error,
+                        applier_scheduler_fixture)
+{
+    for (size_t i(0); i < worker_services.size(); ++i)
+    {
+        worker_services[i]->fail_next_applying_ = true;
+    }
+    BOOST_REQUIRE(start() == 0);
+    // The failure is reported for the failed write set only, and
+    // the write set is passed through commit order.
+    BOOST_REQUIRE(apply(1, 0) != 0);
+    BOOST_REQUIRE(recorder.dummies() == 1);
+    for (size_t i(0); i < worker_services.size(); ++i)
+    {
+        worker_services[i]->fail_next_applying_ = false;
+    }
+    BOOST_REQUIRE(apply(2, 0) == 0);
+    scheduler.drain();
+    BOOST_REQUIRE(recorder.committed() == 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(applier_scheduler_streaming_affinity,
+                        applier_scheduler_fixture)
+{
+    BOOST_REQUIRE(start() == 0);
+    // Three streaming transactions with interleaved fragments and
+    // write sets in between.
+    const long long transactions(3);
+    const long long fragments(5);
+    long long seqno(0);
+    for (long long f(0); f < fragments; ++f)
+    {
+        for (long long t(1); t <= transactions; ++t)
+        {
+            int flags(0);
+            if (f == 0)
+            {
+                flags = wsrep::provider::flag::start_transaction;
+            }
+            else if (f == fragments - 1)
+            {
+                flags = wsrep::provider::flag::commit;
+            }
+            ++seqno;
+            BOOST_REQUIRE(apply_fragment(seqno, seqno - 1, 1000 + t,
+                                         flags) == 0);
+            ++seqno;
+            BOOST_REQUIRE(apply(seqno, 0) == 0);
+        }
+    }
+    scheduler.drain();
+    BOOST_REQUIRE(scheduler.applied() == size_t(seqno));
+    for (long long t(1); t <= transactions; ++t)
+    {
+        BOOST_REQUIRE(recorder.fragment_appliers(1000 + t) == 1);
+        BOOST_REQUIRE(ss.find_streaming_applier(
+                          wsrep::id("1"), wsrep::transaction_id(1000 + t))
+                      == 0);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(applier_scheduler_barrier_concurrent_receivers,
+                        applier_scheduler_fixture)
+{
+    for (size_t i(0); i < worker_services.size(); ++i)
+    {
+        worker_services[i]->commit_after_ = 2;
+    }
+    BOOST_REQUIRE(start() == 0);
+    wsrep::mock_client receiver_client(
+        ss, wsrep::client_id(10), wsrep::client_state::m_high_priority);
+    receiver_client.open(receiver_client.id());
+    receiver_client.before_command();
+    recording_high_priority_service receiver_service(
+        ss, &receiver_client, recorder);
+    // Another receiving thread queues write set 3, which waits in
+    // commit order for the barrier 2.
+    receiver_thread_args args = { this, &receiver_service, 3, -1 };
+    pthread_t thread;
+    BOOST_REQUIRE(pthread_create(&thread, 0, receiver_thread, &args) == 0);
+    recorder.wait_applying(3);
+    // The barrier must not wait for write set 3.
+    BOOST_REQUIRE(apply(2, 1, wsrep::provider::flag::pa_unsafe) == 0);
+    pthread_join(thread, 0);
+    BOOST_REQUIRE(args.result == 0);
+    BOOST_REQUIRE(recorder.committed() == 2);
+    receiver_service.store_globals();
+    receiver_client.after_command_before_result();
+    receiver_client.after_command_after_result();
+    receiver_client.close();
+    receiver_client.cleanup();
+}
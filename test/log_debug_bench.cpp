@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/** @file log_debug_bench.cpp
+ *
+ * Benchmark for the overhead of debug logging call sites when
+ * debug logging is disabled at runtime.
+ *
+ * Each iteration runs a local transaction through the commit path
+ * of wsrep::client_state and wsrep::transaction, replicated
+ * via the mock provider.
+ *
+ * The benchmark is built twice: log_debug_bench links against
+ * wsrep-lib built with the configured maximum debug level and
+ * log_debug_bench_compiled_out against wsrep-lib_no_debug_log,
+ * which is built with WSREP_LIB_MAX_DEBUG_LEVEL=0. Comparing the
+ * results of the two binaries shows the per transaction overhead.
+ *
+ * Usage: log_debug_bench [boost test options] -- [transactions]
+ */
+
+#define BOOST_TEST_ALTERNATIVE_INIT_API
+#include <boost/test/included/unit_test.hpp>
+
+#include "client_state_fixture.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+    long long transactions(1000000);
+
+    void log_debug_bench()
+    {
+        replicating_client_fixture_sync_rm fixture;
+        wsrep::mock_client& cc(fixture.cc);
+
+        int vals[3] = { 1, 2, 3 };
+        wsrep::key key(wsrep::key::exclusive);
+        for (int i(0); i < 3; ++i)
+        {
+            key.append_key_part(&vals[i], sizeof(vals[i]));
+        }
+        wsrep::const_buffer data(&vals[2], sizeof(vals[2]));
+
+        int ret(0);
+        std::chrono::steady_clock::time_point start(
+            std::chrono::steady_clock::now());
+        for (long long i(0); i < transactions; ++i)
+        {
+            ret = ret || cc.start_transaction(wsrep::transaction_id(i + 1));
+            ret = ret || cc.append_key(key);
+            ret = ret || cc.append_data(data);
+            ret = ret || cc.before_commit();
+            ret = ret || cc.ordered_commit();
+            ret = ret || cc.after_commit();
+            ret = ret || cc.after_statement();
+            cc.after_command_before_result();
+            cc.after_command_after_result();
+            ret = ret || cc.before_command();
+            ret = ret || cc.before_statement();
+        }
+        std::chrono::duration<double, std::nano> elapsed(
+            std::chrono::steady_clock::now() - start);
+        BOOST_REQUIRE(ret == 0);
+
+        std::cout << "Max debug level: " << wsrep::log::max_debug_level
+                  << " transactions: " << transactions
+                  << " time: " << elapsed.count() / transactions
+                  << " ns/transaction" << std::endl;
+    }
+}
+
+bool init_unit_test()
+{
+    boost::unit_test::master_test_suite_t& suite(
+        boost::unit_test::framework::master_test_suite());
+    if (suite.argc > 1)
+    {
+        transactions = std::strtoll(suite.argv[1], 0, 10);
+    }
+    suite.add(BOOST_TEST_CASE(&log_debug_bench));
+    return true;
+}
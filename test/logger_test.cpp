@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "wsrep/logger.hpp"
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <cstring>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace
+{
+    // Accessed only from the thread calling the logger function,
+    // which is either the logging thread or the flusher thread.
+    std::vector<std::string> captured;
+
+    void capture_fn(wsrep::log::level, const char* msg)
+    {
+        captured.push_back(msg);
+    }
+
+    struct logger_fixture
+    {
+        logger_fixture()
+            : orig_fn(wsrep::log::logger_fn())
+        {
+            captured.clear();
+            wsrep::log::logger_fn(capture_fn);
+        }
+        ~logger_fixture()
+        {
+            wsrep::log::stop_async();
+            wsrep::log::logger_fn(orig_fn);
+        }
+        wsrep::log::logger_fn_type orig_fn;
+    };
+
+    // Logger function which may be called concurrently from
+    // the producer threads and from the flusher thread.
+    std::atomic<size_t> counted;
+
+    void count_fn(wsrep::log::level, const char* msg)
+    {
+        if (std::strncmp(msg, "producer ", 9) == 0)
+        {
+            counted.fetch_add(1);
+        }
+    }
+
+    const int producer_messages = 100000;
+
+    void* logger_producer_thread(void*)
+    {
+        for (int i(0); i < producer_messages; ++i)
+        {
+            wsrep::log_info() << "producer " << i;
+        }
+        return 0;
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(logger_sync, logger_fixture)
+{
+    wsrep::log_info() << "message " << 1;
+    wsrep::log_info() << std::hex << 255;
+    // Formatting state must not leak into the next message.
+    wsrep::log_info() << 255;
+    BOOST_REQUIRE(captured.size() == 3);
+    BOOST_REQUIRE(captured[0] == "message 1");
+    BOOST_REQUIRE(captured[1] == "ff");
+    BOOST_REQUIRE(captured[2] == "255");
+}
+
+BOOST_FIXTURE_TEST_CASE(logger_async, logger_fixture)
+{
+    BOOST_REQUIRE(wsrep::log::start_async() == 0);
+    size_t const dropped(wsrep::log::async_dropped());
+    for (int i(0); i < 100; ++i)
+    {
+        wsrep::log_info() << "message " << i;
+    }
+    wsrep::log::stop_async();
+    BOOST_REQUIRE(wsrep::log::async_dropped() == dropped);
+    BOOST_REQUIRE(captured.size() == 100);
+    BOOST_REQUIRE(captured[0] == "message 0");
+    BOOST_REQUIRE(captured[99] == "message 99");
+}
+
+BOOST_FIXTURE_TEST_CASE(logger_async_truncate, logger_fixture)
+{
+    BOOST_REQUIRE(wsrep::log::start_async() == 0);
+    // Errors bypass the ring and are not truncated.
+    wsrep::log_error() << std::string(10000, 'b');
+    wsrep::log_info() << std::string(10000, 'a');
+    wsrep::log::stop_async();
+    BOOST_REQUIRE(captured.size() == 2);
+    BOOST_REQUIRE(captured[0] == std::string(10000, 'b'));
+    BOOST_REQUIRE(captured[1].size() > 0);
+    BOOST_REQUIRE(captured[1].size() < 10000);
+}
+
+//
+// Stop asynchronous logging while producers are logging. Every
+// message must be either written or counted as dropped.
+//
+BOOST_FIXTURE_TEST_CASE(logger_async_stop_concurrent, logger_fixture)
+{
+    counted.store(0);
+    wsrep::log::logger_fn(count_fn);
+    size_t const dropped(wsrep::log::async_dropped());
+    BOOST_REQUIRE(wsrep::log::start_async() == 0);
+    const int n_producers(4);
+    pthread_t producers[n_producers];
+    for (int i(0); i < n_producers; ++i)
+    {
+        BOOST_REQUIRE(pthread_create(&producers[i], 0,
+                                     logger_producer_thread, 0) == 0);
+    }
+    // Stop after the flusher has written some of the messages.
+    while (counted.load() == 0)
+    {
+        sched_yield();
+    }
+    wsrep::log::stop_async();
+    for (int i(0); i < n_producers; ++i)
+    {
+        pthread_join(producers[i], 0);
+    }
+    BOOST_REQUIRE(counted.load() + wsrep::log::async_dropped() - dropped ==
+                  size_t(n_producers * producer_messages));
+}
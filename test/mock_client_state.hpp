@@ -78,7 +78,7 @@ namespace wsrep
 
         int bf_rollback() WSREP_OVERRIDE;
 
-        bool interrupted(wsrep::unique_lock<wsrep::mutex>&)
+        bool interrupted(wsrep::unique_lock<wsrep::client_mutex>&)
             const WSREP_OVERRIDE
         { return killed_before_certify_; }
 
@@ -103,7 +103,7 @@ namespace wsrep
         enum wsrep::provider::status
         replay() WSREP_OVERRIDE;
         void wait_for_replayers(
-            wsrep::unique_lock<wsrep::mutex>& lock)
+            wsrep::unique_lock<wsrep::client_mutex>& lock)
             WSREP_OVERRIDE
         {
             lock.unlock();
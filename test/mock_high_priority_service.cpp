@@ -52,6 +52,11 @@ int wsrep::mock_high_priority_service::apply_write_set(
     }
     else
     {
+        if (wsrep::commits_transaction(meta.flags()) == false)
+        {
+            // Fragment of streaming transaction
+            client_state_->fragment_applied(meta.seqno());
+        }
         return 0;
     };
 }
@@ -61,6 +66,15 @@ int wsrep::mock_high_priority_service::commit(
     const wsrep::ws_meta& ws_meta)
 {
     int ret(0);
+    if (ws_meta.ordered() == false)
+    {
+        // Commit which was not ordered does not go through commit
+        // hooks, the transaction is rolled back in order to clean up
+        // the transaction state (e.g. after removing fragments of
+        // orphaned streaming transaction).
+        return (client_state_->before_rollback() ||
+                client_state_->after_rollback());
+    }
     client_state_->prepare_for_ordering(ws_handle, ws_meta, true);
     if (do_2pc_)
     {
@@ -90,6 +104,27 @@ int wsrep::mock_high_priority_service::apply_toi(const wsrep::ws_meta&,
     return (fail_next_toi_ ? 1 : 0);
 }
 
+int wsrep::mock_high_priority_service::apply_nbo_begin(
+    const wsrep::ws_meta& ws_meta,
+    const wsrep::const_buffer&,
+    wsrep::mutable_buffer&)
+{
+    assert(wsrep::is_toi(ws_meta.flags()));
+    assert(wsrep::starts_transaction(ws_meta.flags()));
+    assert(wsrep::commits_transaction(ws_meta.flags()) == false);
+    if (fail_next_toi_)
+    {
+        return 1;
+    }
+    nbo_cs_.reset(new wsrep::mock_client(client_state_->server_state(),
+                                         wsrep::client_id(1),
+                                         wsrep::client_state::m_local));
+    nbo_cs_->open(nbo_cs_->id());
+    nbo_cs_->before_command();
+    nbo_cs_->before_statement();
+    return nbo_cs_->enter_nbo_mode(ws_meta);
+}
+
 void wsrep::mock_high_priority_service::adopt_apply_error(
     wsrep::mutable_buffer& err)
 {
@@ -23,6 +23,8 @@
 #include "wsrep/high_priority_service.hpp"
 #include "mock_client_state.hpp"
 
+#include <memory>
+
 namespace wsrep
 {
     class mock_high_priority_service : public wsrep::high_priority_service
@@ -36,6 +38,8 @@ namespace wsrep
             , do_2pc_()
             , fail_next_applying_()
             , fail_next_toi_()
+            , nbo_cs_()
+            , execution_context_switches_()
             , client_state_(client_state)
             , replaying_(replaying)
         { }
@@ -62,12 +66,16 @@ namespace wsrep
         int apply_toi(const wsrep::ws_meta&,
                       const wsrep::const_buffer&,
                       wsrep::mutable_buffer&) WSREP_OVERRIDE;
+        int apply_nbo_begin(const wsrep::ws_meta&,
+                            const wsrep::const_buffer&,
+                            wsrep::mutable_buffer&) WSREP_OVERRIDE;
         void adopt_apply_error(wsrep::mutable_buffer& err) WSREP_OVERRIDE;
         void after_apply() WSREP_OVERRIDE;
-        void store_globals() WSREP_OVERRIDE { }
+        void store_globals() WSREP_OVERRIDE
+        { client_state_->store_globals(); }
         void reset_globals() WSREP_OVERRIDE { }
         void switch_execution_context(wsrep::high_priority_service&)
-            WSREP_OVERRIDE { }
+            WSREP_OVERRIDE { ++execution_context_switches_; }
         int log_dummy_write_set(const wsrep::ws_handle&,
                                 const wsrep::ws_meta&,
                                 wsrep::mutable_buffer&) WSREP_OVERRIDE;
@@ -81,6 +89,10 @@ namespace wsrep
         bool do_2pc_;
         bool fail_next_applying_;
         bool fail_next_toi_;
+        // Client which continues NBO operation after NBO begin
+        // has been applied.
+        std::unique_ptr<wsrep::mock_client> nbo_cs_;
+        size_t execution_context_switches_;
     private:
         mock_high_priority_service(const mock_high_priority_service&);
         mock_high_priority_service& operator=(const mock_high_priority_service&);
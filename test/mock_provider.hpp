@@ -24,9 +24,13 @@
 #include "wsrep/logger.hpp"
 #include "wsrep/buffer.hpp"
 #include "wsrep/high_priority_service.hpp"
+#include "wsrep/mutex.hpp"
+#include "wsrep/condition_variable.hpp"
+#include "wsrep/atomic.hpp"
 
 #include <cstring>
 #include <map>
+#include <sstream>
 #include <iostream> // todo: proper logging
 
 #include <boost/test/unit_test.hpp>
@@ -45,6 +49,8 @@ namespace wsrep
             , commit_order_leave_result_()
             , release_result_()
             , replay_result_()
+            , enter_toi_result_()
+            , leave_toi_result_()
             , group_id_("1")
             , server_id_("1")
             , group_seqno_(0)
@@ -53,6 +59,14 @@ namespace wsrep
             , fragments_()
             , commit_fragments_()
             , rollback_fragments_()
+            , toi_write_sets_()
+            , toi_start_transaction_()
+            , toi_commit_()
+            , toi_leaves_()
+            , applier_mutex_()
+            , applier_cond_()
+            , block_appliers_()
+            , recv_queue_length_(0)
         { }
 
         enum wsrep::provider::status
@@ -65,9 +79,16 @@ namespace wsrep
         int resync() WSREP_OVERRIDE { return 0; }
         wsrep::seqno pause() WSREP_OVERRIDE { return wsrep::seqno(0); }
         int resume() WSREP_OVERRIDE { return 0; }
-        enum wsrep::provider::status run_applier(wsrep::high_priority_service*)
+        enum wsrep::provider::status run_applier(
+            wsrep::high_priority_service* high_priority_service)
             WSREP_OVERRIDE
         {
+            wsrep::unique_lock<wsrep::mutex> lock(applier_mutex_);
+            while (block_appliers_ &&
+                   high_priority_service->must_exit() == false)
+            {
+                applier_cond_.wait(lock);
+            }
             return wsrep::provider::success;
         }
         // Provider implemenatation interface
@@ -235,17 +256,46 @@ namespace wsrep
             return wsrep::provider::success;
         }
 
-        enum wsrep::provider::status enter_toi(wsrep::client_id,
+        enum wsrep::provider::status enter_toi(wsrep::client_id client_id,
                                                const wsrep::key_array&,
                                                const wsrep::const_buffer&,
-                                               wsrep::ws_meta&,
-                                               int)
+                                               wsrep::ws_meta& toi_meta,
+                                               int flags)
             WSREP_OVERRIDE
-        { return wsrep::provider::success; }
+        {
+            if (enter_toi_result_)
+            {
+                return enter_toi_result_;
+            }
+            // NBO end must refer to the NBO begin event.
+            BOOST_REQUIRE(starts_transaction(flags) ||
+                          toi_meta.seqno().is_undefined() == false);
+            ++group_seqno_;
+            wsrep::gtid gtid(group_id_, wsrep::seqno(group_seqno_));
+            wsrep::stid stid(server_id_,
+                             wsrep::transaction_id::undefined(),
+                             client_id);
+            toi_meta = wsrep::ws_meta(gtid, stid,
+                                      wsrep::seqno(group_seqno_ - 1),
+                                      flags | wsrep::provider::flag::isolation);
+            ++toi_write_sets_;
+            if (starts_transaction(flags))
+            {
+                ++toi_start_transaction_;
+            }
+            if (commits_transaction(flags))
+            {
+                ++toi_commit_;
+            }
+            return wsrep::provider::success;
+        }
         enum wsrep::provider::status leave_toi(wsrep::client_id,
                                                const wsrep::mutable_buffer&)
             WSREP_OVERRIDE
-        { return wsrep::provider::success; }
+        {
+            ++toi_leaves_;
+            return leave_toi_result_;
+        }
 
         std::pair<wsrep::gtid, enum wsrep::provider::status>
         causal_read(int) const WSREP_OVERRIDE
@@ -266,7 +316,11 @@ namespace wsrep
 
         std::vector<status_variable> status() const WSREP_OVERRIDE
         {
-            return std::vector<status_variable>();
+            std::ostringstream os;
+            os << recv_queue_length_.load();
+            std::vector<status_variable> ret;
+            ret.push_back(status_variable("local_recv_queue", os.str()));
+            return ret;
         }
         void reset_status() WSREP_OVERRIDE { }
         std::string options() const WSREP_OVERRIDE { return ""; }
@@ -310,11 +364,37 @@ namespace wsrep
         enum wsrep::provider::status commit_order_leave_result_;
         enum wsrep::provider::status release_result_;
         enum wsrep::provider::status replay_result_;
+        enum wsrep::provider::status enter_toi_result_;
+        enum wsrep::provider::status leave_toi_result_;
 
         size_t start_fragments() const { return start_fragments_; }
         size_t fragments() const { return fragments_; }
         size_t commit_fragments() const { return commit_fragments_; }
         size_t rollback_fragments() const { return rollback_fragments_; }
+        size_t toi_write_sets() const { return toi_write_sets_; }
+        size_t toi_start_transaction() const { return toi_start_transaction_; }
+        size_t toi_commit() const { return toi_commit_; }
+        size_t toi_leaves() const { return toi_leaves_; }
+
+        // Make run_applier() block until the applier must exit.
+        void block_appliers(bool block)
+        {
+            wsrep::unique_lock<wsrep::mutex> lock(applier_mutex_);
+            block_appliers_ = block;
+            applier_cond_.notify_all();
+        }
+
+        // Wake up appliers blocked in run_applier().
+        void wake_appliers()
+        {
+            wsrep::unique_lock<wsrep::mutex> lock(applier_mutex_);
+            applier_cond_.notify_all();
+        }
+
+        void recv_queue_length(long long length)
+        {
+            recv_queue_length_.store(length);
+        }
 
     private:
         wsrep::id group_id_;
@@ -325,6 +405,14 @@ namespace wsrep
         size_t fragments_;
         size_t commit_fragments_;
         size_t rollback_fragments_;
+        size_t toi_write_sets_;
+        size_t toi_start_transaction_;
+        size_t toi_commit_;
+        size_t toi_leaves_;
+        wsrep::default_mutex applier_mutex_;
+        wsrep::default_condition_variable applier_cond_;
+        bool block_appliers_;
+        std::atomic<long long> recv_queue_length_;
     };
 }
 
@@ -38,6 +38,8 @@ namespace wsrep
             : sync_point_enabled_()
             , sync_point_action_()
             , sst_before_init_()
+            , streaming_log_()
+            , fail_streaming_applier_recovery_()
             , server_state_(server_state)
             , last_client_id_(0)
             , last_transaction_id_(0)
@@ -111,6 +113,13 @@ namespace wsrep
             delete cs;
             delete mhps;
         }
+        int reset_streaming_applier_service(
+            wsrep::high_priority_service& high_priority_service)
+            WSREP_OVERRIDE
+        {
+            return high_priority_service.transaction().active();
+        }
+
         void bootstrap() WSREP_OVERRIDE { }
         void log_message(enum wsrep::log::level level, const char* message)
             WSREP_OVERRIDE
@@ -136,6 +145,46 @@ namespace wsrep
             WSREP_OVERRIDE
         { }
 
+        int scan_streaming_log(wsrep::client_service&,
+                               streaming_transactions& transactions)
+            WSREP_OVERRIDE
+        {
+            transactions = streaming_log_;
+            return 0;
+        }
+
+        int scan_streaming_log(wsrep::high_priority_service&,
+                               streaming_transactions& transactions)
+            WSREP_OVERRIDE
+        {
+            transactions = streaming_log_;
+            return 0;
+        }
+
+        int recover_streaming_applier(
+            wsrep::high_priority_service& streaming_applier,
+            const wsrep::id& server_id,
+            const wsrep::transaction_id& transaction_id) WSREP_OVERRIDE
+        {
+            if (transaction_id == fail_streaming_applier_recovery_)
+            {
+                return 1;
+            }
+            wsrep::ws_meta ws_meta(
+                wsrep::gtid(wsrep::id("1"),
+                            wsrep::seqno(transaction_id.get())),
+                wsrep::stid(server_id, transaction_id, wsrep::client_id()),
+                wsrep::seqno::undefined(),
+                wsrep::provider::flag::start_transaction);
+            wsrep::mutable_buffer err;
+            int ret(streaming_applier.start_transaction(
+                        wsrep::ws_handle(transaction_id, (void*)1), ws_meta));
+            ret = ret || streaming_applier.apply_write_set(
+                ws_meta, wsrep::const_buffer("1", 1), err);
+            streaming_applier.after_apply();
+            return ret;
+        }
+
         wsrep::view get_view(wsrep::client_service&, const wsrep::id& own_id)
             WSREP_OVERRIDE
         {
@@ -207,6 +256,10 @@ namespace wsrep
 
         } sync_point_action_;
         bool sst_before_init_;
+        // Streaming transactions returned by scan_streaming_log()
+        streaming_transactions streaming_log_;
+        // Recovery of streaming applier for this transaction fails
+        wsrep::transaction_id fail_streaming_applier_recovery_;
 
         void logged_view(const wsrep::view& view)
         {
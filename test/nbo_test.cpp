@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "client_state_fixture.hpp"
+#include "wsrep/client_state.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+    struct applying_nbo_fixture
+    {
+        applying_nbo_fixture()
+            : server_service(ss)
+            , ss("s1", wsrep::server_state::rm_sync, server_service)
+            , cc(ss, wsrep::client_id(1),
+                 wsrep::client_state::m_high_priority)
+            , hps(ss, &cc, false)
+            , ws_handle(wsrep::transaction_id::undefined(), (void*)1)
+        {
+            ss.mock_connect();
+            cc.open(cc.id());
+            BOOST_REQUIRE(cc.before_command() == 0);
+        }
+
+        wsrep::ws_meta nbo_meta(long long seqno, int flags)
+        {
+            return wsrep::ws_meta(
+                wsrep::gtid(wsrep::id("1"), wsrep::seqno(seqno)),
+                wsrep::stid(wsrep::id("s2"),
+                            wsrep::transaction_id::undefined(),
+                            wsrep::client_id(1)),
+                wsrep::seqno(seqno - 1),
+                flags | wsrep::provider::flag::isolation);
+        }
+
+        wsrep::mock_server_service server_service;
+        wsrep::mock_server_state ss;
+        wsrep::mock_client cc;
+        wsrep::mock_high_priority_service hps;
+        wsrep::ws_handle ws_handle;
+    };
+
+    wsrep::key_array nbo_keys()
+    {
+        wsrep::key key(wsrep::key::exclusive);
+        key.append_key_part("k1", 2);
+        key.append_key_part("k2", 2);
+        wsrep::key_array keys;
+        keys.push_back(key);
+        return keys;
+    }
+}
+
+//
+// Execute local NBO operation through both phases. Only the
+// start and the end of the operation are totally ordered.
+//
+BOOST_FIXTURE_TEST_CASE(client_state_nbo_local,
+                        replicating_client_fixture_sync_rm)
+{
+    wsrep::key_array keys(nbo_keys());
+    char buf[1] = { 1 };
+    BOOST_REQUIRE(cc.begin_nbo_phase_one(
+                      keys, wsrep::const_buffer(buf, 1)) == 0);
+    BOOST_REQUIRE(cc.mode() == wsrep::client_state::m_nbo);
+    BOOST_REQUIRE(cc.in_toi());
+    BOOST_REQUIRE(cc.in_nbo());
+    BOOST_REQUIRE(cc.toi_mode() == wsrep::client_state::m_local);
+    BOOST_REQUIRE(sc.provider().toi_write_sets() == 1);
+    BOOST_REQUIRE(sc.provider().toi_start_transaction() == 1);
+    BOOST_REQUIRE(sc.provider().toi_commit() == 0);
+    const wsrep::gtid begin_gtid(cc.nbo_meta().gtid());
+
+    BOOST_REQUIRE(cc.end_nbo_phase_one(wsrep::mutable_buffer()) == 0);
+    BOOST_REQUIRE(cc.mode() == wsrep::client_state::m_nbo);
+    BOOST_REQUIRE(cc.in_toi() == false);
+    BOOST_REQUIRE(cc.in_nbo());
+    BOOST_REQUIRE(cc.nbo_meta().gtid() == begin_gtid);
+    BOOST_REQUIRE(sc.provider().toi_leaves() == 1);
+    BOOST_REQUIRE(sc.last_committed_gtid() == begin_gtid);
+
+    BOOST_REQUIRE(cc.begin_nbo_phase_two(keys) == 0);
+    BOOST_REQUIRE(cc.mode() == wsrep::client_state::m_nbo);
+    BOOST_REQUIRE(cc.in_toi());
+    BOOST_REQUIRE(cc.toi_mode() == wsrep::client_state::m_local);
+    BOOST_REQUIRE(sc.provider().toi_write_sets() == 2);
+    BOOST_REQUIRE(sc.provider().toi_start_transaction() == 1);
+    BOOST_REQUIRE(sc.provider().toi_commit() == 1);
+    BOOST_REQUIRE(cc.toi_meta().seqno() > begin_gtid.seqno());
+    const wsrep::gtid end_gtid(cc.toi_meta().gtid());
+
+    BOOST_REQUIRE(cc.end_nbo_phase_two(wsrep::mutable_buffer()) == 0);
+    BOOST_REQUIRE(cc.mode() == wsrep::client_state::m_local);
+    BOOST_REQUIRE(cc.in_toi() == false);
+    BOOST_REQUIRE(cc.in_nbo() == false);
+    BOOST_REQUIRE(cc.toi_mode() == wsrep::client_state::m_undefined);
+    BOOST_REQUIRE(sc.provider().toi_leaves() == 2);
+    BOOST_REQUIRE(sc.last_committed_gtid() == end_gtid);
+    BOOST_REQUIRE(cc.current_error() == wsrep::e_success);
+}
+
+//
+// Execute local TOI operation. The position is published when the
+// operation leaves the total order.
+//
+BOOST_FIXTURE_TEST_CASE(client_state_toi_local,
+                        replicating_client_fixture_sync_rm)
+{
+    BOOST_REQUIRE(cc.enter_toi_local(
+                      nbo_keys(), wsrep::const_buffer("1", 1),
+                      wsrep::provider::flag::start_transaction |
+                      wsrep::provider::flag::commit) == 0);
+    BOOST_REQUIRE(cc.in_toi());
+    const wsrep::gtid gtid(cc.toi_meta().gtid());
+    BOOST_REQUIRE(sc.last_committed_seqno() < gtid.seqno());
+    BOOST_REQUIRE(cc.leave_toi_local(wsrep::mutable_buffer()) == 0);
+    BOOST_REQUIRE(cc.in_toi() == false);
+    BOOST_REQUIRE(sc.last_committed_gtid() == gtid);
+}
+
+//
+// Provider error when entering the first phase. The client must
+// remain in local mode.
+//
+BOOST_FIXTURE_TEST_CASE(client_state_nbo_phase_one_error,
+                        replicating_client_fixture_sync_rm)
+{
+    sc.provider().enter_toi_result_ =
+        wsrep::provider::error_certification_failed;
+    BOOST_REQUIRE(cc.begin_nbo_phase_one(
+                      nbo_keys(), wsrep::const_buffer("1", 1)) == 1);
+    BOOST_REQUIRE(cc.mode() == wsrep::client_state::m_local);
+    BOOST_REQUIRE(cc.in_toi() == false);
+    BOOST_REQUIRE(cc.in_nbo() == false);
+    BOOST_REQUIRE(cc.current_error() == wsrep::e_error_during_commit);
+    BOOST_REQUIRE(cc.current_error_status() ==
+                  wsrep::provider::error_certification_failed);
+    BOOST_REQUIRE(sc.provider().toi_write_sets() == 0);
+}
+
+//
+// Provider error when entering the second phase. The NBO end was not
+// replicated so the client must remain in NBO mode and be able to
+// retry.
+//
+BOOST_FIXTURE_TEST_CASE(client_state_nbo_phase_two_error,
+                        replicating_client_fixture_sync_rm)
+{
+    wsrep::key_array keys(nbo_keys());
+    BOOST_REQUIRE(cc.begin_nbo_phase_one(
+                      keys, wsrep::const_buffer("1", 1)) == 0);
+    BOOST_REQUIRE(cc.end_nbo_phase_one(wsrep::mutable_buffer()) == 0);
+
+    sc.provider().enter_toi_result_ = wsrep::provider::error_connection_failed;
+    BOOST_REQUIRE(cc.begin_nbo_phase_two(keys) == 1);
+    BOOST_REQUIRE(cc.mode() == wsrep::client_state::m_nbo);
+    BOOST_REQUIRE(cc.in_toi() == false);
+    BOOST_REQUIRE(cc.in_nbo());
+    BOOST_REQUIRE(cc.current_error_status() ==
+                  wsrep::provider::error_connection_failed);
+
+    cc.reset_error();
+    sc.provider().enter_toi_result_ = wsrep::provider::success;
+    BOOST_REQUIRE(cc.begin_nbo_phase_two(keys) == 0);
+    BOOST_REQUIRE(cc.end_nbo_phase_two(wsrep::mutable_buffer()) == 0);
+    BOOST_REQUIRE(cc.mode() == wsrep::client_state::m_local);
+    BOOST_REQUIRE(cc.in_nbo() == false);
+}
+
+//
+// Apply NBO begin event. The operation is handed over to a separate
+// client which completes the operation with local NBO phase two.
+//
+BOOST_FIXTURE_TEST_CASE(server_state_nbo_apply, applying_nbo_fixture)
+{
+    wsrep::ws_meta begin_meta(
+        nbo_meta(1, wsrep::provider::flag::start_transaction));
+    BOOST_REQUIRE(ss.on_apply(hps, ws_handle, begin_meta,
+                              wsrep::const_buffer("1", 1)) == 0);
+    BOOST_REQUIRE(hps.nbo_cs_.get() != 0);
+    wsrep::mock_client& nbo_cs(*hps.nbo_cs_);
+    BOOST_REQUIRE(nbo_cs.mode() == wsrep::client_state::m_nbo);
+    BOOST_REQUIRE(nbo_cs.in_nbo());
+    BOOST_REQUIRE(nbo_cs.in_toi() == false);
+    BOOST_REQUIRE(nbo_cs.nbo_meta().gtid() == begin_meta.gtid());
+    BOOST_REQUIRE(ss.last_committed_gtid() == begin_meta.gtid());
+
+    BOOST_REQUIRE(nbo_cs.begin_nbo_phase_two(nbo_keys()) == 0);
+    BOOST_REQUIRE(nbo_cs.in_toi());
+    BOOST_REQUIRE(ss.provider().toi_commit() == 1);
+    BOOST_REQUIRE(ss.provider().toi_start_transaction() == 0);
+    BOOST_REQUIRE(nbo_cs.end_nbo_phase_two(wsrep::mutable_buffer()) == 0);
+    BOOST_REQUIRE(nbo_cs.mode() == wsrep::client_state::m_local);
+    BOOST_REQUIRE(nbo_cs.in_nbo() == false);
+    nbo_cs.after_statement();
+    nbo_cs.after_command_before_result();
+    nbo_cs.after_command_after_result();
+    nbo_cs.close();
+    nbo_cs.cleanup();
+}
+
+//
+// Failure to apply NBO begin event must be reported back to the caller.
+//
+BOOST_FIXTURE_TEST_CASE(server_state_nbo_apply_error, applying_nbo_fixture)
+{
+    hps.fail_next_toi_ = true;
+    BOOST_REQUIRE(ss.on_apply(hps, ws_handle,
+                              nbo_meta(1,
+                                       wsrep::provider::flag::start_transaction),
+                              wsrep::const_buffer("1", 1)) == 1);
+    BOOST_REQUIRE(hps.nbo_cs_.get() == 0);
+}
+
+//
+// Failure to enter commit order for NBO begin event must be reported
+// back to the caller and the operation must not be started.
+//
+BOOST_FIXTURE_TEST_CASE(server_state_nbo_apply_enter_error,
+                        applying_nbo_fixture)
+{
+    ss.provider().commit_order_enter_result_ =
+        wsrep::provider::error_provider_failed;
+    BOOST_REQUIRE(ss.on_apply(hps, ws_handle,
+                              nbo_meta(1,
+                                       wsrep::provider::flag::start_transaction),
+                              wsrep::const_buffer("1", 1)) != 0);
+    ss.provider().commit_order_enter_result_ = wsrep::provider::success;
+    BOOST_REQUIRE(hps.nbo_cs_.get() == 0);
+    BOOST_REQUIRE(cc.mode() == wsrep::client_state::m_high_priority);
+    BOOST_REQUIRE(ss.last_committed_seqno() == wsrep::seqno(1));
+}
+
+//
+// Apply NBO end event. The event only passes through the commit order.
+//
+BOOST_FIXTURE_TEST_CASE(server_state_nbo_apply_end, applying_nbo_fixture)
+{
+    BOOST_REQUIRE(ss.on_apply(hps, ws_handle,
+                              nbo_meta(2, wsrep::provider::flag::commit),
+                              wsrep::const_buffer()) == 0);
+    BOOST_REQUIRE(hps.nbo_cs_.get() == 0);
+    BOOST_REQUIRE(ss.last_committed_seqno() == wsrep::seqno(2));
+    BOOST_REQUIRE(cc.mode() == wsrep::client_state::m_high_priority);
+}
+
+//
+// Failure to enter commit order for NBO end event must be reported
+// back to the caller.
+//
+BOOST_FIXTURE_TEST_CASE(server_state_nbo_apply_end_error,
+                        applying_nbo_fixture)
+{
+    ss.provider().commit_order_enter_result_ =
+        wsrep::provider::error_provider_failed;
+    BOOST_REQUIRE(ss.on_apply(hps, ws_handle,
+                              nbo_meta(2, wsrep::provider::flag::commit),
+                              wsrep::const_buffer()) != 0);
+    ss.provider().commit_order_enter_result_ = wsrep::provider::success;
+    BOOST_REQUIRE(cc.mode() == wsrep::client_state::m_high_priority);
+}
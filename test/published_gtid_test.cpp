@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "wsrep/published_gtid.hpp"
+#include <boost/test/unit_test.hpp>
+
+#include <pthread.h>
+
+BOOST_AUTO_TEST_CASE(published_gtid_store_load)
+{
+    wsrep::published_gtid pg;
+    BOOST_REQUIRE(pg.load().is_undefined());
+    BOOST_REQUIRE(pg.seqno().is_undefined());
+
+    const wsrep::id id("1");
+    BOOST_REQUIRE(pg.store(wsrep::gtid(id, wsrep::seqno(1))));
+    BOOST_REQUIRE(pg.load() == wsrep::gtid(id, wsrep::seqno(1)));
+    BOOST_REQUIRE(pg.seqno() == wsrep::seqno(1));
+
+    // Seqno must not go backwards within the same history.
+    BOOST_REQUIRE(pg.store(wsrep::gtid(id, wsrep::seqno(1))) == false);
+    BOOST_REQUIRE(pg.store(wsrep::gtid(id, wsrep::seqno(0))) == false);
+    BOOST_REQUIRE(pg.load() == wsrep::gtid(id, wsrep::seqno(1)));
+
+    // New history is accepted.
+    const wsrep::id id2("2");
+    BOOST_REQUIRE(pg.store(wsrep::gtid(id2, wsrep::seqno(0))));
+    BOOST_REQUIRE(pg.load() == wsrep::gtid(id2, wsrep::seqno(0)));
+}
+
+BOOST_AUTO_TEST_CASE(published_gtid_wait_timeout)
+{
+    wsrep::published_gtid pg;
+    pg.store(wsrep::gtid(wsrep::id("1"), wsrep::seqno(1)));
+    BOOST_REQUIRE(pg.wait(wsrep::seqno(1), 0) == 0);
+    BOOST_REQUIRE(pg.wait(wsrep::seqno(2), 0) != 0);
+}
+
+namespace
+{
+    struct published_gtid_writer
+    {
+        wsrep::published_gtid* pg;
+        long long last;
+    };
+
+    // Publish GTIDs whose id encodes the seqno, so that a torn read
+    // can be detected by readers.
+    wsrep::gtid encoded_gtid(long long seqno)
+    {
+        long long data[2] = { seqno, -seqno };
+        return wsrep::gtid(wsrep::id(data, sizeof(data)),
+                           wsrep::seqno(seqno));
+    }
+
+    void* published_gtid_writer_thread(void* arg)
+    {
+        published_gtid_writer* writer(
+            static_cast<published_gtid_writer*>(arg));
+        for (long long i(1); i <= writer->last; ++i)
+        {
+            writer->pg->store(encoded_gtid(i));
+        }
+        return 0;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(published_gtid_concurrent)
+{
+    wsrep::published_gtid pg;
+    published_gtid_writer writer = { &pg, 100000 };
+    pthread_t thread;
+    BOOST_REQUIRE(pthread_create(&thread, 0, published_gtid_writer_thread,
+                                 &writer) == 0);
+    long long prev(-1);
+    size_t torn(0);
+    wsrep::gtid gtid;
+    do
+    {
+        gtid = pg.load();
+        if (gtid.seqno().get() > 0 &&
+            !(gtid == encoded_gtid(gtid.seqno().get())))
+        {
+            ++torn;
+        }
+        BOOST_REQUIRE(gtid.seqno().get() >= prev);
+        prev = gtid.seqno().get();
+    }
+    while (gtid.seqno().get() < writer.last &&
+           pg.wait(wsrep::seqno(prev + 1), -1) == 0);
+    pthread_join(thread, 0);
+    BOOST_REQUIRE(torn == 0);
+    BOOST_REQUIRE(pg.seqno() == wsrep::seqno(writer.last));
+}
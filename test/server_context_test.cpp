@@ -222,6 +222,80 @@ BOOST_FIXTURE_TEST_CASE(server_state_applying_1pc,
         "Transaction state " << txc.state() << " not committed");
 }
 
+BOOST_FIXTURE_TEST_CASE(server_state_applying_1pc_publishes_position,
+                        applying_server_fixture)
+{
+    char buf[1] = { 1 };
+    BOOST_REQUIRE(ss.on_apply(hps, ws_handle, ws_meta,
+                              wsrep::const_buffer(buf, 1)) == 0);
+    BOOST_REQUIRE(ss.last_committed_gtid() == ws_meta.gtid());
+    BOOST_REQUIRE(ss.wait_for_last_committed_seqno(ws_meta.seqno(), 0) == 0);
+}
+
+// Test on_apply() method for commutative write set
+BOOST_FIXTURE_TEST_CASE(server_state_applying_commutative,
+                        applying_server_fixture)
+{
+    ws_meta = wsrep::ws_meta(ws_meta.gtid(),
+                             wsrep::stid(ws_meta.server_id(),
+                                         ws_meta.transaction_id(),
+                                         ws_meta.client_id()),
+                             ws_meta.depends_on(),
+                             ws_meta.flags() |
+                             wsrep::provider::flag::commutative);
+    char buf[1] = { 1 };
+    BOOST_REQUIRE(ss.on_apply(hps, ws_handle, ws_meta,
+                              wsrep::const_buffer(buf, 1)) == 0);
+    const wsrep::transaction& txc(cc.transaction());
+    BOOST_REQUIRE(txc.state() == wsrep::transaction::s_committed);
+}
+
+// Test on_apply() method for commutative write set which does not
+// both start and commit a transaction
+BOOST_FIXTURE_TEST_CASE(server_state_applying_commutative_fragment,
+                        applying_server_fixture)
+{
+    ws_meta = wsrep::ws_meta(ws_meta.gtid(),
+                             wsrep::stid(ws_meta.server_id(),
+                                         ws_meta.transaction_id(),
+                                         ws_meta.client_id()),
+                             ws_meta.depends_on(),
+                             wsrep::provider::flag::start_transaction |
+                             wsrep::provider::flag::commutative);
+    char buf[1] = { 1 };
+    BOOST_REQUIRE(ss.on_apply(hps, ws_handle, ws_meta,
+                              wsrep::const_buffer(buf, 1)) == 1);
+    BOOST_REQUIRE(ss.find_streaming_applier(
+                      ws_meta.server_id(), ws_meta.transaction_id()) == 0);
+}
+
+// Test that execution context is switched only if the service is
+// not already bound to the original service
+BOOST_FIXTURE_TEST_CASE(server_state_high_priority_switch_bound,
+                        applying_server_fixture)
+{
+    wsrep::mock_client sa_cc(ss, wsrep::client_id(2),
+                             wsrep::client_state::m_high_priority);
+    wsrep::mock_high_priority_service sa(ss, &sa_cc, false);
+    wsrep::mock_client other_cc(ss, wsrep::client_id(3),
+                                wsrep::client_state::m_high_priority);
+    wsrep::mock_high_priority_service other(ss, &other_cc, false);
+    {
+        wsrep::high_priority_switch sw(hps, sa);
+    }
+    {
+        wsrep::high_priority_switch sw(hps, sa);
+    }
+    BOOST_REQUIRE(sa.execution_context_switches_ == 1);
+    {
+        wsrep::high_priority_switch sw(other, sa);
+    }
+    {
+        wsrep::high_priority_switch sw(hps, sa);
+    }
+    BOOST_REQUIRE(sa.execution_context_switches_ == 3);
+}
+
 // Test on_apply() method for 2pc
 BOOST_FIXTURE_TEST_CASE(server_state_applying_2pc,
                         applying_server_fixture)
@@ -249,6 +323,41 @@ BOOST_FIXTURE_TEST_CASE(server_state_applying_1pc_rollback,
     BOOST_REQUIRE(txc.state() == wsrep::transaction::s_aborted);
 }
 
+// The position of a write set which is passed through commit order
+// as a dummy write set is published
+BOOST_FIXTURE_TEST_CASE(server_state_applying_dummy_publishes_position,
+                        applying_server_fixture)
+{
+    ws_meta = wsrep::ws_meta(ws_meta.gtid(),
+                             wsrep::stid(ws_meta.server_id(),
+                                         ws_meta.transaction_id(),
+                                         ws_meta.client_id()),
+                             ws_meta.depends_on(),
+                             wsrep::provider::flag::start_transaction |
+                             wsrep::provider::flag::rollback);
+    BOOST_REQUIRE(ss.on_apply(hps, ws_handle, ws_meta,
+                              wsrep::const_buffer()) == 0);
+    BOOST_REQUIRE(ss.last_committed_gtid() == ws_meta.gtid());
+}
+
+BOOST_FIXTURE_TEST_CASE(server_state_applying_toi_publishes_position,
+                        applying_server_fixture)
+{
+    ws_meta = wsrep::ws_meta(ws_meta.gtid(),
+                             wsrep::stid(ws_meta.server_id(),
+                                         wsrep::transaction_id::undefined(),
+                                         ws_meta.client_id()),
+                             ws_meta.depends_on(),
+                             ws_meta.flags() |
+                             wsrep::provider::flag::isolation);
+    cc.enter_toi_mode(ws_meta);
+    char buf[1] = { 1 };
+    BOOST_REQUIRE(ss.on_apply(hps, ws_handle, ws_meta,
+                              wsrep::const_buffer(buf, 1)) == 0);
+    cc.leave_toi_mode();
+    BOOST_REQUIRE(ss.last_committed_gtid() == ws_meta.gtid());
+}
+
 // Test on_apply() method for 2pc transaction which
 // fails applying and rolls back
 BOOST_FIXTURE_TEST_CASE(server_state_applying_2pc_rollback,
@@ -297,6 +406,98 @@ BOOST_FIXTURE_TEST_CASE(server_state_streaming, applying_server_fixture)
                       ws_meta.server_id(), ws_meta.transaction_id()) == 0);
 }
 
+// Test that streaming applier services are reused from the pool
+BOOST_FIXTURE_TEST_CASE(server_state_streaming_applier_pool,
+                        applying_server_fixture)
+{
+    ss.streaming_applier_pool_size(1);
+    for (long long i(1); i <= 3; ++i)
+    {
+        wsrep::stid stid(wsrep::id("1"), wsrep::transaction_id(i),
+                         wsrep::client_id(1));
+        ws_meta = wsrep::ws_meta(
+            wsrep::gtid(wsrep::id("1"), wsrep::seqno(2 * i - 1)), stid,
+            wsrep::seqno(2 * i - 2),
+            wsrep::provider::flag::start_transaction);
+        BOOST_REQUIRE(ss.on_apply(hps, ws_handle, ws_meta,
+                                  wsrep::const_buffer("1", 1)) == 0);
+        ws_meta = wsrep::ws_meta(
+            wsrep::gtid(wsrep::id("1"), wsrep::seqno(2 * i)), stid,
+            wsrep::seqno(2 * i - 1),
+            wsrep::provider::flag::commit);
+        BOOST_REQUIRE(ss.on_apply(hps, ws_handle, ws_meta,
+                                  wsrep::const_buffer("1", 1)) == 0);
+        BOOST_REQUIRE(ss.streaming_applier_pool().size() == 1);
+    }
+    BOOST_REQUIRE(ss.streaming_applier_pool().misses() == 1);
+    BOOST_REQUIRE(ss.streaming_applier_pool().hits() == 2);
+    ss.streaming_applier_pool_size(0);
+    BOOST_REQUIRE(ss.streaming_applier_pool().size() == 0);
+}
+
+// Test that pooled streaming applier services are released
+// on disconnect
+BOOST_FIXTURE_TEST_CASE(server_state_streaming_applier_pool_disconnect,
+                        applying_server_fixture)
+{
+    ss.streaming_applier_pool_size(1);
+    wsrep::stid stid(wsrep::id("1"), wsrep::transaction_id(1),
+                     wsrep::client_id(1));
+    ws_meta = wsrep::ws_meta(
+        wsrep::gtid(wsrep::id("1"), wsrep::seqno(1)), stid,
+        wsrep::seqno(0), wsrep::provider::flag::start_transaction);
+    BOOST_REQUIRE(ss.on_apply(hps, ws_handle, ws_meta,
+                              wsrep::const_buffer("1", 1)) == 0);
+    ws_meta = wsrep::ws_meta(
+        wsrep::gtid(wsrep::id("1"), wsrep::seqno(2)), stid,
+        wsrep::seqno(1), wsrep::provider::flag::commit);
+    BOOST_REQUIRE(ss.on_apply(hps, ws_handle, ws_meta,
+                              wsrep::const_buffer("1", 1)) == 0);
+    BOOST_REQUIRE(ss.streaming_applier_pool().size() == 1);
+    BOOST_REQUIRE(ss.disconnect() == 0);
+    BOOST_REQUIRE(ss.streaming_applier_pool().size() == 0);
+    BOOST_REQUIRE(ss.streaming_applier_pool_size() == 1);
+}
+
+// Test that execution context is switched again for a pooled
+// streaming applier service reused for another transaction, even
+// if the fragments are applied by the same applier.
+BOOST_FIXTURE_TEST_CASE(server_state_streaming_applier_pool_reuse_switch,
+                        applying_server_fixture)
+{
+    ss.streaming_applier_pool_size(1);
+    wsrep::high_priority_service* first(0);
+    for (long long i(1); i <= 2; ++i)
+    {
+        wsrep::stid stid(wsrep::id("1"), wsrep::transaction_id(i),
+                         wsrep::client_id(1));
+        ws_meta = wsrep::ws_meta(
+            wsrep::gtid(wsrep::id("1"), wsrep::seqno(2 * i - 1)), stid,
+            wsrep::seqno(2 * i - 2),
+            wsrep::provider::flag::start_transaction);
+        BOOST_REQUIRE(ss.on_apply(hps, ws_handle, ws_meta,
+                                  wsrep::const_buffer("1", 1)) == 0);
+        wsrep::high_priority_service* sa(
+            ss.find_streaming_applier(stid.server_id(),
+                                      stid.transaction_id()));
+        BOOST_REQUIRE(sa);
+        if (first == 0)
+        {
+            first = sa;
+        }
+        BOOST_REQUIRE(sa == first);
+        BOOST_REQUIRE(static_cast<wsrep::mock_high_priority_service*>(sa)->
+                      execution_context_switches_ == size_t(i));
+        ws_meta = wsrep::ws_meta(
+            wsrep::gtid(wsrep::id("1"), wsrep::seqno(2 * i)), stid,
+            wsrep::seqno(2 * i - 1),
+            wsrep::provider::flag::commit);
+        BOOST_REQUIRE(ss.on_apply(hps, ws_handle, ws_meta,
+                                  wsrep::const_buffer("1", 1)) == 0);
+    }
+    ss.streaming_applier_pool_size(0);
+}
+
 
 BOOST_AUTO_TEST_CASE(server_state_state_strings)
 {
@@ -617,3 +818,108 @@ BOOST_FIXTURE_TEST_CASE(
     ss.resume_and_resync();
     BOOST_REQUIRE(ss.state() == wsrep::server_state::s_synced);
 }
+
+/////////////////////////////////////////////////////////////////////////////
+//                      Orphaned SR transactions                           //
+/////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    void start_streaming_appliers(wsrep::mock_server_state& ss,
+                                  wsrep::mock_high_priority_service& hps,
+                                  const wsrep::id& server_id,
+                                  size_t count)
+    {
+        for (size_t i(1); i <= count; ++i)
+        {
+            wsrep::ws_meta ws_meta(
+                wsrep::gtid(wsrep::id("1"), wsrep::seqno(i)),
+                wsrep::stid(server_id, wsrep::transaction_id(i),
+                            wsrep::client_id(1)),
+                wsrep::seqno(0),
+                wsrep::provider::flag::start_transaction);
+            BOOST_REQUIRE(ss.on_apply(hps,
+                                      wsrep::ws_handle(
+                                          wsrep::transaction_id(i), (void*)1),
+                                      ws_meta,
+                                      wsrep::const_buffer("1", 1)) == 0);
+        }
+    }
+
+    void orphaned_sr_rollback(init_first_server_fixture& f, size_t threads)
+    {
+        f.bootstrap();
+        f.ss.orphaned_sr_rollback_threads(threads);
+        const size_t count(20);
+        start_streaming_appliers(f.ss, f.hps, wsrep::id("s2"), count);
+        start_streaming_appliers(f.ss, f.hps, wsrep::id("s3"), count);
+        // Node s2 leaves the cluster.
+        std::vector<wsrep::view::member> members;
+        members.push_back(wsrep::view::member(wsrep::id("s1"), "s1", ""));
+        members.push_back(wsrep::view::member(wsrep::id("s3"), "s3", ""));
+        wsrep::view view(wsrep::gtid(f.cluster_id, wsrep::seqno(1)),
+                         wsrep::seqno(2),
+                         wsrep::view::primary,
+                         0, // capabilities
+                         0, // own index
+                         1, // protocol version
+                         members);
+        f.ss.on_view(view, &f.hps);
+        for (size_t i(1); i <= count; ++i)
+        {
+            BOOST_REQUIRE(f.ss.find_streaming_applier(
+                              wsrep::id("s2"), wsrep::transaction_id(i)) == 0);
+            BOOST_REQUIRE(f.ss.find_streaming_applier(
+                              wsrep::id("s3"), wsrep::transaction_id(i)) != 0);
+        }
+        BOOST_REQUIRE(f.cc.transaction().active() == false);
+        f.disconnect();
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(server_state_orphaned_sr_rollback,
+                        init_first_server_fixture)
+{
+    orphaned_sr_rollback(*this, 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(server_state_orphaned_sr_rollback_parallel,
+                        init_first_server_fixture)
+{
+    orphaned_sr_rollback(*this, 4);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//                      Streaming applier recovery                         //
+/////////////////////////////////////////////////////////////////////////////
+
+BOOST_FIXTURE_TEST_CASE(server_state_parallel_streaming_applier_recovery,
+                        init_first_server_fixture)
+{
+    // Recovered transactions must originate from a member of the
+    // bootstrap view, otherwise they are rolled back as orphaned
+    // right after recovery.
+    const wsrep::id server_id("s1");
+    const size_t count(40);
+    for (size_t i(1); i <= count; ++i)
+    {
+        server_service.streaming_log_.push_back(
+            std::make_pair(server_id, wsrep::transaction_id(i)));
+    }
+    server_service.fail_streaming_applier_recovery_ =
+        wsrep::transaction_id(count);
+    ss.streaming_applier_recovery_threads(4);
+    // Streaming appliers are recovered when the bootstrap view is
+    // delivered.
+    bootstrap();
+    for (size_t i(1); i < count; ++i)
+    {
+        wsrep::high_priority_service* sa(
+            ss.find_streaming_applier(server_id, wsrep::transaction_id(i)));
+        BOOST_REQUIRE(sa != 0);
+        BOOST_REQUIRE(sa->transaction().is_streaming());
+    }
+    BOOST_REQUIRE(ss.find_streaming_applier(
+                      server_id, wsrep::transaction_id(count)) == 0);
+    disconnect();
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/** @file streaming_applier_registry_bench.cpp
+ *
+ * Contention benchmark for streaming applier registry.
+ *
+ * Each thread emulates an applier which applies fragments of
+ * a set of concurrent streaming transactions: the streaming applier
+ * is registered on the first fragment, looked up on every
+ * fragment and removed on commit. The sharded registry is
+ * compared against a single std::map protected by one mutex,
+ * which was the scheme used by server_state earlier.
+ *
+ * Usage: streaming_applier_registry_bench [threads] [transactions]
+ *                                        [fragments]
+ */
+
+#include "wsrep/streaming_applier_registry.hpp"
+#include "wsrep/lock.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    class single_mutex_registry
+    {
+    public:
+        single_mutex_registry() : mutex_(), map_() { }
+        bool insert(const wsrep::id& server_id,
+                    const wsrep::transaction_id& transaction_id,
+                    wsrep::high_priority_service* hps)
+        {
+            wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+            return map_.insert(
+                std::make_pair(std::make_pair(server_id, transaction_id),
+                               hps)).second;
+        }
+        wsrep::high_priority_service* erase(
+            const wsrep::id& server_id,
+            const wsrep::transaction_id& transaction_id)
+        {
+            wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+            map_type::iterator i(map_.find(std::make_pair(server_id,
+                                                          transaction_id)));
+            if (i == map_.end()) return 0;
+            wsrep::high_priority_service* ret(i->second);
+            map_.erase(i);
+            return ret;
+        }
+        wsrep::high_priority_service* find(
+            const wsrep::id& server_id,
+            const wsrep::transaction_id& transaction_id)
+        {
+            wsrep::unique_lock<wsrep::mutex> lock(mutex_);
+            map_type::const_iterator i(
+                map_.find(std::make_pair(server_id, transaction_id)));
+            return (i == map_.end() ? 0 : i->second);
+        }
+    private:
+        typedef std::map<wsrep::streaming_applier_registry::key_type,
+                         wsrep::high_priority_service*> map_type;
+        wsrep::default_mutex mutex_;
+        map_type map_;
+    };
+
+    template <class Registry>
+    void applier(Registry& registry, size_t thread, size_t transactions,
+                 size_t fragments)
+    {
+        const wsrep::id server_id(&thread, sizeof(thread));
+        wsrep::high_priority_service* hps(
+            reinterpret_cast<wsrep::high_priority_service*>(thread + 1));
+        // All transactions of the thread are open concurrently,
+        // fragments are applied in round robin order.
+        for (size_t i(0); i < transactions; ++i)
+        {
+            registry.insert(server_id, wsrep::transaction_id(i), hps);
+        }
+        for (size_t f(0); f < fragments; ++f)
+        {
+            for (size_t i(0); i < transactions; ++i)
+            {
+                if (registry.find(server_id, wsrep::transaction_id(i)) != hps)
+                {
+                    std::cerr << "Lookup failed" << std::endl;
+                    ::abort();
+                }
+            }
+        }
+        for (size_t i(0); i < transactions; ++i)
+        {
+            registry.erase(server_id, wsrep::transaction_id(i));
+        }
+    }
+
+    template <class Registry>
+    double run(Registry& registry, size_t threads, size_t transactions,
+               size_t fragments)
+    {
+        std::vector<std::thread> appliers;
+        std::chrono::steady_clock::time_point start(
+            std::chrono::steady_clock::now());
+        for (size_t i(0); i < threads; ++i)
+        {
+            appliers.push_back(std::thread(applier<Registry>,
+                                           std::ref(registry), i,
+                                           transactions, fragments));
+        }
+        for (size_t i(0); i < threads; ++i)
+        {
+            appliers[i].join();
+        }
+        std::chrono::duration<double> elapsed(
+            std::chrono::steady_clock::now() - start);
+        return elapsed.count();
+    }
+
+    void report(const char* name, double seconds, size_t ops)
+    {
+        std::cout << name << ": " << seconds << " s, "
+                  << static_cast<size_t>(ops / seconds) << " ops/s"
+                  << std::endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    size_t threads(argc > 1 ? std::strtoul(argv[1], 0, 10) : 8);
+    size_t transactions(argc > 2 ? std::strtoul(argv[2], 0, 10) : 1000);
+    size_t fragments(argc > 3 ? std::strtoul(argv[3], 0, 10) : 100);
+    size_t ops(threads * transactions * (fragments + 2));
+
+    std::cout << "Threads: " << threads
+              << " transactions per thread: " << transactions
+              << " fragments per transaction: " << fragments
+              << std::endl;
+    {
+        single_mutex_registry registry;
+        report("single mutex", run(registry, threads, transactions, fragments),
+               ops);
+    }
+    {
+        wsrep::streaming_applier_registry registry;
+        report("sharded", run(registry, threads, transactions, fragments),
+               ops);
+    }
+    return 0;
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2018 Codership Oy <info@codership.com>
+ *
+ * This file is part of wsrep-lib.
+ *
+ * Wsrep-lib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Wsrep-lib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wsrep-lib.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "wsrep/streaming_applier_registry.hpp"
+#include <boost/test/unit_test.hpp>
+
+#include <set>
+
+namespace
+{
+    wsrep::high_priority_service* hps(size_t i)
+    {
+        return reinterpret_cast<wsrep::high_priority_service*>(i);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(streaming_applier_registry_shards)
+{
+    BOOST_REQUIRE(wsrep::streaming_applier_registry(0).shards() == 1);
+    BOOST_REQUIRE(wsrep::streaming_applier_registry(1).shards() == 1);
+    BOOST_REQUIRE(wsrep::streaming_applier_registry(3).shards() == 4);
+    BOOST_REQUIRE(wsrep::streaming_applier_registry().shards() ==
+                  wsrep::streaming_applier_registry::default_shards);
+}
+
+BOOST_AUTO_TEST_CASE(streaming_applier_registry_insert_find_erase)
+{
+    wsrep::streaming_applier_registry registry;
+    wsrep::id s1("s1");
+    wsrep::id s2("s2");
+    BOOST_REQUIRE(registry.empty());
+    BOOST_REQUIRE(registry.insert(s1, wsrep::transaction_id(1), hps(1)));
+    BOOST_REQUIRE(registry.insert(s2, wsrep::transaction_id(1), hps(2)));
+    BOOST_REQUIRE(registry.insert(s1, wsrep::transaction_id(1), hps(3))
+                  == false);
+    BOOST_REQUIRE(registry.size() == 2);
+    BOOST_REQUIRE(registry.find(s1, wsrep::transaction_id(1)) == hps(1));
+    BOOST_REQUIRE(registry.find(s2, wsrep::transaction_id(1)) == hps(2));
+    BOOST_REQUIRE(registry.find(s1, wsrep::transaction_id(2)) == 0);
+    BOOST_REQUIRE(registry.erase(s1, wsrep::transaction_id(1)) == hps(1));
+    BOOST_REQUIRE(registry.erase(s1, wsrep::transaction_id(1)) == 0);
+    BOOST_REQUIRE(registry.find(s1, wsrep::transaction_id(1)) == 0);
+    BOOST_REQUIRE(registry.size() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(streaming_applier_registry_entries)
+{
+    wsrep::streaming_applier_registry registry(4);
+    wsrep::id s1("s1");
+    for (size_t i(1); i <= 100; ++i)
+    {
+        BOOST_REQUIRE(registry.insert(s1, wsrep::transaction_id(i), hps(i)));
+    }
+    std::vector<wsrep::streaming_applier_registry::value_type>
+        entries(registry.entries());
+    BOOST_REQUIRE(entries.size() == 100);
+    std::set<wsrep::high_priority_service*> found;
+    for (size_t i(0); i < entries.size(); ++i)
+    {
+        BOOST_REQUIRE(entries[i].first.first == s1);
+        BOOST_REQUIRE(entries[i].second ==
+                      hps(entries[i].first.second.get()));
+        found.insert(entries[i].second);
+    }
+    BOOST_REQUIRE(found.size() == 100);
+}
@@ -55,6 +55,22 @@ BOOST_FIXTURE_TEST_CASE(transaction_append_key_data,
     cc.after_statement();
 }
 //
+// Test that commutative transaction is replicated with commutative flag
+//
+BOOST_FIXTURE_TEST_CASE(transaction_commutative,
+                        replicating_client_fixture_sync_rm)
+{
+    cc.start_transaction(wsrep::transaction_id(1));
+    BOOST_REQUIRE(cc.mark_commutative() == 0);
+    BOOST_REQUIRE(tc.commutative());
+    BOOST_REQUIRE(cc.before_commit() == 0);
+    BOOST_REQUIRE(wsrep::is_commutative(tc.ws_meta().flags()));
+    BOOST_REQUIRE(cc.ordered_commit() == 0);
+    BOOST_REQUIRE(cc.after_commit() == 0);
+    cc.after_statement();
+    BOOST_REQUIRE(tc.commutative() == false);
+}
+//
 // Test a succesful 1PC transaction lifecycle
 //
 BOOST_FIXTURE_TEST_CASE_TEMPLATE(transaction_1pc, T,
@@ -1046,6 +1062,23 @@ BOOST_FIXTURE_TEST_CASE(transaction_row_streaming_1pc_commit,
     BOOST_REQUIRE(sc.provider().commit_fragments() == 1);
 }
 
+//
+// Test that streaming transaction cannot be marked commutative
+//
+BOOST_FIXTURE_TEST_CASE(transaction_row_streaming_commutative,
+                        streaming_client_fixture_row)
+{
+    BOOST_REQUIRE(cc.start_transaction(wsrep::transaction_id(1)) == 0);
+    BOOST_REQUIRE(cc.after_row() == 0);
+    BOOST_REQUIRE(cc.mark_commutative());
+    BOOST_REQUIRE(tc.commutative() == false);
+    BOOST_REQUIRE(cc.before_commit() == 0);
+    BOOST_REQUIRE(wsrep::is_commutative(tc.ws_meta().flags()) == false);
+    BOOST_REQUIRE(cc.ordered_commit() == 0);
+    BOOST_REQUIRE(cc.after_commit() == 0);
+    BOOST_REQUIRE(cc.after_statement() == 0);
+}
+
 //
 // Test 1PC with row streaming with one row
 //